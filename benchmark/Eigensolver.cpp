@@ -0,0 +1,80 @@
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+
+#include <edlib/EDParams.h>
+#include "edlib/Hamiltonian.h"
+
+/**
+ * Compare time, number of matrix-vector products and lowest eigenvalues of ARPACK, of the thick-restart Lanczos
+ * solver with double and single precision basis and of the block Davidson solver in each symmetry sector
+ *
+ * @tparam Storage - type of Hamiltonian storage
+ * @tparam Model - type of the model
+ * @param params - parameters
+ */
+template<class Storage, class Model>
+void benchmark_eigensolver(alps::params &params) {
+  typedef typename Model::precision prec;
+  Model model(params);
+#ifdef USE_MPI
+  Storage storage(params, model, MPI_COMM_WORLD);
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+#else
+  Storage storage(params, model);
+  int rank = 0;
+#endif
+  const int nsolvers = 4;
+  const EDLib::Storage::Eigensolver solvers[nsolvers] = {EDLib::Storage::Eigensolver::ARPACK, EDLib::Storage::Eigensolver::LANCZOS,
+                                                         EDLib::Storage::Eigensolver::LANCZOS, EDLib::Storage::Eigensolver::DAVIDSON};
+  const bool float_krylov[nsolvers] = {false, false, true, false};
+  const char *names[nsolvers] = {"ARPACK", "Lanczos", "Lanczos(float basis)", "Davidson"};
+  while (model.symmetry().next_sector()) {
+    storage.fill();
+    std::vector < prec > reference;
+    for (int k = 0; k < nsolvers; ++k) {
+      storage.eigensolver() = solvers[k];
+      storage.float_krylov() = float_krylov[k];
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      storage.diag();
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      const std::vector < prec > &evals = storage.eigenvalues();
+      if (k == 0) {
+        reference = evals;
+      }
+      double diff = 0.0;
+      for (size_t i = 0; i < std::min(evals.size(), reference.size()); ++i) {
+        diff = std::max(diff, double(std::abs(evals[i] - reference[i])));
+      }
+      if (!rank) {
+        std::cout << names[k] << " sector" << model.symmetry().sector() << " time: " << std::setprecision(6) << elapsed.count() << " s"
+                  << " OP*x: " << storage.matvecs() << " max |E - E_ARPACK|: " << std::setprecision(3) << diff << std::endl;
+      }
+    }
+  }
+}
+
+int main(int argc, const char **argv) {
+#ifdef USE_MPI
+  int provided;
+  /// MPI calls are performed outside of OpenMP parallel regions only
+  MPI_Init_thread(&argc, (char ***) &argv, MPI_THREAD_FUNNELED, &provided);
+#endif
+  alps::params params(argc, argv);
+  EDLib::define_parameters(params);
+  if (params.help_requested(std::cout)) {
+    exit(0);
+  }
+  typedef EDLib::Model::HubbardModel < double > Model;
+  try {
+    benchmark_eigensolver < EDLib::Storage::CRSStorage < Model >, Model >(params);
+  } catch (std::exception &e) {
+    std::cerr << e.what() << std::endl;
+  }
+#ifdef USE_MPI
+  MPI_Finalize();
+#endif
+  return 0;
+}
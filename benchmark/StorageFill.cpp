@@ -0,0 +1,64 @@
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+#include <edlib/EDParams.h>
+#include "edlib/Hamiltonian.h"
+
+/**
+ * Measure the time spent on the Hamiltonian matrix construction in each symmetry sector
+ *
+ * @tparam Storage - type of Hamiltonian storage
+ * @tparam Model - type of the model
+ * @param params - parameters
+ * @param name - storage name for output
+ */
+template<class Storage, class Model>
+void benchmark_fill(alps::params &params, const std::string &name) {
+  Model model(params);
+#ifdef USE_MPI
+  Storage storage(params, model, MPI_COMM_WORLD);
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+#else
+  Storage storage(params, model);
+  int rank = 0;
+#endif
+  double total = 0.0;
+  while (model.symmetry().next_sector()) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    storage.fill();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    total += elapsed.count();
+    if (!rank) {
+      std::cout << name << " sector" << model.symmetry().sector() << " fill time: " << std::setprecision(6) << elapsed.count() << " s" << std::endl;
+    }
+  }
+  if (!rank) {
+    std::cout << name << " total fill time: " << total << " s" << std::endl;
+  }
+}
+
+int main(int argc, const char **argv) {
+#ifdef USE_MPI
+  int provided;
+  /// MPI calls are performed outside of OpenMP parallel regions only
+  MPI_Init_thread(&argc, (char ***) &argv, MPI_THREAD_FUNNELED, &provided);
+#endif
+  alps::params params(argc, argv);
+  EDLib::define_parameters(params);
+  if (params.help_requested(std::cout)) {
+    exit(0);
+  }
+  typedef EDLib::Model::SingleImpurityAndersonModel < double > Model;
+  try {
+    benchmark_fill < EDLib::Storage::CRSStorage < Model >, Model >(params, "CRSStorage");
+    benchmark_fill < EDLib::Storage::SpinResolvedStorage < Model >, Model >(params, "SpinResolvedStorage");
+  } catch (std::exception &e) {
+    std::cerr << e.what() << std::endl;
+  }
+#ifdef USE_MPI
+  MPI_Finalize();
+#endif
+  return 0;
+}
@@ -0,0 +1,127 @@
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+#include <edlib/EDParams.h>
+#include "edlib/Hamiltonian.h"
+
+/**
+ * Number of bytes used to store CRS matrix: value and column index for each non-zero element and row pointers.
+ */
+template<class Model, typename value_prec>
+double storage_bytes(EDLib::Storage::CRSStorage < Model, value_prec > &storage, int n) {
+  return double(storage.nnz()) * (sizeof(value_prec) + sizeof(int)) + double(n + 1) * sizeof(size_t);
+}
+
+/**
+ * Number of bytes used to store sign-only CRS matrix: column index and one bit of sign for each off-diagonal element
+ * and diagonal values. Off-diagonal values are restored from the model.
+ */
+template<class Model, typename value_prec>
+double storage_bytes(EDLib::Storage::SOCRSStorage < Model, value_prec > &storage, int n) {
+  double offdiag = double(storage.nnz() - n);
+  return offdiag * sizeof(int) + offdiag / 8.0 + double(n) * sizeof(value_prec);
+}
+
+/**
+ * Number of bytes used to store spin-resolved matrix: diagonal part and number of non-zero elements in
+ * spin-up and spin-down hopping matrices and off-diagonal interaction matrix.
+ */
+template<class Model, typename value_prec>
+double storage_bytes(EDLib::Storage::SpinResolvedStorage < Model, value_prec > &storage, int n) {
+  return double(storage.stored_nnz()) * (sizeof(value_prec) + sizeof(int)) + double(n) * sizeof(value_prec);
+}
+
+/**
+ * Measure memory footprint and performance of the matrix-vector product in each symmetry sector. The product with
+ * blocks of 2, 4, ... benchmark.MAX_BLOCK vectors is measured to estimate the effective memory bandwidth: the matrix
+ * is streamed once per block, the input and output blocks are streamed once.
+ *
+ * @tparam Storage - type of Hamiltonian storage
+ * @tparam Model - type of the model
+ * @param params - parameters
+ * @param name - storage name for output
+ */
+template<class Storage, class Model>
+void benchmark_spmv(alps::params &params, const std::string &name) {
+  typedef typename Model::precision prec;
+  Model model(params);
+#ifdef USE_MPI
+  Storage storage(params, model, MPI_COMM_WORLD);
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+#else
+  Storage storage(params, model);
+  int rank = 0;
+#endif
+  int niter = params["benchmark.NITER"];
+  int max_block = params["benchmark.MAX_BLOCK"];
+  while (model.symmetry().next_sector()) {
+    storage.fill();
+    int n = storage.vector_size(model.symmetry().sector());
+    std::vector < prec > v(n, prec(1.0)), w(n, prec(0.0));
+    storage.prepare_work_arrays(v.data());
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int iter = 0; iter < niter; ++iter) {
+      storage.av(v.data(), w.data(), n);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    double flops = 2.0 * storage.nnz() * niter;
+    double bytes = (storage_bytes(storage, n) + 2.0 * n * sizeof(prec)) * niter;
+    if (!rank) {
+      std::cout << name << " sector" << model.symmetry().sector() << " nnz: " << storage.nnz()
+                << " bytes/nnz: " << std::setprecision(3) << storage_bytes(storage, n) / storage.nnz()
+                << " av time: " << std::setprecision(6) << elapsed.count() / niter << " s"
+                << " GFLOP/s: " << std::setprecision(3) << flops / elapsed.count() * 1e-9
+                << " GB/s: " << bytes / elapsed.count() * 1e-9 << std::endl;
+    }
+    for (int k = 2; k <= max_block; k *= 2) {
+      std::vector < prec > V(size_t(n) * k, prec(1.0)), W(size_t(n) * k, prec(0.0));
+      start = std::chrono::steady_clock::now();
+      for (int iter = 0; iter < niter; ++iter) {
+        storage.av_block(V.data(), W.data(), n, k);
+      }
+      elapsed = std::chrono::steady_clock::now() - start;
+      flops = 2.0 * storage.nnz() * k * niter;
+      bytes = (storage_bytes(storage, n) + 2.0 * n * k * sizeof(prec)) * niter;
+      if (!rank) {
+        std::cout << name << " sector" << model.symmetry().sector() << " block: " << k
+                  << " av time per vector: " << std::setprecision(6) << elapsed.count() / niter / k << " s"
+                  << " GFLOP/s: " << std::setprecision(3) << flops / elapsed.count() * 1e-9
+                  << " GB/s: " << bytes / elapsed.count() * 1e-9 << std::endl;
+      }
+    }
+    storage.finalize(0, false);
+  }
+}
+
+int main(int argc, const char **argv) {
+#ifdef USE_MPI
+  int provided;
+  /// MPI calls are performed outside of OpenMP parallel regions only
+  MPI_Init_thread(&argc, (char ***) &argv, MPI_THREAD_FUNNELED, &provided);
+#endif
+  alps::params params(argc, argv);
+  EDLib::define_parameters(params);
+  params.define < int >("benchmark.NITER", 20, "Number of matrix-vector products");
+  params.define < int >("benchmark.MAX_BLOCK", 8, "Largest number of vectors in the matrix-block product");
+  if (params.help_requested(std::cout)) {
+    exit(0);
+  }
+  typedef EDLib::Model::HubbardModel < double > Model;
+  try {
+    benchmark_spmv < EDLib::Storage::CRSStorage < Model >, Model >(params, "CRSStorage");
+    benchmark_spmv < EDLib::Storage::SOCRSStorage < Model >, Model >(params, "SOCRSStorage");
+    benchmark_spmv < EDLib::Storage::SpinResolvedStorage < Model >, Model >(params, "SpinResolvedStorage");
+    /// single precision matrix elements with double precision vectors
+    benchmark_spmv < EDLib::Storage::CRSStorage < Model, float >, Model >(params, "CRSStorage (float values)");
+    benchmark_spmv < EDLib::Storage::SOCRSStorage < Model, float >, Model >(params, "SOCRSStorage (float values)");
+    benchmark_spmv < EDLib::Storage::SpinResolvedStorage < Model, float >, Model >(params, "SpinResolvedStorage (float values)");
+  } catch (std::exception &e) {
+    std::cerr << e.what() << std::endl;
+  }
+#ifdef USE_MPI
+  MPI_Finalize();
+#endif
+  return 0;
+}
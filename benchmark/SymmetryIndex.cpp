@@ -0,0 +1,71 @@
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+#include "edlib/NSymmetry.h"
+
+/**
+ * Recursive ranking that was used in NSymmetry::index before, kept as the reference
+ */
+int recursive_num(const EDLib::Combination &comb, int N, long long b, int n, int m) {
+  int res = 0;
+  if (((b & (1ll << (N - n))) == 0) and ((n - 1) > 0) and (m > 0) and (m < n))
+    res = recursive_num(comb, N, b, n - 1, m);
+  else if (((n - 1) > 0) and (m > 0) and (m < n))
+    res = comb.c_n_k(n - 1, m) + recursive_num(comb, N, b, n - 1, m - 1);
+  return res;
+}
+
+/**
+ * Measure the time per NSymmetry::index call in each sector for the recursive ranking, the iterative table-driven
+ * ranking and the direct lookup table (if N <= NSymmetry::DIRECT_INDEX_BITS)
+ *
+ * @param N - number of bits
+ * @param niter - number of passes over the states of each sector
+ */
+void benchmark_index(int N, int niter) {
+  EDLib::Symmetry::NSymmetry symmetry(N);
+  for (int n = 0; n <= N; ++n) {
+    int size = symmetry.comb().c_n_k(N, n);
+    symmetry.set_sector(EDLib::Symmetry::NSymmetry::Sector(n, size));
+    std::vector < long long > states;
+    while (symmetry.next_state()) {
+      states.push_back(symmetry.state());
+    }
+    /// prevent the compiler from removing the calls
+    long long check[3] = {0, 0, 0};
+    double elapsed[3];
+    for (int method = 0; method < 3; ++method) {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      for (int iter = 0; iter < niter; ++iter) {
+        for (size_t i = 0; i < states.size(); ++i) {
+          if (method == 0) {
+            check[method] += size - recursive_num(symmetry.comb(), N, states[i], N, n) - 1;
+          } else if (method == 1) {
+            check[method] += symmetry.rank(states[i], n);
+          } else {
+            check[method] += symmetry.index(states[i]);
+          }
+        }
+      }
+      std::chrono::duration < double > time = std::chrono::steady_clock::now() - start;
+      elapsed[method] = time.count() * 1e9 / (double(niter) * states.size());
+    }
+    std::cout << "N: " << N << " n: " << n << " size: " << size << std::setprecision(3)
+              << " recursive: " << elapsed[0] << " ns"
+              << " iterative: " << elapsed[1] << " ns"
+              << (N <= EDLib::Symmetry::NSymmetry::DIRECT_INDEX_BITS ? " direct: " : " index: ") << elapsed[2] << " ns"
+              << (check[0] == check[1] && check[1] == check[2] ? "" : " MISMATCH") << std::endl;
+  }
+}
+
+int main(int argc, const char **argv) {
+  alps::params params(argc, argv);
+  params.define < int >("benchmark.NBITS", 16, "Number of bits in the N-symmetry states");
+  params.define < int >("benchmark.NITER", 20, "Number of passes over the states of each sector");
+  if (params.help_requested(std::cout)) {
+    exit(0);
+  }
+  benchmark_index(params["benchmark.NBITS"], params["benchmark.NITER"]);
+  return 0;
+}
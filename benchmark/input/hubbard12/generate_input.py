@@ -0,0 +1,32 @@
+#!/usr/bin/env python
+
+import h5py
+import numpy as np
+
+Ns = 12
+U = np.array([4.0] * Ns)
+xmu = np.array([2.0] * Ns)
+t = np.zeros((Ns, Ns))
+for i in range(Ns):
+    t[i][(i + 1) % Ns] = -1.0
+    t[(i + 1) % Ns][i] = -1.0
+
+sectors = np.array([[Ns//2,Ns//2],])
+
+data = h5py.File("input.h5", "w");
+
+beta = data.create_dataset("BETA", shape=(), dtype='f', data=10.0)
+
+hop_g = data.create_group("sectors")
+hop_g.create_dataset("values", data=sectors)
+
+hop_g = data.create_group("hopping")
+hop_g.create_dataset("values", data=t)
+
+int_g = data.create_group("interaction")
+int_ds = int_g.create_dataset("values", shape=(Ns,), data=U)
+
+int_g = data.create_group("chemical_potential")
+int_ds = int_g.create_dataset("values", shape=(Ns,), data=xmu)
+
+data["magnetic_field"] = 0.0
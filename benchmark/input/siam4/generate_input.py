@@ -0,0 +1,52 @@
+#!/usr/bin/env python
+
+import h5py
+import numpy as np
+
+
+def Kanamori_interaction(norb, U_int, J_hund):
+    U = np.zeros((norb,norb,norb,norb), dtype=float)
+    for i in range(norb):
+        U[i][i][i][i] = U_int
+        for j in range(norb):
+            if(i != j):
+                U[i][j][i][j] = U_int - 2* J_hund
+                U[i][j][j][i] = J_hund
+                U[i][i][j][j] = J_hund
+    return U
+
+ml = 4
+Nk = 2
+
+U = Kanamori_interaction(ml, U_int=2.0, J_hund=0.3)
+xmu = 3.0
+Eps0 = np.zeros((ml, 2))
+Vk =   [ np.array([ [0.5,  0.5], [0.3,  0.3] ]) for i in range(ml) ]
+Epsk = [ np.array([ [-1.0,-1.0], [1.0,  1.0] ]) for i in range(ml) ]
+
+Ns = ml + ml*Nk
+
+sectors = np.array([[Ns//2,Ns//2],])
+
+data = h5py.File("input.h5", "w");
+
+beta = data.create_dataset("BETA", shape=(), dtype='f', data=10.0)
+
+hop_g = data.create_group("sectors")
+hop_g.create_dataset("values", data=sectors)
+
+bath = data.create_group("Bath")
+
+for i in range(ml):
+    Epsk_g = bath.create_group("Epsk_" + str(i))
+    Epsk_g.create_dataset("values", data=Epsk[i], dtype=np.float64)
+    Vk_g = bath.create_group("Vk_" + str(i))
+    Vk_g.create_dataset("values", data=Vk[i], dtype=np.float64)
+
+hop_g = data.create_group("Eps0")
+hop_g.create_dataset("values", data=Eps0)
+
+int_g = data.create_group("interaction")
+int_ds = int_g.create_dataset("values", shape=(ml,ml,ml,ml,), data=U)
+
+int_ds = data.create_dataset("mu", shape=(), data=xmu)
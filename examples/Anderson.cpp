@@ -18,7 +18,9 @@
 
 int main(int argc, const char ** argv) {
 #ifdef USE_MPI
-  MPI_Init(&argc, (char ***) &argv);
+  int provided;
+  /// MPI calls are performed outside of OpenMP parallel regions only
+  MPI_Init_thread(&argc, (char ***) &argv, MPI_THREAD_FUNNELED, &provided);
   alps::mpi::communicator comm;
 #endif
   alps::params params(argc, argv);
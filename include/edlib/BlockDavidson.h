@@ -0,0 +1,541 @@
+#ifndef HUBBARD_BLOCKDAVIDSON_H
+#define HUBBARD_BLOCKDAVIDSON_H
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "ThickRestartLanczos.h"
+
+namespace EDLib {
+  namespace Storage {
+
+    /**
+     * @brief Block Davidson method with diagonal preconditioner for the lowest eigen-pairs of a real symmetric matrix
+     *
+     * The search space is extended by a block of corrections t_i = (D - theta_i)^{-1} (r_i - epsilon_i x_i) for all unconverged
+     * Ritz pairs (x_i, theta_i), where D is the diagonal of the matrix, r_i is the residual vector and epsilon_i makes t_i orthogonal
+     * to x_i (E. R. Davidson, J. Comput. Phys. 17, 87 (1975); J. Olsen et al., Chem. Phys. Lett. 169, 463 (1990)). Without the
+     * epsilon_i term the correction tends to x_i when theta_i approaches a diagonal element and the method stagnates.
+     * The initial block consists of the unit vectors for the lowest diagonal elements with a small random admixture.
+     * The matrix is applied to the whole block at once, the block is stored in the interleaved layout X[i * k + j], where
+     * j is the vector number. Products of the matrix with the basis vectors are kept, so the residuals are obtained
+     * without additional matrix-vector products. When the basis grows over the largest size it is restarted with
+     * max(2 * nev, ncv / 2) lowest Ritz vectors and the Ritz vectors of the previous iteration. The products recombined
+     * at the restarts lose accuracy, so the converged pairs are accepted only after the products have been computed
+     * anew. The method handles the degenerate and clustered spectra, the price is two stored vectors per basis vector.
+     *
+     * @tparam prec - floating point precision
+     */
+    template<typename prec>
+    class BlockDavidson {
+    public:
+      /// W = A V for the local parts of k vectors in the interleaved layout
+      typedef std::function < void(const prec *, prec *, size_t, int) > BlockOperator;
+      /// in-place sum of the array over all CPUs that share the vectors
+      typedef std::function < void(double *, int) > Reduction;
+      /// in-place projection of the local part of a vector onto the wanted subspace
+      typedef std::function < void(prec *, size_t) > Projection;
+
+      /**
+       * @param n - local dimension
+       * @param ntot - total dimension
+       * @param nev - number of eigen-pairs, also the block size
+       * @param ncv - largest size of the basis, at least 3 * nev
+       * @param tol - relative tolerance for the residual norms of the Ritz pairs
+       * @param maxitr - largest number of restarts
+       */
+      BlockDavidson(size_t n, size_t ntot, int nev, int ncv, double tol, int maxitr) : _n(n), _nev(int(std::min(size_t(nev), ntot))),
+                                                                                   _mmax(std::max(ncv, 3 * nev)), _keep(std::max(2 * nev, _mmax / 2)), _tol(tol), _maxitr(maxitr),
+                                                                                   _iterations(0), _restarts(0), _matvecs(0) {}
+
+      /**
+       * Compute the lowest eigen-pairs
+       *
+       * @param op - matrix-block product
+       * @param sum - reduction over the CPUs
+       * @param diagonal - local part of the diagonal of the matrix
+       * @param start - local part of the starting vector, random vectors are used if it is empty
+       * @param seed - seed for the random vectors
+       * @param evals - lowest eigenvalues in ascending order
+       * @param evecs - local parts of the eigenvectors
+       * @param vectors - compute eigenvectors
+       * @param project - projection applied to each new basis vector, e.g. onto the states with the given total spin
+       * @return 0 if all eigen-pairs have converged, 1 if the maximum number of restarts has been reached
+       * or the basis can not be extended
+       */
+      int solve(const BlockOperator &op, const Reduction &sum, const std::vector < prec > &diagonal, const std::vector < prec > &start, int seed,
+                std::vector < prec > &evals, std::vector < std::vector < prec > > &evecs, bool vectors, const Projection &project = Projection()) {
+        std::mt19937 gen(seed);
+        std::uniform_real_distribution < double > dist(-1.0, 1.0);
+        _V.clear();
+        _AV.clear();
+        _G.clear();
+        _iterations = 0;
+        _restarts = 0;
+        _matvecs = 0;
+        /// initial block: starting vector and the unit vectors for the lowest local diagonal elements
+        std::vector < size_t > order(_n);
+        for (size_t l = 0; l < _n; ++l) {
+          order[l] = l;
+        }
+        size_t nlow = std::min(size_t(_nev), _n);
+        std::partial_sort(order.begin(), order.begin() + nlow, order.end(), [&diagonal](size_t a, size_t b) { return diagonal[a] < diagonal[b]; });
+        std::vector < std::vector < prec > > block(_nev, std::vector < prec >(_n));
+        for (int i = 0; i < _nev; ++i) {
+          if (i == 0 && start.size() == _n) {
+            std::copy(start.begin(), start.end(), block[0].begin());
+            continue;
+          }
+          for (size_t l = 0; l < _n; ++l) {
+            block[i][l] = prec(1e-3 * dist(gen));
+          }
+          if (size_t(i) < nlow) {
+            block[i][order[i]] += prec(1.0);
+          }
+        }
+        extend(op, sum, block, project);
+        std::vector < double > theta, Y;
+        /// coefficients of the Ritz vectors of the previous iteration in the current basis
+        std::vector < double > Yprev;
+        int mprev = 0;
+        /// products of the basis with the matrix have not been recombined
+        bool fresh = true;
+        /// largest ratio of the residual norm to the tolerance, its smallest value since the last refresh of the basis
+        /// after the stagnation and before it, and the number of iterations without its decrease
+        double best = std::numeric_limits < double >::max();
+        double last = best;
+        int stalled = 0;
+        /// the residuals have reached the round-off
+        bool relaxed = false;
+        std::vector < std::vector < prec > > X(_nev, std::vector < prec >(_n));
+        std::vector < std::vector < prec > > R(_nev, std::vector < prec >(_n));
+        int info = 0;
+        while (true) {
+          ++_iterations;
+          int m = int(_V.size());
+          ThickRestartLanczos < prec >::eigen(_G, m, theta, Y);
+          /// residual vectors r_i = A x_i - theta_i x_i of the wanted Ritz pairs
+          residuals(Y, theta, m, X, R);
+          /// residual norms and the projections x_i M_i^{-1} r_i and x_i M_i^{-1} x_i for the Olsen correction
+          std::vector < double > norms(3 * _nev, 0.0);
+          for (int i = 0; i < _nev; ++i) {
+            for (size_t l = 0; l < _n; ++l) {
+              double x = X[i][l];
+              double den = denominator(diagonal[l], theta[i]);
+              norms[i] += double(R[i][l]) * double(R[i][l]);
+              norms[_nev + i] += x * R[i][l] / den;
+              norms[2 * _nev + i] += x * x / den;
+            }
+          }
+          sum(norms.data(), 3 * _nev);
+          double anorm = std::max(std::abs(theta.front()), std::abs(theta.back()));
+          double floor = 100.0 * std::numeric_limits < prec >::epsilon() * anorm;
+          double eps23 = std::pow(std::numeric_limits < double >::epsilon(), 2.0 / 3.0);
+          /// the round-off of the recombinations stops the decrease of the residuals, then the basis and the products
+          /// are computed anew; if the residuals close to the floor do not decrease between two such refreshes, they
+          /// have reached the round-off of the products themselves, a few hundred eps for large matrices, and the floor
+          /// is raised
+          double worst = 0.0;
+          for (int i = 0; i < _nev; ++i) {
+            worst = std::max(worst, std::sqrt(norms[i]) / std::max(floor, _tol * std::max(eps23, std::abs(theta[i]))));
+          }
+          if (worst < 0.9 * best) {
+            best = worst;
+            stalled = 0;
+          } else {
+            ++stalled;
+          }
+          bool refresh = false;
+          if (stalled == 10) {
+            relaxed = relaxed || (best >= 0.9 * last && best < 10.0);
+            last = best;
+            best = std::numeric_limits < double >::max();
+            stalled = 0;
+            refresh = true;
+          }
+          if (relaxed) {
+            floor *= 10.0;
+          }
+          block.clear();
+          bool converged = true;
+          for (int i = 0; i < _nev; ++i) {
+            if (std::sqrt(norms[i]) > std::max(floor, _tol * std::max(eps23, std::abs(theta[i])))) {
+              /// preconditioned residual
+              double epsilon = norms[2 * _nev + i] != 0.0 ? norms[_nev + i] / norms[2 * _nev + i] : 0.0;
+              std::vector < prec > t(_n);
+              for (size_t l = 0; l < _n; ++l) {
+                t[l] = prec((R[i][l] - epsilon * X[i][l]) / denominator(diagonal[l], theta[i]));
+              }
+              block.push_back(t);
+              converged = false;
+            }
+          }
+          if (converged && fresh) {
+            break;
+          }
+          refresh = refresh || converged;
+          if (refresh || m + int(block.size()) > _mmax) {
+            if (_restarts >= _maxitr) {
+              info = 1;
+              break;
+            }
+            ++_restarts;
+            /// the residuals of the converged pairs are verified with the products computed anew
+            restart(op, sum, Y, m, Yprev, mprev, refresh);
+            fresh = refresh;
+            /// the Ritz vectors of this iteration are the first basis vectors now
+            mprev = int(_V.size());
+            Yprev.assign(mprev * _nev, 0.0);
+            for (int i = 0; i < _nev; ++i) {
+              Yprev[i * _nev + i] = 1.0;
+            }
+          } else {
+            mprev = m;
+            Yprev.resize(m * _nev);
+            for (int j = 0; j < m; ++j) {
+              std::copy(Y.begin() + j * m, Y.begin() + j * m + _nev, Yprev.begin() + j * _nev);
+            }
+          }
+          if (refresh) {
+            continue;
+          }
+          if (extend(op, sum, block, project) == 0) {
+            /// corrections are in the span of the basis
+            info = 1;
+            break;
+          }
+        }
+        /// the basis may have been extended after the last Rayleigh-Ritz step
+        int m = int(_V.size());
+        ThickRestartLanczos < prec >::eigen(_G, m, theta, Y);
+        int nev = std::min(_nev, m);
+        evals.assign(theta.begin(), theta.begin() + nev);
+        if (vectors) {
+          evecs.assign(nev, std::vector < prec >(_n));
+          transform(_V, Y, m, m, nev, evecs);
+        }
+        _V.clear();
+        _AV.clear();
+        return info;
+      }
+
+      /**
+       * @return number of iterations in the last run
+       */
+      int iterations() const {
+        return _iterations;
+      }
+
+      /**
+       * @return number of restarts in the last run
+       */
+      int restarts() const {
+        return _restarts;
+      }
+
+      /**
+       * @return number of matrix-vector products in the last run
+       */
+      size_t matvecs() const {
+        return _matvecs;
+      }
+
+    private:
+      size_t _n;
+      int _nev;
+      /// largest size of the basis
+      int _mmax;
+      /// size of the basis after the restart
+      int _keep;
+      double _tol;
+      int _maxitr;
+      int _iterations;
+      int _restarts;
+      size_t _matvecs;
+      /// basis vectors and their products with the matrix
+      std::vector < std::vector < prec > > _V;
+      std::vector < std::vector < prec > > _AV;
+      /// projected matrix, row-major with the leading dimension equal to the basis size
+      std::vector < double > _G;
+
+      /// diagonal preconditioner D - theta bounded away from zero
+      static double denominator(prec d, double theta) {
+        double den = double(d) - theta;
+        if (std::abs(den) < 1e-8) {
+          den = den < 0.0 ? -1e-8 : 1e-8;
+        }
+        return den;
+      }
+
+      double local_dot(const std::vector < prec > &x, const std::vector < prec > &y) const {
+        double s = 0.0;
+        for (size_t l = 0; l < _n; ++l) {
+          s += double(x[l]) * double(y[l]);
+        }
+        return s;
+      }
+
+      /**
+       * Project the block, orthonormalize it against the basis and append it to the basis, then apply the matrix to
+       * the new vectors and extend the projected matrix. Vectors that lie in the span of the basis are dropped.
+       *
+       * @return number of added vectors
+       */
+      int extend(const BlockOperator &op, const Reduction &sum, std::vector < std::vector < prec > > &block, const Projection &project) {
+        int m = int(_V.size());
+        for (size_t b = 0; b < block.size(); ++b) {
+          std::vector < prec > &t = block[b];
+          if (project) {
+            project(t.data(), _n);
+          }
+          double nrm = local_dot(t, t);
+          sum(&nrm, 1);
+          nrm = std::sqrt(nrm);
+          if (nrm == 0.0) {
+            continue;
+          }
+          for (size_t l = 0; l < _n; ++l) {
+            t[l] = prec(t[l] / nrm);
+          }
+          /// two passes of classical Gram-Schmidt
+          int nvec = int(_V.size());
+          for (int pass = 0; pass < 2; ++pass) {
+            std::vector < double > c(nvec, 0.0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+            for (int i = 0; i < nvec; ++i) {
+              c[i] = local_dot(_V[i], t);
+            }
+            sum(c.data(), nvec);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+            for (long long l = 0; l < (long long) (_n); ++l) {
+              double tl = t[l];
+              for (int i = 0; i < nvec; ++i) {
+                tl -= c[i] * _V[i][l];
+              }
+              t[l] = prec(tl);
+            }
+          }
+          nrm = local_dot(t, t);
+          sum(&nrm, 1);
+          nrm = std::sqrt(nrm);
+          if (nrm < 1e-8) {
+            continue;
+          }
+          for (size_t l = 0; l < _n; ++l) {
+            t[l] = prec(t[l] / nrm);
+          }
+          _V.push_back(t);
+        }
+        int k = int(_V.size()) - m;
+        if (k == 0) {
+          return 0;
+        }
+        multiply(op, sum, m);
+        return k;
+      }
+
+      /**
+       * Apply the matrix to the basis vectors starting from the m-th one at once and extend the projected matrix
+       */
+      void multiply(const BlockOperator &op, const Reduction &sum, int m) {
+        int k = int(_V.size()) - m;
+        /// apply the matrix to the new vectors at once
+        std::vector < prec > X(_n * k), W(_n * k);
+        for (size_t l = 0; l < _n; ++l) {
+          for (int j = 0; j < k; ++j) {
+            X[l * k + j] = _V[m + j][l];
+          }
+        }
+        op(X.data(), W.data(), _n, k);
+        _matvecs += k;
+        _AV.resize(m + k, std::vector < prec >(_n));
+        for (size_t l = 0; l < _n; ++l) {
+          for (int j = 0; j < k; ++j) {
+            _AV[m + j][l] = W[l * k + j];
+          }
+        }
+        /// extend the projected matrix
+        int mk = m + k;
+        std::vector < double > G(mk * mk, 0.0);
+        for (int i = 0; i < m; ++i) {
+          std::copy(_G.begin() + i * m, _G.begin() + (i + 1) * m, G.begin() + i * mk);
+        }
+        std::vector < double > h(mk * k, 0.0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (int ij = 0; ij < mk * k; ++ij) {
+          h[ij] = local_dot(_V[ij / k], _AV[m + ij % k]);
+        }
+        sum(h.data(), mk * k);
+        for (int i = 0; i < mk; ++i) {
+          for (int j = 0; j < k; ++j) {
+            if (i < m + j) {
+              G[i * mk + m + j] = G[(m + j) * mk + i] = h[i * k + j];
+            } else if (i == m + j) {
+              G[i * mk + i] = h[i * k + j];
+            }
+          }
+        }
+        _G.swap(G);
+      }
+
+      /**
+       * Compute the Ritz vectors and the residual vectors of the nev lowest Ritz pairs
+       */
+      void residuals(const std::vector < double > &Y, const std::vector < double > &theta, int m, std::vector < std::vector < prec > > &X,
+                     std::vector < std::vector < prec > > &R) const {
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        {
+          std::vector < double > x(_nev), ax(_nev);
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+          for (long long l = 0; l < (long long) (_n); ++l) {
+            std::fill(x.begin(), x.end(), 0.0);
+            std::fill(ax.begin(), ax.end(), 0.0);
+            for (int j = 0; j < m; ++j) {
+              double vj = _V[j][l];
+              double avj = _AV[j][l];
+              for (int i = 0; i < _nev; ++i) {
+                x[i] += vj * Y[j * m + i];
+                ax[i] += avj * Y[j * m + i];
+              }
+            }
+            for (int i = 0; i < _nev; ++i) {
+              X[i][l] = prec(x[i]);
+              R[i][l] = prec(ax[i] - theta[i] * x[i]);
+            }
+          }
+        }
+      }
+
+      /**
+       * Restart with the lowest Ritz vectors and the Ritz vectors of the previous iteration orthogonalized against them,
+       * which keep the direction of the convergence (A. Stathopoulos, SIAM J. Sci. Comput. 29, 481 (2007)). The products
+       * of the matrix with the new basis are either recombined from the stored ones or computed anew. The round-off of
+       * the recombined products accumulates over the restarts, so the residuals are accurate only after the refresh.
+       *
+       * @param Y - Ritz vectors in the current basis
+       * @param m - size of the current basis
+       * @param Yprev - Ritz vectors of the previous iteration in the first mprev vectors of the current basis
+       * @param mprev - size of the basis of the previous iteration
+       * @param refresh - compute the products of the matrix with the new basis
+       */
+      void restart(const BlockOperator &op, const Reduction &sum, const std::vector < double > &Y, int m,
+                   const std::vector < double > &Yprev, int mprev, bool refresh) {
+        int kr = std::min(m, _keep - (mprev > 0 ? _nev : 0));
+        /// coefficients of the new basis vectors, the columns are orthonormal
+        std::vector < std::vector < double > > columns;
+        for (int i = 0; i < kr; ++i) {
+          std::vector < double > c(m);
+          for (int j = 0; j < m; ++j) {
+            c[j] = Y[j * m + i];
+          }
+          columns.push_back(c);
+        }
+        for (int i = 0; i < _nev && mprev > 0; ++i) {
+          std::vector < double > c(m, 0.0);
+          for (int j = 0; j < mprev; ++j) {
+            c[j] = Yprev[j * _nev + i];
+          }
+          for (int pass = 0; pass < 2; ++pass) {
+            for (size_t b = 0; b < columns.size(); ++b) {
+              double overlap = std::inner_product(c.begin(), c.end(), columns[b].begin(), 0.0);
+              for (int j = 0; j < m; ++j) {
+                c[j] -= overlap * columns[b][j];
+              }
+            }
+          }
+          double nrm = std::sqrt(std::inner_product(c.begin(), c.end(), c.begin(), 0.0));
+          if (nrm < 1e-8) {
+            continue;
+          }
+          for (int j = 0; j < m; ++j) {
+            c[j] /= nrm;
+          }
+          columns.push_back(c);
+        }
+        int k = int(columns.size());
+        std::vector < double > C(m * k);
+        for (int i = 0; i < k; ++i) {
+          for (int j = 0; j < m; ++j) {
+            C[j * k + i] = columns[i][j];
+          }
+        }
+        std::vector < std::vector < prec > > V(k, std::vector < prec >(_n));
+        transform(_V, C, m, k, k, V);
+        if (refresh) {
+          /// the orthogonality of the basis is also lost gradually by the recombinations
+          _V.clear();
+          _AV.clear();
+          _G.clear();
+          extend(op, sum, V, Projection());
+          return;
+        }
+        _V.swap(V);
+        std::vector < std::vector < prec > > AV(k, std::vector < prec >(_n));
+        transform(_AV, C, m, k, k, AV);
+        _AV.swap(AV);
+        /// G = C^T G C
+        std::vector < double > GC(m * k, 0.0), G(k * k, 0.0);
+        for (int j = 0; j < m; ++j) {
+          for (int l = 0; l < m; ++l) {
+            for (int i = 0; i < k; ++i) {
+              GC[j * k + i] += _G[j * m + l] * C[l * k + i];
+            }
+          }
+        }
+        for (int i = 0; i < k; ++i) {
+          for (int i2 = 0; i2 < k; ++i2) {
+            for (int j = 0; j < m; ++j) {
+              G[i * k + i2] += C[j * k + i] * GC[j * k + i2];
+            }
+          }
+        }
+        _G.swap(G);
+      }
+
+      /**
+       * Compute k vectors Z_i = sum_j X_j Y_ji, where Y is stored row-major with the leading dimension ld
+       */
+      void transform(const std::vector < std::vector < prec > > &X, const std::vector < double > &Y, int m, int ld, int k, std::vector < std::vector < prec > > &Z) const {
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        {
+          std::vector < double > row(k);
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+          for (long long l = 0; l < (long long) (_n); ++l) {
+            std::fill(row.begin(), row.end(), 0.0);
+            for (int j = 0; j < m; ++j) {
+              double xj = X[j][l];
+              for (int i = 0; i < k; ++i) {
+                row[i] += xj * Y[j * ld + i];
+              }
+            }
+            for (int i = 0; i < k; ++i) {
+              Z[i][l] = prec(row[i]);
+            }
+          }
+        }
+      }
+    };
+
+  }
+}
+
+#endif //HUBBARD_BLOCKDAVIDSON_H
@@ -6,14 +6,26 @@
 #define HUBBARD_CRSSTORAGE_H
 
 
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
 #include <vector>
 #include <iomanip>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "fortranbinding.h"
 #include "Storage.h"
+#include "RowAccumulator.h"
+#include "UninitializedAllocator.h"
 
 namespace EDLib {
   namespace Storage {
-    template<class Model>
+    /**
+     * @tparam Model - model to diagonalize, its precision is used for the vectors and the eigensolver
+     * @tparam value_prec - precision of the stored matrix elements
+     */
+    template<class Model, typename value_prec = typename Model::precision>
     class CRSStorage : public Storage < typename Model::precision > {
       typedef typename Model::precision prec;
       using Storage < prec >::n;
@@ -24,56 +36,146 @@ namespace EDLib {
 #else
       CRSStorage(alps::params &p, Model &s) : Storage < prec >(p),
 #endif
-                                          _vind(0), _model(s) {
-        _max_size = p["storage.MAX_SIZE"];
-        _max_dim = p["storage.MAX_DIM"];
+                                          _model(s), _nthreads(1), _row_offset(2, 0) {
         // init what you need from parameters
       };
 
       void reset() {
         _model.symmetry().init();
-        size_t sector_size = _model.symmetry().sector().size();
-        if (sector_size > _max_dim) {
-          std::stringstream s;
-          s << "Current sector request more memory than allocated. Increase MAX_DIM parameter. Requested " << sector_size << ", allocated " << _max_dim << ".";
-          throw std::runtime_error(s.str().c_str());
+        /// rows and columns of the matrix are indexed by 32-bit integers
+        if (_model.symmetry().sector().size() > size_t(INT_MAX)) {
+          throw std::overflow_error("Sectors larger than 2^31 require the distributed SpinResolvedStorage.");
+        }
+        n() = _model.symmetry().sector().size();
+        ntot() = n();
+      }
+
+      /**
+       * Compressed-Row-Storage Matrix-Vector product.
+       * Each thread computes the rows it has filled during the matrix construction.
+       */
+      virtual void av(prec *v, prec *w, size_t n, bool clear = true) {
+#ifdef _OPENMP
+#pragma omp parallel num_threads(_nthreads)
+        {
+          int myid = omp_get_thread_num();
+          int nthreads = omp_get_num_threads();
+#else
+        {
+          int myid = 0;
+          int nthreads = 1;
+#endif
+          for (int tid = myid; tid < _nthreads; tid += nthreads) {
+            int last = int(std::min(size_t(_row_offset[tid + 1]), n));
+            for (int i = _row_offset[tid]; i < last; ++i) {
+              prec wi = clear ? prec(0.0) : w[i];
+              for (size_t j = row_ptr[i]; j < row_ptr[i + 1]; ++j) {
+                wi += prec(values[j]) * v[col_ind[j]];
+              }
+              w[i] = wi;
+            }
+          }
         }
-        _vind = 0;
-        row_ptr.assign(_max_dim + 1, 0);
-        col_ind.assign(_max_size, 0);
-        values.assign(_max_size, prec(0.0));
-        n() = 0;
       }
 
       /**
-       * Simple Compressed-Row-Storage Matrix-Vector product
+       * Compressed-Row-Storage product with k vectors in the interleaved layout, V[i * k + j] is the i-th element
+       * of the j-th vector. Each matrix element is loaded once for all k vectors.
        */
-      virtual void av(prec *v, prec *w, int n, bool clear = true) {
-        for (int i = 0; i < n; ++i) {
-          w[i] = clear ? 0.0 : w[i];
-          for (int j = row_ptr[i]; j < row_ptr[i + 1]; ++j) {
-            w[i] = w[i] + values[j] * v[col_ind[j]];
+      virtual void av_block(const prec *V, prec *W, size_t n, int k) {
+#ifdef _OPENMP
+#pragma omp parallel num_threads(_nthreads)
+        {
+          int myid = omp_get_thread_num();
+          int nthreads = omp_get_num_threads();
+#else
+        {
+          int myid = 0;
+          int nthreads = 1;
+#endif
+          std::vector < prec > acc(k);
+          for (int tid = myid; tid < _nthreads; tid += nthreads) {
+            int last = int(std::min(size_t(_row_offset[tid + 1]), n));
+            for (int i = _row_offset[tid]; i < last; ++i) {
+              std::fill(acc.begin(), acc.end(), prec(0.0));
+              for (size_t j = row_ptr[i]; j < row_ptr[i + 1]; ++j) {
+                prec value = values[j];
+                const prec *vj = V + size_t(col_ind[j]) * k;
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+                for (int l = 0; l < k; ++l) {
+                  acc[l] += value * vj[l];
+                }
+              }
+              std::copy(acc.begin(), acc.end(), W + size_t(i) * k);
+            }
           }
         }
       }
 
+      /**
+       * Two-pass construction of the CRS matrix for the current sector.
+       * First count the number of non-zero elements in each row, then allocate exactly
+       * the required amount of memory and fill the arrays.
+       * Rows are split between threads so that each thread gets the same number of non-zero elements.
+       * Arrays are left uninitialized after allocation, so the memory pages are first touched
+       * by the threads that use them in av().
+       */
       void fill() {
         reset();
-        int i = 0;
-        long long k = 0;
-        int isign = 0;
-        while (_model.symmetry().next_state()) {
-          long long nst = _model.symmetry().state();
-          /// Compute diagonal element for current i state
-          addDiagonal(i, _model.diagonal(nst));
-          /// non-diagonal terms calculation
-          /// hoppings
-          off_diagonal<decltype(_model.T_states())>(nst, i, _model.T_states());
-          /// interactions
-          off_diagonal<decltype(_model.V_states())>(nst, i, _model.V_states());
-          i++;
+        int sector_size = n();
+#ifdef _OPENMP
+        _nthreads = omp_get_max_threads();
+#endif
+        row_pointer_type(sector_size + 1).swap(row_ptr);
+        row_ptr[0] = 0;
+        /// first pass: count non-zero elements in each row
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        {
+          RowAccumulator < prec > row;
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+          for (int i = 0; i < sector_size; ++i) {
+            assemble_row(i, row);
+            row_ptr[i + 1] = row.size();
+          }
+        }
+        for (int i = 0; i < sector_size; ++i) {
+          row_ptr[i + 1] += row_ptr[i];
+        }
+        /// split rows between threads
+        size_t nnz = row_ptr[sector_size];
+        _row_offset.assign(_nthreads + 1, sector_size);
+        for (int tid = 0; tid < _nthreads; ++tid) {
+          size_t target = nnz * tid / _nthreads;
+          _row_offset[tid] = int(std::lower_bound(row_ptr.begin(), row_ptr.begin() + sector_size, target) - row_ptr.begin());
+        }
+        /// allocate memory for the current sector only
+        row_index_type(nnz).swap(col_ind);
+        value_type(nnz).swap(values);
+        /// second pass: fill CRS arrays
+#ifdef _OPENMP
+#pragma omp parallel num_threads(_nthreads)
+        {
+          int myid = omp_get_thread_num();
+          int nthreads = omp_get_num_threads();
+#else
+        {
+          int myid = 0;
+          int nthreads = 1;
+#endif
+          RowAccumulator < prec > row;
+          for (int tid = myid; tid < _nthreads; tid += nthreads) {
+            for (int i = _row_offset[tid]; i < _row_offset[tid + 1]; ++i) {
+              assemble_row(i, row);
+              row.flush(col_ind.data() + row_ptr[i], values.data() + row_ptr[i]);
+            }
+          }
         }
-        endMatrix();
       }
 
       void print() {
@@ -83,7 +185,7 @@ namespace EDLib {
           std::cout << "{";
           for (int j = 0; j < n(); ++j) {
             bool f = true;
-            for (int k = row_ptr[i]; k < row_ptr[i + 1]; ++k) {
+            for (size_t k = row_ptr[i]; k < row_ptr[i + 1]; ++k) {
               if ((col_ind[k]) == j) {
                 std::cout << std::setw(6) << values[k] << (j == n() - 1 ? "" : ", ");
                 f = false;
@@ -105,23 +207,47 @@ namespace EDLib {
         Storage < prec >::eigenvalues()[0] = values[0];
         Storage < prec >::eigenvectors().assign(1, std::vector < prec >(1, prec(1.0)));
       }
+      virtual void diagonal(std::vector < prec > &d) {
+        d.assign(n(), prec(0.0));
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (int i = 0; i < int(n()); ++i) {
+          for (size_t j = row_ptr[i]; j < row_ptr[i + 1]; ++j) {
+            if (col_ind[j] == i) {
+              d[i] = values[j];
+            }
+          }
+        }
+      }
+
+      /**
+       * @return number of stored non-zero elements in the current sector
+       */
+      size_t nnz() {
+        return row_ptr.empty() ? 0 : row_ptr.back();
+      }
       size_t vector_size(typename Model::Sector sector) {
         return sector.size();
       }
       prec vv(const std::vector<prec> & v, const std::vector<prec> & w) {
         prec alf = prec(0.0);
-        for (int k = 0; k < v.size(); ++k) {
+        int size = v.size();
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+:alf) schedule(static)
+#endif
+        for (int k = 0; k < size; ++k) {
           alf += w[k] * v[k];
         }
         return alf;
       }
 
       void a_adag(int iii, const std::vector < prec > &invec, std::vector < prec > &outvec, const typename Model::Sector& next_sec, bool a) {
-        long long k;
+        typename Model::State k;
         int sign;
         int i = 0;
         while (_model.symmetry().next_state()) {
-          long long nst = _model.symmetry().state();
+          typename Model::State nst = _model.symmetry().state();
           if (_model.checkState(nst, iii, _model.max_total_electrons()) == (a ? 1 : 0)) {
             if(a) _model.a(iii, nst, k, sign);
             else _model.adag(iii, nst, k, sign);
@@ -133,74 +259,54 @@ namespace EDLib {
       }
 
     private:
-      std::vector < prec > values;
-      std::vector < int > row_ptr;
-      std::vector < int > col_ind;
-      size_t _max_size;
-      size_t _max_dim;
-
+      typedef std::vector < value_prec, UninitializedAllocator < value_prec > > value_type;
+      typedef std::vector < int, UninitializedAllocator < int > > row_index_type;
+      /// the number of non-zero elements can exceed 2^31 even if the sector dimension does not
+      typedef std::vector < size_t, UninitializedAllocator < size_t > > row_pointer_type;
 
-      size_t _vind;
+      value_type values;
+      row_pointer_type row_ptr;
+      row_index_type col_ind;
 
       Model &_model;
 
-      void inline addDiagonal(const int &i, prec v) {
-        row_ptr[i] = _vind;
-        col_ind[_vind] = i;
-        values[_vind] = v;
-        ++_vind;
-        ++n();
-        ++ntot();
-      }
+      /// number of threads used to build the matrix
+      int _nthreads;
+      /// first row for each thread
+      std::vector < int > _row_offset;
 
       /**
-       * Add off-diagonal H(i,j) element
+       * Collect all non-zero elements of the i-th row
+       *
+       * @param i - row number
+       * @param row - accumulator for the row elements
        */
-      void inline addElement(int i, int j, prec t, int sign) {
-        bool hasstate = false;
-        size_t foundstate = 0;
-        // check that there is no any data on the k state
-        for (size_t iii = row_ptr[i]; iii < _vind; ++iii) {
-          if (col_ind[iii] == j) {
-            hasstate = true;
-            foundstate = iii;
-          }
-        }
-        // In case of multi-orbital Coulomb interaction we can have contribution from different Coulomb interactions
-        if(hasstate) {
-          values[foundstate] += sign * t;
-        } else {
-          // create new element in CRS arrays
-          col_ind[_vind] = j;
-          values[_vind] = sign * t;
-          ++_vind;
-        }
-        if (_vind > _max_size) {
-          std::stringstream s;
-          s << "Current sector request more memory than allocated. Increase MAX_SIZE parameter. Requested " << _vind << ", allocated " << _max_size << ".";
-          throw std::runtime_error(s.str().c_str());
-        }
+      void inline assemble_row(int i, RowAccumulator < prec > &row) {
+        row.reset();
+        typename Model::State nst = _model.symmetry().state_by_index(i);
+        /// Compute diagonal element for current i state
+        row.add(i, _model.diagonal(nst));
+        /// non-diagonal terms calculation
+        /// hoppings
+        off_diagonal<decltype(_model.T_states())>(i, nst, _model.T_states(), row);
+        /// interactions
+        off_diagonal<decltype(_model.V_states())>(i, nst, _model.V_states(), row);
       }
 
       template<typename T_states>
-      inline void off_diagonal(long long nst, int i, T_states states) {
-        long long k = 0;
+      inline void off_diagonal(int i, typename Model::State nst, T_states states, RowAccumulator < prec > &row) {
+        typename Model::State k = 0;
         int isign = 0;
         for (int kkk = 0; kkk < states.size(); ++kkk) {
           /// check that there is transition for current state
           if (_model.valid(states[kkk], nst)) {
             /// set new state
             _model.set(states[kkk], nst, k, isign);
-            int k_index = _model.symmetry().index(k);
-            addElement(i, k_index, states[kkk].value(), isign);
+            /// In case of multi-orbital Coulomb interaction we can have contribution from different Coulomb interactions
+            _model.symmetry().add_element(i, k, prec(isign * states[kkk].value()), row);
           }
         }
       };
-
-      /// update the reference to the matrix end
-      void endMatrix() {
-        row_ptr[n()] = _vind;
-      }
     };
 
   }
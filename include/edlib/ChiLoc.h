@@ -21,7 +21,7 @@ namespace EDLib {
     public:
       SzOperator() {};
       template<class ModelType>
-      precision action(long long state, int iii, const ModelType & model) const {
+      precision action(typename ModelType::State state, int iii, const ModelType & model) const {
         /// 0.5 * (n_up - n_down)
         return 0.5*(model.checkState(state, iii, model.max_total_electrons()) -
                     model.checkState(state, iii + model.orbitals(), model.max_total_electrons()));
@@ -39,7 +39,7 @@ namespace EDLib {
     public:
       NOperator() {};
       template<class ModelType>
-      precision action(long long state, int iii, const ModelType & model) const {
+      precision action(typename ModelType::State state, int iii, const ModelType & model) const {
         /// (n_up + n_down)
         return (model.checkState(state, iii, model.max_total_electrons()) +
                 model.checkState(state, iii + model.orbitals(), model.max_total_electrons()));
@@ -218,12 +218,12 @@ namespace EDLib {
       template<typename Op>
       bool operation(int orbital, const std::vector < precision > &invec, std::vector < precision > &outvec, double &expectation_value, const Op& o) {
         hamiltonian().storage().reset();
-        long long k = 0;
+        typename Hamiltonian::ModelType::State k = 0;
         int sign = 0;
         outvec.assign(hamiltonian().storage().vector_size(_model.symmetry().sector()), 0.0);
         for(int i = 0; i< invec.size(); ++i) {
           _model.symmetry().next_state();
-          long long nst = _model.symmetry().state();
+          typename Hamiltonian::ModelType::State nst = _model.symmetry().state();
           outvec[i] = o.action(nst, orbital, _model) * invec[i];
         };
         double norm = hamiltonian().storage().vv(outvec, outvec);
@@ -6,21 +6,32 @@
 #define HUBBARD_COMBINATION_H
 
 
+#include <cstdint>
 #include <vector>
 
 namespace EDLib {
 
+  /**
+   * @brief Binomial coefficients and enumeration of combinations
+   *
+   * Binomial coefficients are computed with the Pascal triangle in 64-bit unsigned integers, C(n, k) is exact
+   * for n <= 67, so the sector dimensions of up to 64 sites do not overflow.
+   */
   class Combination {
   public:
-    Combination(int N) : _c_n_k(N + 1, std::vector < int >(N + 1, 0)) {
+    Combination(int N) : _c_n_k(N + 1, std::vector < uint64_t >(N + 1, 0)) {
       for (int i = 0; i <= N; ++i) {
-        for (int j = 0; j <= N; ++j) {
-          _c_n_k[i][j] = C_n_k_i(i, j);
+        _c_n_k[i][0] = 1;
+        for (int j = 1; j <= i; ++j) {
+          _c_n_k[i][j] = _c_n_k[i - 1][j - 1] + (j < i ? _c_n_k[i - 1][j] : 0);
         }
       }
     }
 
-    inline int c_n_k(int n, int k) const {
+    /**
+     * @return number of combinations C(n, k), 0 for k > n
+     */
+    inline uint64_t c_n_k(int n, int k) const {
       return _c_n_k[n][k];
     }
 
@@ -50,29 +61,8 @@ namespace EDLib {
     }
 
   private:
-    std::vector < std::vector < int > > _c_n_k;
-
-    /**
-     * Calculate number of combinations:
-     * C_k^n = n!/(k!*(n-k)!)
-     */
-    int C_n_k_i(int n, int k) {
-      if ((n - k) > k) {
-        return variation(n - k + 1, n) / variation(1, k);
-      }
-      return variation(k + 1, n) / variation(1, n - k);
-    }
-
-    /**
-     * Calculate n2!/n1!
-     */
-    int variation(int n1, int n2) {
-      int result = 1;
-      for (int i = n1; i <= n2; i++) {
-        result *= i;
-      }
-      return result;
-    }
+    /// Pascal triangle, C(i, j) for j <= i
+    std::vector < std::vector < uint64_t > > _c_n_k;
   };
 }
 #endif //HUBBARD_COMBINATION_H
@@ -0,0 +1,145 @@
+#ifndef HUBBARD_COMBINATIONINDEX_H
+#define HUBBARD_COMBINATIONINDEX_H
+
+#include <cstddef>
+#include <vector>
+
+namespace EDLib {
+
+  /**
+   * @brief Ranking and unranking of n-bit strings with k set bits
+   *
+   * Bit strings are enumerated in the order of Combination::next_combination, i.e. the lexicographic order of the
+   * sorted lists of the set bit positions, starting from the least significant bit. The rank is
+   *
+   *   rank(b) = sum_{j not in b} C(n - 1 - j, k - i(j) - 1),
+   *
+   * where i(j) is the number of set bits below j. Each term depends only on the bits below j, so the bit string is
+   * split into the lower n/2 and the upper n - n/2 bits and the rank is the sum of two table entries, one for each half.
+   * Tables take (n + 1) * (2^(n/2) + 2^(n - n/2)) integers instead of the 2^n integers of the direct inverse table,
+   * e.g. 204800 integers or about 800 KB for n = 24.
+   * For n > MAX_SPLIT_BITS the tables are not built and the terms are summed over the set bits of the string.
+   */
+  class CombinationIndex {
+  public:
+    /// largest number of bits for the split lookup tables
+    static const int MAX_SPLIT_BITS = 32;
+
+    CombinationIndex(int n) : _n(n), _split(n <= MAX_SPLIT_BITS), _low_bits(n / 2), _high_bits(n - n / 2),
+                              _binom(n + 1, std::vector < long long >(n + 1, 0)) {
+      for (int i = 0; i <= n; ++i) {
+        _binom[i][0] = 1;
+        for (int j = 1; j <= i; ++j) {
+          _binom[i][j] = _binom[i - 1][j - 1] + (j < i ? _binom[i - 1][j] : 0);
+        }
+      }
+      if (!_split) {
+        return;
+      }
+      _low.assign(size_t(n + 1) << _low_bits, 0);
+      _high.assign(size_t(n + 1) << _high_bits, 0);
+      for (int k = 0; k <= n; ++k) {
+        for (long long b = 0; b < (1ll << _low_bits); ++b) {
+          _low[(size_t(k) << _low_bits) + b] = partial_rank(b, 0, _low_bits, k, 0);
+        }
+        for (long long b = 0; b < (1ll << _high_bits); ++b) {
+          /// number of set bits in the lower half
+          int below = k - popcount(b);
+          if (below >= 0 && below <= _low_bits) {
+            _high[(size_t(k) << _high_bits) + b] = partial_rank(b, _low_bits, _high_bits, k, below);
+          }
+        }
+      }
+    }
+
+    /**
+     * @param b - bit string with k set bits
+     * @param k - number of set bits
+     * @return position of the bit string in the list of n-bit strings with k set bits
+     */
+    inline long long index(unsigned long long b, int k) const {
+      if (!_split) {
+        return sparse_rank(b, k);
+      }
+      return _low[(size_t(k) << _low_bits) + (b & ((1ull << _low_bits) - 1))] + _high[(size_t(k) << _high_bits) + (b >> _low_bits)];
+    }
+
+    /**
+     * @param ind - position of the bit string in the list of n-bit strings with k set bits
+     * @param k - number of set bits
+     * @return bit string
+     */
+    inline unsigned long long state(long long ind, int k) const {
+      unsigned long long res = 0;
+      for (int j = 0; j < _n && k > 0; ++j) {
+        long long c = binom(_n - 1 - j, k - 1);
+        if (ind < c) {
+          res |= 1ull << j;
+          --k;
+        } else {
+          ind -= c;
+        }
+      }
+      return res;
+    }
+
+  private:
+    int _n;
+    /// use the split lookup tables
+    bool _split;
+    int _low_bits;
+    int _high_bits;
+    /// binomial coefficients C(i, j) for j <= i
+    std::vector < std::vector < long long > > _binom;
+    /// rank contribution of the lower half for each number of set bits, ranks of at most MAX_SPLIT_BITS bits are below C(32, 16) < 2^31
+    std::vector < int > _low;
+    /// rank contribution of the upper half for each number of set bits
+    std::vector < int > _high;
+
+    inline long long binom(int i, int j) const {
+      return (j < 0 || j > i) ? 0 : _binom[i][j];
+    }
+
+    static int popcount(long long b) {
+      int res = 0;
+      for (; b != 0; b &= b - 1) {
+        ++res;
+      }
+      return res;
+    }
+
+    /**
+     * Rank as C(n, k) - 1 - sum_i C(n - 1 - c_i, k - i + 1) over the set bit positions c_1 < ... < c_k
+     */
+    long long sparse_rank(unsigned long long b, int k) const {
+      long long res = binom(_n, k) - 1;
+      for (int i = 1; b != 0; ++i, b &= b - 1) {
+        res -= binom(_n - 1 - __builtin_ctzll(b), k - i + 1);
+      }
+      return res;
+    }
+
+    /**
+     * Sum the rank terms of the bit positions [shift, shift + bits)
+     *
+     * @param b - bits of the part
+     * @param shift - position of the lowest bit of the part
+     * @param bits - number of bits in the part
+     * @param k - total number of set bits
+     * @param below - number of set bits below the part
+     */
+    int partial_rank(long long b, int shift, int bits, int k, int below) const {
+      int res = 0;
+      for (int j = 0; j < bits; ++j) {
+        if (b & (1ll << j)) {
+          ++below;
+        } else {
+          res += binom(_n - 1 - shift - j, k - below - 1);
+        }
+      }
+      return res;
+    }
+  };
+}
+
+#endif //HUBBARD_COMBINATIONINDEX_H
@@ -16,14 +16,32 @@ namespace EDLib {
     params.define < std::string >("OUTPUT_FILE", "sim.h5", "File with results");
     // Symmetry parameters
     params.define < bool >("arpack.SECTOR", "Read symmetry sectors from file");
+    params.define < int >("lattice.LX", 0, "Length of the periodic cluster along x for the translation symmetry, 0 for the ring of NSITES sites");
+    params.define < int >("lattice.LY", 1, "Length of the periodic cluster along y for the translation symmetry");
     // Storage parameters
     params.define < size_t >("storage.MAX_SIZE", 70000, "Number of eigenvalues to find");
     params.define < size_t >("storage.MAX_DIM", 5000, "Number of eigenvalues to find");
     params.define < int >("storage.EIGENVALUES_ONLY", 0, "Compute only eigenvalues.");
     params.define < int >("spinstorage.ORBITAL_NUMBER", 1, "Number of orbitals with interaction");
+    params.define < std::string >("spinstorage.COMMUNICATION", "RMA", "Remote data exchange in SpinResolvedStorage: RMA (one-sided communications) or NEIGHBOR (non-blocking neighbourhood collectives)");
+    params.define < int >("storage.SECTOR_GROUPS", 1, "Number of groups of CPUs that diagonalize different symmetry sectors simultaneously");
+    params.define < std::string >("storage.EIGENSOLVER", "ARPACK", "Eigensolver for the symmetry sectors: ARPACK, LANCZOS (thick-restart Lanczos) or DAVIDSON (block Davidson)");
+    params.define < int >("storage.FLOAT_KRYLOV", 0, "Store the basis of the thick-restart Lanczos solver in single precision");
+    params.define < size_t >("storage.SERIAL_SECTOR_DIM", 1000, "Sectors with smaller dimension are diagonalized by a single CPU if storage.SECTOR_GROUPS > 1");
     // ARPACK parameters
     params.define < int >("arpack.NEV", 2, "Number of eigenvalues to find");
     params.define < int >("arpack.NCV", "Number of convergent values");
+    params.define < double >("arpack.TOLERANCE", 1e-14, "Relative tolerance of the eigenvalues");
+    params.define < int >("arpack.MAXITER", 1000, "Maximum number of restarts of the eigensolver");
+    params.define < int >("arpack.PRUNE_SECTORS", 0, "Diagonalize only the sectors whose estimated lowest eigenvalue is within the Boltzmann cutoff window");
+    params.define < int >("arpack.SPIN_FLIP", 0, "Diagonalize only nup <= ndown sectors if the model is spin-flip invariant, eigen-pairs of the mirrored sectors are obtained by spin flip");
+    params.define < int >("arpack.PARTICLE_HOLE", 0, "Diagonalize only one sector of each (nup, ndown), (NSITES - nup, NSITES - ndown) pair if the model is particle-hole symmetric, eigen-pairs of the other sector are obtained by particle-hole transformation");
+    params.define < double >("arpack.TARGET_S", -1.0, "Compute only the multiplets with this total spin if the model is SU(2) symmetric, the multiplets are computed in the nup - ndown = -2S sectors and completed by S^+; negative to compute all eigen-pairs");
+    params.define < double >("arpack.SPIN_PENALTY", 1.0, "Energy penalty per unit of S(S+1) for the states with the total spin other than arpack.TARGET_S");
+    params.define < int >("arpack.PRUNE_NLANC", 20, "Number of Lanczos steps for the estimate of the lowest eigenvalue in each sector");
+    params.define < double >("arpack.PRUNE_MARGIN", 0.05, "Safety margin for the estimate of the lowest eigenvalue in each sector as a fraction of the estimated spectral width");
+    params.define < int >("arpack.WARM_START", 0, "Start the eigensolver in each sector from the lowest eigen-vector of the previous diagonalization and reuse its sector pruning decision");
+    params.define < std::string >("arpack.WARM_START_FILE", "", "hdf5 file that keeps the warm start data between the runs, empty to keep it in memory only");
     // Lanczos parameters
     params.define < int >("lanc.NOMEGA", 32, "Number of fermionic frequencies");
     params.define < int >("lanc.EMIN", -3, "Lowest real frequency value");
@@ -12,7 +12,8 @@ namespace EDLib {
 /**
  * @brief FermionicModel base class
  *
- * Define common fermionic routines for binary represented state
+ * Define common fermionic routines for binary represented state. Routines are templated on the integer type
+ * of the state, which is defined by the symmetry of the model.
  *
  * @author iskakoff
  */
@@ -30,8 +31,9 @@ namespace EDLib {
        *
        * @return 0 if state is empty, 1 - otherwise
        */
-      int inline checkState(long long nst, const int &im, int Ip) const {
-        return (int) ((nst & (1ll << (Ip - 1 - im))) >> (Ip - 1 - im));
+      template<typename State>
+      int inline checkState(State nst, const int &im, int Ip) const {
+        return (int) ((nst >> (Ip - 1 - im)) & 1);
       }
       /**
        * @brief Anihilate particle
@@ -40,13 +42,14 @@ namespace EDLib {
        * @param k [out] - resulting state
        * @param isign [out] - fermionic sign
        */
-      void inline a(int i, long long jold, long long &k, int &isign) {
+      template<typename State>
+      void inline a(int i, State jold, State &k, int &isign) {
         long long sign = 0;
         for (int ll = 0; ll < i; ++ll) {
-          sign += ((jold & (1ll << (_Ip - ll - 1))) != 0) ? 1 : 0;
+          sign += ((jold & (State(1) << (_Ip - ll - 1))) != 0) ? 1 : 0;
         }
         isign = (sign % 2) == 0 ? 1 : -1;
-        k = jold - (1ll << (_Ip - i - 1));
+        k = jold - (State(1) << (_Ip - i - 1));
       }
 
       /**
@@ -56,13 +59,14 @@ namespace EDLib {
        * \param k [out] - resulting state
        * \param isign [out] - fermionic sign
        */
-      void inline adag(int i, long long jold, long long &k, int &isign) {
+      template<typename State>
+      void inline adag(int i, State jold, State &k, int &isign) {
         long long sign = 0;
         for (int ll = 0; ll < i; ++ll) {
-          sign += ((jold & (1ll << (_Ip - ll - 1))) != 0) ? 1 : 0;
+          sign += ((jold & (State(1) << (_Ip - ll - 1))) != 0) ? 1 : 0;
         }
         isign = (sign % 2) == 0 ? 1 : -1;
-        k = jold + (1ll << (_Ip - i - 1));
+        k = jold + (State(1) << (_Ip - i - 1));
       }
 
 
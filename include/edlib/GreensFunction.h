@@ -161,7 +161,7 @@ namespace EDLib {
           return false;
         }
         hamiltonian().storage().reset();
-        long long k = 0;
+        typename Hamiltonian::ModelType::State k = 0;
         int sign = 0;
         int nup_new = _model.symmetry().sector().nup() + (1 - spin);
         int ndn_new = _model.symmetry().sector().ndown() + spin;
@@ -194,7 +194,7 @@ namespace EDLib {
           return false;
         }
         hamiltonian().storage().reset();
-        long long k = 0;
+        typename Hamiltonian::ModelType::State k = 0;
         int sign = 0;
         int nup_new = _model.symmetry().sector().nup() - (1 - spin);
         int ndn_new = _model.symmetry().sector().ndown() - spin;
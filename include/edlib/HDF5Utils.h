@@ -12,6 +12,7 @@
  * @author iskakoff
  */
 #include "SzSymmetry.h"
+#include "TranslationSymmetry.h"
 #include "EigenPair.h"
 
 namespace EDLib {
@@ -29,6 +30,15 @@ namespace EDLib {
       ar[path + "/size"]<<s.size();
     }
 
+    template<>
+    void HDF5Utils<typename Symmetry::TranslationSymmetry::Sector>::save(const typename Symmetry::TranslationSymmetry::Sector& s, alps::hdf5::archive & ar, const std::string& path) {
+      ar[path + "/nup"]<<s.nup();
+      ar[path + "/ndown"]<<s.ndown();
+      ar[path + "/kx"]<<s.kx();
+      ar[path + "/ky"]<<s.ky();
+      ar[path + "/size"]<<s.size();
+    }
+
     template<>
     void HDF5Utils<typename Symmetry::NSymmetry::Sector>::save(const typename Symmetry::NSymmetry::Sector& s, alps::hdf5::archive & ar, const std::string& path) {
       ar[path + "/n"]<<s.n();
@@ -5,17 +5,30 @@
 #ifndef HUBBARD_HAMILTONIAN_H
 #define HUBBARD_HAMILTONIAN_H
 
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <random>
 #include <set>
+#include <stdexcept>
 #include <type_traits>
 
 #include <iomanip>
 #include <fstream>
 #include "SpinResolvedStorage.h"
 #include "Symmetry.h"
+#include "ParticleHoleSymmetry.h"
+#include "TotalSpin.h"
 #include "EigenPair.h"
+#include "WarmStart.h"
 #include "HubbardModel.h"
 #include "CRSStorage.h"
 #include "SOCRSStorage.h"
+#include "MatrixFreeStorage.h"
 #include "SingleImpurityAndersonModel.h"
 
 namespace EDLib {
@@ -34,11 +47,36 @@ namespace EDLib {
     Hamiltonian(alps::params &p, MPI_Comm comm) :
       _comm(comm),
       _model(p),
-      _storage(p, _model, comm) {};
+      _storage(p, _model, comm),
+      _params(p),
+      _sector_groups(p["storage.SECTOR_GROUPS"].as<int>()),
+      _serial_sector_dim(p["storage.SERIAL_SECTOR_DIM"].as<size_t>()),
+      _eval_only(p["storage.EIGENVALUES_ONLY"].as<int>() != 0),
+      _spin_flip(p["arpack.SPIN_FLIP"].as<int>() != 0),
+      _particle_hole(p["arpack.PARTICLE_HOLE"].as<int>() != 0),
+      _prune_sectors(p["arpack.PRUNE_SECTORS"].as<int>() != 0),
+      _prune_nlanc(p["arpack.PRUNE_NLANC"].as<int>()),
+      _prune_margin(p["arpack.PRUNE_MARGIN"].as<double>()),
+      _prune_window(-std::log(p["lanc.BOLTZMANN_CUTOFF"].as<double>()) / p["lanc.BETA"].as<double>()),
+      _target_s(p["arpack.TARGET_S"].as<double>()),
+      _spin_penalty(p["arpack.SPIN_PENALTY"].as<double>()),
+      _warm_start(p["arpack.WARM_START"].as<int>() != 0),
+      _warm_start_file(p["arpack.WARM_START_FILE"].as<std::string>()) {};
 #endif
     Hamiltonian(alps::params &p) :
       _model(p),
-      _storage(p, _model) {};
+      _storage(p, _model),
+      _eval_only(p["storage.EIGENVALUES_ONLY"].as<int>() != 0),
+      _spin_flip(p["arpack.SPIN_FLIP"].as<int>() != 0),
+      _particle_hole(p["arpack.PARTICLE_HOLE"].as<int>() != 0),
+      _prune_sectors(p["arpack.PRUNE_SECTORS"].as<int>() != 0),
+      _prune_nlanc(p["arpack.PRUNE_NLANC"].as<int>()),
+      _prune_margin(p["arpack.PRUNE_MARGIN"].as<double>()),
+      _prune_window(-std::log(p["lanc.BOLTZMANN_CUTOFF"].as<double>()) / p["lanc.BETA"].as<double>()),
+      _target_s(p["arpack.TARGET_S"].as<double>()),
+      _spin_penalty(p["arpack.SPIN_PENALTY"].as<double>()),
+      _warm_start(p["arpack.WARM_START"].as<int>() != 0),
+      _warm_start_file(p["arpack.WARM_START_FILE"].as<std::string>()) {};
     /**
      * fill current sector
      */
@@ -56,12 +94,68 @@ namespace EDLib {
       MPI_Comm_rank(_comm, &rank);
 #endif
       int k =0;
+      std::vector < typename Model::Sector > sectors;
       while (_model.symmetry().next_sector()) {
+        sectors.push_back(_model.symmetry().sector());
+      }
+      const std::vector < typename Model::Sector > all_sectors(sectors);
+      if (_warm_start) {
+        load_warm_start(all_sectors);
+      }
+      if (spin_target()) {
+        sectors = spin_sectors(sectors);
+      }
+      /// the partners are searched among the sectors with the target spin only, the representative of the pair has to be diagonalized
+      std::vector < int > sublattice;
+      std::vector < typename Model::Sector > partners;
+      if (_particle_hole && _model.particle_hole_symmetric(sublattice)) {
+        partners = particle_hole_partners(sectors, sublattice, sz_basis());
+      }
+      /// sectors with nup > ndown whose eigen-pairs are obtained by spin flip from the (ndown, nup) sector
+      std::vector < typename Model::Sector > mirrored;
+      if (_spin_flip && _model.spin_flip_symmetric()) {
+        std::vector < typename Model::Sector > independent;
+        for (size_t is = 0; is < sectors.size(); ++is) {
+          if (sectors[is].nup() > sectors[is].ndown() && find_sector(sectors, sectors[is].ndown(), sectors[is].nup()) >= 0) {
+            mirrored.push_back(sectors[is]);
+          } else {
+            independent.push_back(sectors[is]);
+          }
+        }
+        sectors.swap(independent);
+      }
+      if (_prune_sectors) {
+        /// reuse the pruning decision of the previous diagonalization
+        std::vector < typename Model::Sector > selected;
+        if (_warm_start) {
+          selected = _warm.select(sectors);
+        }
+        sectors = selected.empty() ? select_sectors(sectors) : reselect_sectors(sectors, selected);
+        _warm.sectors(sectors);
+      }
+#ifdef USE_MPI
+      if (_sector_groups > 1) {
+        diag_sectors(sectors);
+        /// all sectors have been processed
+        sectors.clear();
+      }
+#endif
+      for (size_t is = 0; is < sectors.size(); ++is) {
+        _model.symmetry().set_sector(sectors[is]);
         fill();
+        if (spin_target()) {
+          spin_projection(_model, _storage, sectors[is], sz_basis());
+        }
+        if (_warm_start) {
+          const std::vector < prec > *start = _warm.vector(sectors[is]);
+          if (start != nullptr && start->size() == _storage.vector_size(sectors[is])) {
+            _storage.start_vector(*start);
+          }
+        }
         /**
          * perform ARPACK call
          */
-        int info = _storage.diag();
+        int info = diag_storage(_storage);
         if (info != 0) {
           /// abnormal return from ARPACK. Eigen-pair have not been computed
 #ifdef USE_MPI
@@ -70,11 +164,32 @@ namespace EDLib {
         } else {
           const std::vector < prec > &evals = _storage.eigenvalues();
           const std::vector < std::vector < prec > > &evecs = _storage.eigenvectors();
+          bool stored = !_warm_start || _eval_only;
           for (int i = 0; i < evals.size(); ++i, ++k) {
-            _eigenpairs.insert(EigenPair < prec, typename Model::Sector >(evals[i], evecs[i], k, _model.symmetry().sector()));
+            if (spin_target() && !has_target_spin(_model, sectors[is], gather_vector(evecs[i], sectors[is]), sz_basis())) {
+              continue;
+            }
+            if (!stored) {
+              _warm.vector(sectors[is], evecs[i], evals[i]);
+              stored = true;
+            }
+            _eigenpairs.insert(EigenPair < prec, typename Model::Sector >(evals[i], _eval_only ? std::vector < prec >(1, prec(0.0)) : evecs[i], k,
+                                                                          _model.symmetry().sector()));
           }
         }
       }
+      if (!mirrored.empty()) {
+        add_mirrored_pairs(mirrored);
+      }
+      if (!partners.empty()) {
+        add_particle_hole_pairs(partners, sublattice, sz_basis());
+      }
+      if (spin_target()) {
+        add_multiplet_members(sz_basis());
+      }
+      if (_warm_start) {
+        save_warm_start(all_sectors);
+      }
 #ifdef USE_MPI
       if (rank == 0){
 #endif
@@ -104,6 +219,14 @@ namespace EDLib {
       return _model;
     }
 
+    /**
+     * Data of the previous diagonalization, can be copied from the Hamiltonian of the previous self-consistency
+     * iteration to warm start the next one
+     */
+    WarmStart < prec > &warm_start() {
+      return _warm;
+    }
+
 #ifdef USE_MPI
     const MPI_Comm& comm() const {
       return _comm;
@@ -122,8 +245,999 @@ namespace EDLib {
      */
     Model _model;
 
+    /// eigen-vectors are not computed
+    bool _eval_only;
+    /// compute only nup <= ndown sectors for spin-flip invariant models
+    bool _spin_flip;
+    /// compute only one sector of each particle-hole pair for particle-hole invariant models
+    bool _particle_hole;
+    /// skip sectors that can not contribute at the current temperature
+    bool _prune_sectors;
+    /// number of Lanczos steps for the lowest eigenvalue estimate
+    int _prune_nlanc;
+    /// safety margin for the lowest eigenvalue estimate as a fraction of the estimated spectral width
+    double _prune_margin;
+    /// energy window above the ground state where Boltzmann factor is larger than cutoff
+    double _prune_window;
+    /// total spin of the multiplets to compute, negative to compute all eigen-pairs
+    double _target_s;
+    /// energy penalty per unit of S(S+1) for the states with other total spin
+    double _spin_penalty;
+    /// start the eigensolver from the eigen-vectors of the previous diagonalization and reuse its pruning decision
+    bool _warm_start;
+    /// hdf5 file that keeps the warm start data between the runs, empty to keep it in memory only
+    std::string _warm_start_file;
+    /// lowest eigen-vectors and selected sectors of the previous diagonalization
+    WarmStart < prec > _warm;
+
+    /**
+     * Read the warm start data from _warm_start_file unless it has been already provided in memory. The file is read
+     * by the first CPU only, each CPU receives the local parts of the vectors of its sectors.
+     *
+     * @param sectors -- all symmetry sectors
+     */
+    void load_warm_start(const std::vector < typename Model::Sector > &sectors) {
+      if (_warm_start_file.empty() || !_warm.empty()) {
+        return;
+      }
+      int rank = 0;
+#ifdef USE_MPI
+      MPI_Comm_rank(_comm, &rank);
+#endif
+      /// complete vectors on the first CPU
+      WarmStart < prec > complete;
+      if (rank == 0 && std::ifstream(_warm_start_file.c_str()).good()) {
+        alps::hdf5::archive ar(_warm_start_file, "r");
+        if (ar.is_data("warm_start/vectors/N")) {
+          complete.load(ar, "warm_start");
+        }
+        ar.close();
+      }
+      std::vector < typename Model::Sector > selected;
+      for (size_t is = 0; is < sectors.size(); ++is) {
+        const std::vector < prec > *vec = complete.vector(sectors[is]);
+        /// 1 if the sector has been selected, 2 if there is a vector of the right size
+        int flags = (complete.selected(sectors[is]) ? 1 : 0) | (vec != nullptr && vec->size() == sectors[is].size() ? 2 : 0);
+        prec eigenvalue = (flags & 2) ? complete.eigenvalue(sectors[is]) : prec(0.0);
+#ifdef USE_MPI
+        MPI_Bcast(&flags, 1, MPI_INT, 0, _comm);
+        MPI_Bcast(&eigenvalue, 1, alps::mpi::detail::mpi_type < prec >(), 0, _comm);
+#endif
+        if (flags & 1) {
+          selected.push_back(sectors[is]);
+        }
+        if (flags & 2) {
+          static const std::vector < prec > empty;
+          _warm.vector(sectors[is], scatter_vector(rank == 0 ? *vec : empty, sectors[is]), eigenvalue);
+        }
+      }
+      _warm.sectors(selected);
+    }
+
+    /**
+     * Write the warm start data into _warm_start_file, the complete vectors are collected on the first CPU only
+     *
+     * @param sectors -- all symmetry sectors
+     */
+    void save_warm_start(const std::vector < typename Model::Sector > &sectors) {
+      if (_warm_start_file.empty()) {
+        return;
+      }
+      int rank = 0;
+#ifdef USE_MPI
+      MPI_Comm_rank(_comm, &rank);
+#endif
+      WarmStart < prec > complete;
+      complete.sectors(_warm.select(sectors));
+      for (size_t is = 0; is < sectors.size(); ++is) {
+        const std::vector < prec > *vec = _warm.vector(sectors[is]);
+        if (vec != nullptr) {
+          std::vector < prec > full = gather_root(*vec, sectors[is]);
+          if (rank == 0) {
+            complete.vector(sectors[is], full, _warm.eigenvalue(sectors[is]));
+          }
+        }
+      }
+      if (rank == 0) {
+        alps::hdf5::archive ar(_warm_start_file, "w");
+        complete.save(ar, "warm_start");
+        ar.close();
+      }
+    }
+
+    /**
+     * @return true if only the multiplets with the total spin _target_s are computed
+     */
+    bool spin_target() const {
+      return _target_s >= 0.0 && _model.su2_symmetric();
+    }
+
+    /**
+     * Each multiplet with the total spin S has exactly one state in the sector with nup - ndown = -2S, so only these
+     * sectors are diagonalized and the (2S+1)-fold copies in the other sectors are not computed. The copies are added
+     * to the eigen-pairs afterwards by add_multiplet_members.
+     *
+     * @param sectors -- all symmetry sectors
+     * @return sectors with Sz = -_target_s
+     */
+    std::vector < typename Model::Sector > spin_sectors(const std::vector < typename Model::Sector > &sectors) const {
+      int twice_s = int(std::lround(2.0 * _target_s));
+      std::vector < typename Model::Sector > result;
+      for (size_t is = 0; is < sectors.size(); ++is) {
+        if (sectors[is].ndown() - sectors[is].nup() == twice_s) {
+          result.push_back(sectors[is]);
+        }
+      }
+      return result;
+    }
+
+    /**
+     * Prepare the next diagonalization of the sector: the ARPACK starting vector is projected onto the states with the
+     * total spin _target_s, and the penalty _spin_penalty * (S^2 - S(S+1)) is added to the Hamiltonian. In the sector
+     * with Sz = -S the penalty is non-negative and vanishes only for the wanted states, so the states with larger
+     * total spin that appear due to the round-off errors are pushed up in the spectrum. The Davidson solver does not
+     * keep the projected starting vector in the subspace, so its basis vectors are projected explicitly.
+     * S^2 couples all spin configurations of the sector, so the penalty is supported only for the storages that keep
+     * complete vectors on each CPU.
+     *
+     * @param model -- model of the storage
+     * @param storage -- storage filled for the sector
+     * @param sector -- current sector
+     */
+    void spin_projection(Model &model, Storage &storage, const typename Model::Sector &sector, std::true_type) {
+      if (storage.vector_size(sector) != sector.size()) {
+        throw std::invalid_argument("arpack.TARGET_S is not supported for the distributed storage, use CRS, SOCRS or MatrixFree storage.");
+      }
+      Symmetry::TotalSpin spin(model.orbitals());
+      std::vector < prec > start(sector.size());
+      /// the same random vector on each CPU
+      std::mt19937 gen(1);
+      std::uniform_real_distribution < double > dist(-1.0, 1.0);
+      for (size_t j = 0; j < start.size(); ++j) {
+        start[j] = prec(dist(gen));
+      }
+      spin.project(model.symmetry(), sector, _target_s, start);
+      storage.start_vector(start);
+      double target = _target_s * (_target_s + 1);
+      double penalty = _spin_penalty;
+      /// S^2 is stored once per sector, so the penalty does not enumerate the basis states in each matrix-vector product
+      std::shared_ptr < std::vector < size_t > > row_ptr = std::make_shared < std::vector < size_t > >();
+      std::shared_ptr < std::vector < size_t > > col_ind = std::make_shared < std::vector < size_t > >();
+      std::shared_ptr < std::vector < prec > > values = std::make_shared < std::vector < prec > >();
+      spin.matrix(model.symmetry(), sector, *row_ptr, *col_ind, *values);
+      storage.shift_operator([row_ptr, col_ind, values, target, penalty] (const prec *v, prec *w, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+          prec s2 = prec(0.0);
+          for (size_t j = (*row_ptr)[i]; j < (*row_ptr)[i + 1]; ++j) {
+            s2 += (*values)[j] * v[(*col_ind)[j]];
+          }
+          w[i] += prec(penalty * (s2 - target * v[i]));
+        }
+      });
+      /// the Davidson corrections are built from the diagonal and leave the subspace, so each of them is projected
+      /// with the Lowdin projector prod_{S' != S} (S^2 - S'(S'+1)) / (S(S+1) - S'(S'+1))
+      int nel = sector.nup() + sector.ndown();
+      std::vector < double > others;
+      for (double sp = 0.5 * std::abs(sector.nup() - sector.ndown()); sp <= 0.5 * std::min(nel, 2 * model.orbitals() - nel) + 1e-8; sp += 1.0) {
+        if (std::abs(sp - _target_s) > 1e-8) {
+          others.push_back(sp * (sp + 1));
+        }
+      }
+      storage.projection_operator([row_ptr, col_ind, values, target, others] (prec *v, size_t n) {
+        std::vector < prec > s2(n);
+        for (size_t k = 0; k < others.size(); ++k) {
+          for (size_t i = 0; i < n; ++i) {
+            prec x = prec(0.0);
+            for (size_t j = (*row_ptr)[i]; j < (*row_ptr)[i + 1]; ++j) {
+              x += (*values)[j] * v[(*col_ind)[j]];
+            }
+            s2[i] = x;
+          }
+          for (size_t i = 0; i < n; ++i) {
+            v[i] = prec((s2[i] - others[k] * v[i]) / (target - others[k]));
+          }
+        }
+      });
+    }
+
+    void spin_projection(Model &, Storage &, const typename Model::Sector &, std::false_type) {
+    }
+
+    /**
+     * Diagonalize the filled sector. The total spin of the eigen-pairs is checked with their eigen-vectors, so they are
+     * computed for _target_s even if only the eigen-values are kept.
+     */
+    int diag_storage(Storage &storage) {
+      int eval_only = storage.eigenvalues_only();
+      if (spin_target()) {
+        storage.eigenvalues_only() = 0;
+      }
+      int info = storage.diag();
+      storage.eigenvalues_only() = eval_only;
+      return info;
+    }
+
+    /**
+     * @param vec -- complete eigen-vector
+     * @return true if the total spin of the eigen-vector is equal to _target_s
+     */
+    bool has_target_spin(Model &model, const typename Model::Sector &sector, const std::vector < prec > &vec, std::true_type) {
+      Symmetry::TotalSpin spin(model.orbitals());
+      return std::abs(spin.expectation(model.symmetry(), sector, vec) - _target_s * (_target_s + 1)) < 1e-3;
+    }
+
+    bool has_target_spin(Model &, const typename Model::Sector &, const std::vector < prec > &, std::false_type) {
+      return true;
+    }
+
+    /**
+     * Estimate the lowest eigenvalue in each sector with a few Lanczos steps and keep only the sectors whose
+     * lower estimate lies within the Boltzmann cutoff window above the smallest upper bound of the ground state energy.
+     *
+     * The selection is a heuristic: the lower estimate is the lowest Ritz value minus its residual norm and minus the
+     * safety margin _prune_margin times the estimated spectral width of the sector, which is not a rigorous bound.
+     * A warning is printed for each skipped sector whose residual norm exceeds the safety margin.
+     *
+     * @param sectors -- all symmetry sectors
+     * @param ground -- known upper bound of the ground state energy
+     * @return sectors to be diagonalized
+     */
+    std::vector < typename Model::Sector > select_sectors(const std::vector < typename Model::Sector > &sectors,
+                                                          prec ground = std::numeric_limits < prec >::max()) {
+      if (sectors.empty()) {
+        return sectors;
+      }
+      std::vector < prec > lower(sectors.size()), upper(sectors.size()), residual(sectors.size()), margin(sectors.size()), width(sectors.size());
+      estimate_sectors(sectors, upper, residual, width);
+      for (size_t is = 0; is < sectors.size(); ++is) {
+        margin[is] = prec(_prune_margin * width[is]);
+        lower[is] = upper[is] - residual[is] - margin[is];
+      }
+      prec emax = std::min(*std::min_element(upper.begin(), upper.end()), ground) + _prune_window;
+      int rank = 0;
+#ifdef USE_MPI
+      MPI_Comm_rank(_comm, &rank);
+#endif
+      std::vector < typename Model::Sector > result;
+      for (size_t is = 0; is < sectors.size(); ++is) {
+        if (lower[is] <= emax) {
+          result.push_back(sectors[is]);
+        } else if (rank == 0) {
+          std::cout << "Skip sector" << sectors[is] << " with estimated lowest eigenvalue " << lower[is] << std::endl;
+          if (residual[is] > margin[is]) {
+            std::cerr << "Warning: the lowest eigenvalue estimate of the skipped sector" << sectors[is] << " has not converged, residual norm "
+                      << residual[is] << ". Increase arpack.PRUNE_NLANC or arpack.PRUNE_MARGIN if the sector is needed." << std::endl;
+          }
+        }
+      }
+      return result;
+    }
+
+    /**
+     * Estimate the lowest eigenvalue of each sector with _prune_nlanc Lanczos steps, see Storage::eigenvalue_estimate.
+     * With several CPU groups the sectors are estimated simultaneously, they are distributed as in diag_sectors.
+     *
+     * @param sectors -- symmetry sectors
+     * @param ritz -- lowest Ritz value of each sector
+     * @param residual -- residual norm of the lowest Ritz pair of each sector
+     * @param width -- estimated spectral width of each sector
+     */
+    void estimate_sectors(const std::vector < typename Model::Sector > &sectors, std::vector < prec > &ritz,
+                          std::vector < prec > &residual, std::vector < prec > &width) {
+#ifdef USE_MPI
+      if (_sector_groups > 1) {
+        int rank;
+        MPI_Comm_rank(_comm, &rank);
+        std::vector < int > group_of, group, owner;
+        schedule_sectors(sectors, group_of, group, owner);
+        /// the estimates are kept by the owners of the sectors and summed up over all CPUs
+        std::vector < double > estimate(3 * sectors.size(), 0.0);
+        MPI_Comm group_comm;
+        MPI_Comm_split(_comm, group_of[rank], rank, &group_comm);
+        {
+          Model model(_params);
+          Storage storage(_params, model, group_comm);
+          for (size_t i = 0; i < sectors.size(); ++i) {
+            if (group[i] == group_of[rank]) {
+              estimate_sector(model, storage, sectors[i], estimate, i, owner[i] == rank);
+            }
+          }
+        }
+        {
+          Model model(_params);
+          Storage storage(_params, model, MPI_COMM_SELF);
+          for (size_t i = 0; i < sectors.size(); ++i) {
+            if (group[i] < 0 && owner[i] == rank) {
+              estimate_sector(model, storage, sectors[i], estimate, i, true);
+            }
+          }
+        }
+        MPI_Comm_free(&group_comm);
+        MPI_Allreduce(MPI_IN_PLACE, estimate.data(), int(estimate.size()), MPI_DOUBLE, MPI_SUM, _comm);
+        for (size_t i = 0; i < sectors.size(); ++i) {
+          ritz[i] = prec(estimate[3 * i]);
+          residual[i] = prec(estimate[3 * i + 1]);
+          width[i] = prec(estimate[3 * i + 2]);
+        }
+        return;
+      }
+#endif
+      for (size_t is = 0; is < sectors.size(); ++is) {
+        estimate_sector(_model, _storage, sectors[is], ritz[is], residual[is], width[is]);
+      }
+    }
+
+    void estimate_sector(Model &model, Storage &storage, const typename Model::Sector &sector, prec &ritz, prec &residual, prec &width) {
+      model.symmetry().set_sector(sector);
+      storage.fill();
+      storage.eigenvalue_estimate(_prune_nlanc, ritz, residual, width);
+    }
+
+#ifdef USE_MPI
+    /**
+     * Estimate the lowest eigenvalue of the i-th sector on the CPUs of the storage, only the owner of the sector keeps the estimate
+     */
+    void estimate_sector(Model &model, Storage &storage, const typename Model::Sector &sector, std::vector < double > &estimate,
+                         size_t i, bool owner) {
+      prec ritz, residual, width;
+      estimate_sector(model, storage, sector, ritz, residual, width);
+      if (owner) {
+        estimate[3 * i] = ritz;
+        estimate[3 * i + 1] = residual;
+        estimate[3 * i + 2] = width;
+      }
+    }
+#endif
+
+    /**
+     * Update the pruning decision of the previous diagonalization. The previously selected sectors are kept. The ground
+     * state may move, so the previously skipped sectors are estimated again and added if they enter the window above
+     * the Rayleigh quotient of the warm start vector of the previous ground state sector, which is an upper bound
+     * of the new ground state energy.
+     *
+     * @param sectors -- all symmetry sectors
+     * @param selected -- sectors selected in the previous diagonalization
+     * @return sectors to be diagonalized in the original order
+     */
+    std::vector < typename Model::Sector > reselect_sectors(const std::vector < typename Model::Sector > &sectors,
+                                                            const std::vector < typename Model::Sector > &selected) {
+      int lowest = -1;
+      for (size_t is = 0; is < selected.size(); ++is) {
+        if (_warm.vector(selected[is]) != nullptr && (lowest < 0 || _warm.eigenvalue(selected[is]) < _warm.eigenvalue(selected[lowest]))) {
+          lowest = int(is);
+        }
+      }
+      int valid = lowest >= 0 && _warm.vector(selected[lowest])->size() == _storage.vector_size(selected[lowest]) ? 1 : 0;
+#ifdef USE_MPI
+      MPI_Allreduce(MPI_IN_PLACE, &valid, 1, MPI_INT, MPI_MIN, _comm);
+#endif
+      /// without the ground state bound the skipped sectors would be compared with each other only, so the pruning is redone
+      if (!valid) {
+        return select_sectors(sectors);
+      }
+      _model.symmetry().set_sector(selected[lowest]);
+      fill();
+      prec ground = _storage.rayleigh_quotient(*_warm.vector(selected[lowest]));
+      std::vector < typename Model::Sector > skipped;
+      for (size_t is = 0; is < sectors.size(); ++is) {
+        if (!_warm.selected(sectors[is])) {
+          skipped.push_back(sectors[is]);
+        }
+      }
+      WarmStart < prec > added;
+      added.sectors(select_sectors(skipped, ground));
+      std::vector < typename Model::Sector > result;
+      for (size_t is = 0; is < sectors.size(); ++is) {
+        if (_warm.selected(sectors[is]) || added.selected(sectors[is])) {
+          result.push_back(sectors[is]);
+        }
+      }
+      return result;
+    }
+
+    /**
+     * @return position of the (nup, ndown) sector in the list or -1
+     */
+    static int find_sector(const std::vector < typename Model::Sector > &sectors, int nup, int ndown) {
+      for (size_t is = 0; is < sectors.size(); ++is) {
+        if (sectors[is].nup() == nup && sectors[is].ndown() == ndown) {
+          return int(is);
+        }
+      }
+      return -1;
+    }
+
+    /**
+     * Add eigen-pairs of the mirrored sectors. Spin flip maps the basis state with spin-up configuration u and spin-down
+     * configuration d of the (nup, ndown) sector to the (d, u) state of the (ndown, nup) sector up to a fermionic sign
+     * (-1)^(nup*ndown), which is the same for all states of the sector, so the eigen-vector is just transposed.
+     *
+     * @param mirrored -- sectors with nup > ndown that have not been diagonalized
+     */
+    void add_mirrored_pairs(const std::vector < typename Model::Sector > &mirrored) {
+      std::vector < EigenPair < prec, typename Model::Sector > > pairs(_eigenpairs.begin(), _eigenpairs.end());
+      int k = _eigenpairs.size();
+      for (size_t is = 0; is < mirrored.size(); ++is) {
+        const typename Model::Sector &sector = mirrored[is];
+        for (size_t ip = 0; ip < pairs.size(); ++ip) {
+          if (pairs[ip].sector().nup() != sector.ndown() || pairs[ip].sector().ndown() != sector.nup()) {
+            continue;
+          }
+          std::vector < prec > vector = flip_spins(pairs[ip].eigenvector(), pairs[ip].sector(), sector);
+          _eigenpairs.insert(EigenPair < prec, typename Model::Sector >(pairs[ip].eigenvalue(), vector, k++, sector));
+        }
+      }
+    }
+
+    /// particle-hole transformation is defined for the sectors of the Sz symmetry only
+    typedef std::is_same < typename Model::SYMMETRY, Symmetry::SzSymmetry > sz_basis;
+
+    /**
+     * Remove the sectors whose particle-hole partner is in the list
+     *
+     * @param sectors -- all symmetry sectors, the partners are removed
+     * @param sublattice -- sublattice of each site
+     * @return sectors that will be obtained by particle-hole transformation
+     */
+    std::vector < typename Model::Sector > particle_hole_partners(std::vector < typename Model::Sector > &sectors, const std::vector < int > &sublattice,
+                                                                  std::true_type) {
+      Symmetry::ParticleHoleSymmetry ph(_model.orbitals(), sublattice);
+      std::vector < typename Model::Sector > independent;
+      std::vector < typename Model::Sector > partners;
+      for (size_t is = 0; is < sectors.size(); ++is) {
+        typename Model::Sector partner = ph.partner(sectors[is]);
+        if (!ph.representative(sectors[is]) && find_sector(sectors, partner.nup(), partner.ndown()) >= 0) {
+          partners.push_back(sectors[is]);
+        } else {
+          independent.push_back(sectors[is]);
+        }
+      }
+      sectors.swap(independent);
+      return partners;
+    }
+
+    std::vector < typename Model::Sector > particle_hole_partners(std::vector < typename Model::Sector > &, const std::vector < int > &, std::false_type) {
+      return std::vector < typename Model::Sector >();
+    }
+
+    void add_particle_hole_pairs(const std::vector < typename Model::Sector > &, const std::vector < int > &, std::false_type) {
+    }
+
+    /**
+     * Add eigen-pairs of the particle-hole partner sectors.
+     *
+     * @param partners -- sectors that have not been diagonalized
+     * @param sublattice -- sublattice of each site
+     */
+    void add_particle_hole_pairs(const std::vector < typename Model::Sector > &partners, const std::vector < int > &sublattice, std::true_type) {
+      Symmetry::ParticleHoleSymmetry ph(_model.orbitals(), sublattice);
+      std::vector < EigenPair < prec, typename Model::Sector > > pairs(_eigenpairs.begin(), _eigenpairs.end());
+      int k = _eigenpairs.size();
+      for (size_t is = 0; is < partners.size(); ++is) {
+        const typename Model::Sector &sector = partners[is];
+        typename Model::Sector partner = ph.partner(sector);
+        for (size_t ip = 0; ip < pairs.size(); ++ip) {
+          if (pairs[ip].sector().nup() != partner.nup() || pairs[ip].sector().ndown() != partner.ndown()) {
+            continue;
+          }
+          std::vector < prec > vector = pairs[ip].eigenvector();
+          if (!_eval_only) {
+            std::vector < prec > transformed;
+            ph.transform(_model.symmetry(), pairs[ip].sector(), gather_vector(vector, pairs[ip].sector()), transformed);
+            vector = local_part(transformed, sector);
+          }
+          _eigenpairs.insert(EigenPair < prec, typename Model::Sector >(pairs[ip].eigenvalue(), vector, k++, sector));
+        }
+      }
+    }
+
+    void add_multiplet_members(std::false_type) {
+    }
+
+    /**
+     * Add the members of the multiplets with Sz > -S. They are obtained from the computed Sz = -S members by S^+, so the
+     * statistical sum and the spin components of the Green's functions include the complete multiplets.
+     */
+    void add_multiplet_members(std::true_type) {
+      Symmetry::TotalSpin spin(_model.orbitals());
+      int twice_s = int(std::lround(2.0 * _target_s));
+      std::vector < EigenPair < prec, typename Model::Sector > > pairs(_eigenpairs.begin(), _eigenpairs.end());
+      int k = _eigenpairs.size();
+      for (size_t ip = 0; ip < pairs.size(); ++ip) {
+        typename Model::Sector sector = pairs[ip].sector();
+        if (sector.ndown() - sector.nup() != twice_s) {
+          continue;
+        }
+        std::vector < prec > vector = _eval_only ? pairs[ip].eigenvector() : gather_vector(pairs[ip].eigenvector(), sector);
+        for (int m = 0; m < twice_s; ++m) {
+          typename Model::Sector next(sector.nup() + 1, sector.ndown() - 1, _model.symmetry().comb().c_n_k(_model.orbitals(), sector.nup() + 1) *
+                                                                            _model.symmetry().comb().c_n_k(_model.orbitals(), sector.ndown() - 1));
+          if (!_eval_only) {
+            std::vector < prec > raised;
+            spin.raise(_model.symmetry(), sector, vector, raised);
+            double norm = 0.0;
+            for (size_t i = 0; i < raised.size(); ++i) {
+              norm += double(raised[i]) * raised[i];
+            }
+            norm = std::sqrt(norm);
+            for (size_t i = 0; i < raised.size(); ++i) {
+              raised[i] = prec(raised[i] / norm);
+            }
+            vector.swap(raised);
+          }
+          sector = next;
+          _eigenpairs.insert(EigenPair < prec, typename Model::Sector >(pairs[ip].eigenvalue(), _eval_only ? vector : local_part(vector, sector), k++, sector));
+        }
+      }
+    }
+
+    /**
+     * Transpose spin-up and spin-down indices of the eigen-vector
+     *
+     * @param vec -- local part of the eigen-vector of the (nup, ndown) sector
+     * @param sector -- (nup, ndown) sector
+     * @param mirror -- (ndown, nup) sector
+     * @return local part of the eigen-vector in the mirrored sector
+     */
+    std::vector < prec > flip_spins(const std::vector < prec > &vec, const typename Model::Sector &sector, const typename Model::Sector &mirror) {
+      if (_eval_only) {
+        return vec;
+      }
+      size_t size = sector.size();
+      size_t up_size = _model.symmetry().comb().c_n_k(_model.orbitals(), sector.nup());
+      size_t down_size = size / up_size;
+      std::vector < prec > full = gather_vector(vec, sector);
+      std::vector < prec > flipped(size);
+      for (size_t iu = 0; iu < up_size; ++iu) {
+        for (size_t id = 0; id < down_size; ++id) {
+          flipped[id * up_size + iu] = full[iu * down_size + id];
+        }
+      }
+      return local_part(flipped, mirror);
+    }
+
+    /**
+     * Collect complete eigen-vector on each CPU
+     *
+     * @param vec -- local part of the eigen-vector
+     * @param sector -- sector of the eigen-vector
+     * @return complete eigen-vector
+     */
+    std::vector < prec > gather_vector(const std::vector < prec > &vec, const typename Model::Sector &sector) {
+#ifdef USE_MPI
+      return gather(_storage, sector, vec, _comm);
+#else
+      return vec;
+#endif
+    }
+
+#ifdef USE_MPI
+    /**
+     * Collect complete vector on each CPU of the storage communicator
+     *
+     * @param storage -- storage that defines the layout of the vector
+     * @param sector -- sector of the vector
+     * @param vec -- local part of the vector
+     * @param comm -- communicator of the storage
+     * @return complete vector
+     */
+    static std::vector < prec > gather(Storage &storage, const typename Model::Sector &sector, const std::vector < prec > &vec, MPI_Comm comm) {
+      std::vector < prec > full(vec.begin(), vec.end());
+      size_t size = sector.size();
+      int nprocs, rank;
+      MPI_Comm_size(comm, &nprocs);
+      MPI_Comm_rank(comm, &rank);
+      unsigned long long local = storage.vector_size(sector);
+      std::vector < unsigned long long > counts(nprocs), displs(nprocs, 0);
+      MPI_Allgather(&local, 1, MPI_UNSIGNED_LONG_LONG, counts.data(), 1, MPI_UNSIGNED_LONG_LONG, comm);
+      std::partial_sum(counts.begin(), counts.end() - 1, displs.begin() + 1);
+      /// collect distributed vector, replicated vectors are complete on each CPU
+      if (displs.back() + counts.back() == size) {
+        full.resize(size);
+        std::copy(vec.begin(), vec.begin() + local, full.begin() + displs[rank]);
+        /// the complete vector can exceed 2^31 elements, so each part is broadcast in chunks with 32-bit counts
+        for (int r = 0; r < nprocs; ++r) {
+          for (unsigned long long done = 0; done < counts[r]; done += (unsigned long long) (INT_MAX)) {
+            int count = int(std::min(counts[r] - done, (unsigned long long) (INT_MAX)));
+            MPI_Bcast(full.data() + displs[r] + done, count, alps::mpi::detail::mpi_type < prec >(), r, comm);
+          }
+        }
+      }
+      return full;
+    }
+#endif
+
+    /**
+     * @param full -- complete eigen-vector
+     * @param sector -- sector of the eigen-vector
+     * @return local part of the eigen-vector in the layout of the main storage
+     */
+    std::vector < prec > local_part(const std::vector < prec > &full, const typename Model::Sector &sector) {
+#ifdef USE_MPI
+      size_t offset = local_offset(_storage, sector, _comm);
+      return std::vector < prec >(full.begin() + offset, full.begin() + offset + _storage.vector_size(sector));
+#else
+      return full;
+#endif
+    }
+
+    /**
+     * Collect complete vector on the first CPU only
+     *
+     * @param vec -- local part of the vector in the layout of the main storage
+     * @param sector -- sector of the vector
+     * @return complete vector on the first CPU, empty vector on the other CPUs
+     */
+    std::vector < prec > gather_root(const std::vector < prec > &vec, const typename Model::Sector &sector) {
+#ifdef USE_MPI
+      int rank;
+      MPI_Comm_rank(_comm, &rank);
+      return redistribute(source_part(vec, sector), local_offset(_storage, sector, _comm), 0, rank == 0 ? sector.size() : 0, _comm);
+#else
+      return vec;
+#endif
+    }
+
+    /**
+     * Distribute complete vector from the first CPU
+     *
+     * @param full -- complete vector on the first CPU, ignored on the other CPUs
+     * @param sector -- sector of the vector
+     * @return local part of the vector in the layout of the main storage
+     */
+    std::vector < prec > scatter_vector(const std::vector < prec > &full, const typename Model::Sector &sector) {
+#ifdef USE_MPI
+      int rank;
+      MPI_Comm_rank(_comm, &rank);
+      static const std::vector < prec > empty;
+      return redistribute(rank == 0 ? full : empty, 0, local_offset(_storage, sector, _comm), _storage.vector_size(sector), _comm);
+#else
+      return full;
+#endif
+    }
+
+#ifdef USE_MPI
+    /**
+     * Each element of the vector has to be sent by exactly one CPU, for the vectors that are complete on each CPU
+     * only the first CPU is the source of the data
+     *
+     * @param vec -- local part of the vector in the layout of the main storage
+     * @param sector -- sector of the vector
+     * @return part of the vector sent by current CPU
+     */
+    const std::vector < prec > &source_part(const std::vector < prec > &vec, const typename Model::Sector &sector) {
+      static const std::vector < prec > empty;
+      int rank;
+      MPI_Comm_rank(_comm, &rank);
+      size_t local = _storage.vector_size(sector);
+      return vec.size() == local && (local != sector.size() || rank == 0) ? vec : empty;
+    }
+
+    /**
+     * @param storage -- storage that defines the layout of the vectors
+     * @param sector -- sector of the vector
+     * @param comm -- communicator of the storage
+     * @return offset of the local part of the vector, 0 for the vectors that are complete on each CPU
+     */
+    static size_t local_offset(Storage &storage, const typename Model::Sector &sector, MPI_Comm comm) {
+      unsigned long long local = storage.vector_size(sector);
+      unsigned long long offset = 0;
+      MPI_Exscan(&local, &offset, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, comm);
+      int rank;
+      MPI_Comm_rank(comm, &rank);
+      if (rank == 0 || local == sector.size()) {
+        offset = 0;
+      }
+      return offset;
+    }
+#endif
+
 #ifdef USE_MPI
     MPI_Comm _comm;
+    /// parameters for the models and storages of the CPU groups
+    alps::params _params;
+    /// number of CPU groups for parallel diagonalization of symmetry sectors
+    int _sector_groups;
+    /// sectors with smaller dimension are diagonalized by a single CPU
+    size_t _serial_sector_dim;
+
+    /// number of basis states used to estimate the number of non-zero elements of the sector Hamiltonian
+    static const size_t NNZ_SAMPLES = 64;
+
+    /// eigen-pairs of the sector diagonalized by a group of CPUs
+    struct SectorResult {
+      /// eigen-values, kept by the first CPU of the group only
+      std::vector < prec > evals;
+      /// local parts of the eigen-vectors in the layout of the group storage
+      std::vector < std::vector < prec > > evecs;
+      /// offset of the local parts
+      size_t offset;
+    };
+
+    /**
+     * Distribute the sectors over the CPU groups.
+     *
+     * CPUs are split into _sector_groups groups of consecutive ranks, each group has its own copy of the model and storage.
+     * Sectors are sorted by the estimated cost (estimated number of non-zero elements of the sector Hamiltonian) and
+     * assigned largest first to the least loaded group. Sectors smaller than _serial_sector_dim are assigned
+     * to the least loaded single CPUs afterwards, as are all sectors if the storage keeps complete vectors on each CPU.
+     *
+     * @param sectors -- symmetry sectors
+     * @param group_of -- group of each CPU
+     * @param group -- group of CPUs that processes each sector, -1 for sectors processed by a single CPU
+     * @param owner -- CPU that keeps the results for each sector
+     */
+    void schedule_sectors(const std::vector < typename Model::Sector > &sectors, std::vector < int > &group_of,
+                          std::vector < int > &group, std::vector < int > &owner) {
+      int nprocs;
+      MPI_Comm_size(_comm, &nprocs);
+      int ngroups = std::min(_sector_groups, nprocs);
+      std::vector < double > cost(sectors.size());
+      for (size_t i = 0; i < sectors.size(); ++i) {
+        cost[i] = estimate_nnz(sectors[i]);
+      }
+      std::vector < size_t > order(sectors.size());
+      std::iota(order.begin(), order.end(), 0);
+      std::stable_sort(order.begin(), order.end(), [&cost](size_t a, size_t b) { return cost[a] > cost[b]; });
+      /// group of consecutive ranks for each CPU and the first CPU of each group
+      std::vector < int > group_size(ngroups, 0), group_root(ngroups, nprocs);
+      group_of.assign(nprocs, 0);
+      for (int r = 0; r < nprocs; ++r) {
+        group_of[r] = int((long long) (r) * ngroups / nprocs);
+        group_size[group_of[r]] += 1;
+        group_root[group_of[r]] = std::min(group_root[group_of[r]], r);
+      }
+      group.assign(sectors.size(), -1);
+      owner.assign(sectors.size(), 0);
+      /// storages that keep complete vectors on each CPU do not benefit from groups, all sectors go to single CPUs.
+      /// The local vector size differs between CPUs, so all of them have to agree on the schedule.
+      int local_replicated = nprocs == 1 || (!sectors.empty() && _storage.vector_size(sectors[order[0]]) == sectors[order[0]].size());
+      int all_replicated = local_replicated;
+      MPI_Allreduce(&local_replicated, &all_replicated, 1, MPI_INT, MPI_LAND, _comm);
+      bool replicated = all_replicated != 0;
+      std::vector < double > group_load(ngroups, 0.0);
+      for (size_t i : order) {
+        if (replicated || sectors[i].size() < _serial_sector_dim) continue;
+        int g = int(std::min_element(group_load.begin(), group_load.end()) - group_load.begin());
+        group[i] = g;
+        owner[i] = group_root[g];
+        group_load[g] += cost[i];
+      }
+      std::vector < double > cpu_load(nprocs);
+      for (int r = 0; r < nprocs; ++r) {
+        cpu_load[r] = group_load[group_of[r]] / group_size[group_of[r]];
+      }
+      for (size_t i : order) {
+        if (group[i] >= 0) continue;
+        int r = int(std::min_element(cpu_load.begin(), cpu_load.end()) - cpu_load.begin());
+        owner[i] = r;
+        cpu_load[r] += cost[i];
+      }
+    }
+
+    /**
+     * Diagonalize independent symmetry sectors simultaneously, the sectors are distributed by schedule_sectors.
+     *
+     * Each CPU of the group keeps its part of the eigen-vectors, the parts are sent directly to the CPUs that keep
+     * the corresponding parts in the layout of the main storage, so the resulting eigen-pairs are the same as for
+     * the sequential diagonalization and no CPU keeps a complete vector unless the main storage does.
+     */
+    void diag_sectors(const std::vector < typename Model::Sector > &sectors) {
+      int rank;
+      MPI_Comm_rank(_comm, &rank);
+      std::vector < int > group_of, group, owner;
+      schedule_sectors(sectors, group_of, group, owner);
+      /// eigen-pairs of the sectors computed by current CPU
+      std::map < size_t, SectorResult > results;
+      MPI_Comm group_comm;
+      MPI_Comm_split(_comm, group_of[rank], rank, &group_comm);
+      /// local parts of the warm start vectors in the layout of the storages that diagonalize the sectors
+      std::map < size_t, std::vector < prec > > starts;
+      if (_warm_start) {
+        std::vector < size_t > start_offset(sectors.size(), 0), start_size(sectors.size(), 0);
+        {
+          /// the layout does not depend on the matrix, so the storage is not filled
+          Model model(_params);
+          Storage storage(_params, model, group_comm);
+          for (size_t i = 0; i < sectors.size(); ++i) {
+            if (group[i] == group_of[rank]) {
+              start_size[i] = storage.vector_size(sectors[i]);
+              start_offset[i] = local_offset(storage, sectors[i], group_comm);
+            }
+          }
+        }
+        for (size_t i = 0; i < sectors.size(); ++i) {
+          if (group[i] < 0 && owner[i] == rank) {
+            start_size[i] = sectors[i].size();
+          }
+          const std::vector < prec > *start = _warm.vector(sectors[i]);
+          if (start != nullptr) {
+            starts[i] = redistribute(source_part(*start, sectors[i]), local_offset(_storage, sectors[i], _comm), start_offset[i], start_size[i], _comm);
+          }
+        }
+      }
+      {
+        Model model(_params);
+        Storage storage(_params, model, group_comm);
+        for (size_t i = 0; i < sectors.size(); ++i) {
+          if (group[i] == group_of[rank]) {
+            diag_sector(model, storage, sectors[i], group_comm, _eval_only, starts[i], results, i);
+          }
+        }
+      }
+      {
+        Model model(_params);
+        Storage storage(_params, model, MPI_COMM_SELF);
+        for (size_t i = 0; i < sectors.size(); ++i) {
+          if (group[i] < 0 && owner[i] == rank) {
+            diag_sector(model, storage, sectors[i], MPI_COMM_SELF, _eval_only, starts[i], results, i);
+          }
+        }
+      }
+      MPI_Comm_free(&group_comm);
+      /// merge eigen-pairs in the original order of sectors
+      int k = 0;
+      for (size_t i = 0; i < sectors.size(); ++i) {
+        typename std::map < size_t, SectorResult >::iterator result = results.find(i);
+        int nconv = -1;
+        if (owner[i] == rank && result != results.end()) {
+          nconv = int(result->second.evals.size());
+        }
+        MPI_Bcast(&nconv, 1, MPI_INT, owner[i], _comm);
+        if (nconv < 0) {
+          /// abnormal return from ARPACK. Eigen-pair have not been computed
+          if (rank == 0) std::cerr<<"Eigenvalue have not been computed."<<std::endl;
+          continue;
+        }
+        bool stored = !_warm_start || _eval_only;
+        std::vector < prec > values(nconv);
+        if (owner[i] == rank) {
+          values = result->second.evals;
+        }
+        MPI_Bcast(values.data(), nconv, alps::mpi::detail::mpi_type < prec >(), owner[i], _comm);
+        /// local part of the eigen-vector in the layout of the main storage
+        size_t local = _storage.vector_size(sectors[i]);
+        size_t offset = local_offset(_storage, sectors[i], _comm);
+        for (int j = 0; j < nconv; ++j, ++k) {
+          std::vector < prec > vector;
+          if (!_eval_only) {
+            static const std::vector < prec > empty;
+            bool source = result != results.end();
+            vector = redistribute(source ? result->second.evecs[j] : empty, source ? result->second.offset : 0, offset, local, _comm);
+            if (!stored) {
+              _warm.vector(sectors[i], vector, values[j]);
+              stored = true;
+            }
+          }
+          _eigenpairs.insert(EigenPair < prec, typename Model::Sector >(values[j], vector, k, sectors[i]));
+        }
+      }
+    }
+
+    /**
+     * Diagonalize single sector on the group of CPUs. Each CPU of the group keeps the local parts of the eigen-vectors,
+     * the eigen-values are kept by the first CPU of the group. If only the multiplets with the target total spin are
+     * computed the other eigen-pairs are dropped here.
+     *
+     * @param start -- local part of the starting vector in the layout of the group storage or empty vector
+     */
+    void diag_sector(Model &model, Storage &storage, const typename Model::Sector &sector, MPI_Comm comm, bool eval_only,
+                     const std::vector < prec > &start, std::map < size_t, SectorResult > &results, size_t id) {
+      int rank;
+      MPI_Comm_rank(comm, &rank);
+      model.symmetry().set_sector(sector);
+      storage.fill();
+      size_t offset = local_offset(storage, sector, comm);
+      if (spin_target()) {
+        spin_projection(model, storage, sector, sz_basis());
+      }
+      if (!start.empty()) {
+        storage.start_vector(start);
+      }
+      int info = diag_storage(storage);
+      if (info != 0) {
+        return;
+      }
+      SectorResult &result = results[id];
+      result.offset = offset;
+      size_t local = storage.vector_size(sector);
+      /// for the replicated eigen-vectors only the first CPU of the group is the source of the data
+      bool source = local != sector.size() || rank == 0;
+      for (size_t j = 0; j < storage.eigenvalues().size(); ++j) {
+        if (spin_target() && !has_target_spin(model, sector, gather(storage, sector, storage.eigenvectors()[j], comm), sz_basis())) {
+          continue;
+        }
+        if (!eval_only) {
+          result.evecs.push_back(std::vector < prec >());
+          if (source) {
+            result.evecs.back().assign(storage.eigenvectors()[j].begin(), storage.eigenvectors()[j].begin() + local);
+          }
+        }
+        if (rank == 0) {
+          result.evals.push_back(storage.eigenvalues()[j]);
+        }
+      }
+    }
+
+    /**
+     * Estimate the number of non-zero elements of the sector Hamiltonian from the number of transitions
+     * from NNZ_SAMPLES evenly spaced basis states. The estimate does not need any communications.
+     */
+    double estimate_nnz(const typename Model::Sector &sector) {
+      size_t size = sector.size();
+      if (size == 0) {
+        return 0.0;
+      }
+      _model.symmetry().set_sector(sector);
+      size_t samples = std::min(size, NNZ_SAMPLES);
+      double transitions = 0.0;
+      for (size_t s = 0; s < samples; ++s) {
+        typename Model::State nst = _model.symmetry().state_by_index(s * size / samples);
+        transitions += count_transitions(_model.T_states(), nst) + count_transitions(_model.V_states(), nst);
+      }
+      return size * (1.0 + transitions / samples);
+    }
+
+    template<typename States>
+    size_t count_transitions(const States &states, typename Model::State nst) {
+      size_t result = 0;
+      for (size_t kkk = 0; kkk < states.size(); ++kkk) {
+        result += _model.valid(states[kkk], nst) ? 1 : 0;
+      }
+      return result;
+    }
+
+    /**
+     * Move the vector between two layouts. Each CPU holds the part [src_offset, src_offset + src.size()) of the vector in
+     * the source layout and receives the part [dst_offset, dst_offset + dst_size) of the target layout. Each element has
+     * to be held by exactly one CPU in the source layout, the parts of the target layout may overlap.
+     *
+     * @param src -- local part of the vector in the source layout
+     * @param src_offset -- offset of the local part in the source layout
+     * @param dst_offset -- offset of the local part in the target layout
+     * @param dst_size -- size of the local part in the target layout
+     * @param comm -- communicator of both layouts
+     * @return local part of the vector in the target layout
+     */
+    static std::vector < prec > redistribute(const std::vector < prec > &src, size_t src_offset, size_t dst_offset, size_t dst_size, MPI_Comm comm) {
+      int nprocs;
+      MPI_Comm_size(comm, &nprocs);
+      unsigned long long range[4] = {src_offset, src_offset + src.size(), dst_offset, dst_offset + dst_size};
+      std::vector < unsigned long long > ranges(4 * nprocs);
+      MPI_Allgather(range, 4, MPI_UNSIGNED_LONG_LONG, ranges.data(), 4, MPI_UNSIGNED_LONG_LONG, comm);
+      std::vector < int > send_counts(nprocs, 0), send_displs(nprocs, 0), recv_counts(nprocs, 0), recv_displs(nprocs, 0);
+      for (int r = 0; r < nprocs; ++r) {
+        /// intersection of the local source part with the target part of r-th CPU
+        unsigned long long begin = std::max(range[0], ranges[4 * r + 2]);
+        unsigned long long end = std::min(range[1], ranges[4 * r + 3]);
+        if (begin < end) {
+          send_counts[r] = mpi_count(end - begin);
+          send_displs[r] = mpi_count(begin - range[0]);
+        }
+        /// intersection of the source part of r-th CPU with the local target part
+        begin = std::max(ranges[4 * r], range[2]);
+        end = std::min(ranges[4 * r + 1], range[3]);
+        if (begin < end) {
+          recv_counts[r] = mpi_count(end - begin);
+          recv_displs[r] = mpi_count(begin - range[2]);
+        }
+      }
+      std::vector < prec > dst(dst_size);
+      MPI_Alltoallv(src.data(), send_counts.data(), send_displs.data(), alps::mpi::detail::mpi_type < prec >(),
+                    dst.data(), recv_counts.data(), recv_displs.data(), alps::mpi::detail::mpi_type < prec >(), comm);
+      return dst;
+    }
+
+    /**
+     * @return number of elements as MPI count
+     * @throws std::overflow_error if the number of elements can not be passed to MPI
+     */
+    static int mpi_count(unsigned long long count) {
+      if (count > (unsigned long long) (INT_MAX)) {
+        throw std::overflow_error("Local part of the vector is too large for MPI communications.");
+      }
+      return int(count);
+    }
 #endif
 
   };
@@ -131,15 +1245,35 @@ namespace EDLib {
   typedef Hamiltonian < Storage::CRSStorage < Model::HubbardModel < double > >, Model::HubbardModel < double > > CSRHubbardHamiltonian;
   typedef Hamiltonian < Storage::SpinResolvedStorage < Model::HubbardModel < double > >, Model::HubbardModel < double > > SRSHubbardHamiltonian;
   typedef Hamiltonian < Storage::SOCRSStorage < Model::HubbardModel < double > >, Model::HubbardModel < double > > SOCSRHubbardHamiltonian;
+  typedef Hamiltonian < Storage::MatrixFreeStorage < Model::HubbardModel < double > >, Model::HubbardModel < double > > MFHubbardHamiltonian;
 
   typedef Hamiltonian < Storage::CRSStorage < Model::HubbardModel < float > >, Model::HubbardModel < float > > CSRHubbardHamiltonian_float;
   typedef Hamiltonian < Storage::SpinResolvedStorage < Model::HubbardModel < float > >, Model::HubbardModel < float > > SRSHubbardHamiltonian_float;
   typedef Hamiltonian < Storage::SOCRSStorage < Model::HubbardModel < float > >, Model::HubbardModel < float > > SOCSRHubbardHamiltonian_float;
+  typedef Hamiltonian < Storage::MatrixFreeStorage < Model::HubbardModel < float > >, Model::HubbardModel < float > > MFHubbardHamiltonian_float;
+
+  /// matrix elements are stored in single precision, vectors and eigensolver are in double precision
+  typedef Hamiltonian < Storage::CRSStorage < Model::HubbardModel < double >, float >, Model::HubbardModel < double > > CSRHubbardHamiltonian_mixed;
+  typedef Hamiltonian < Storage::SpinResolvedStorage < Model::HubbardModel < double >, float >, Model::HubbardModel < double > > SRSHubbardHamiltonian_mixed;
+  typedef Hamiltonian < Storage::SOCRSStorage < Model::HubbardModel < double >, float >, Model::HubbardModel < double > > SOCSRHubbardHamiltonian_mixed;
+
+  typedef Hamiltonian < Storage::CRSStorage < Model::HubbardModel < double, Symmetry::TranslationSymmetry > >, Model::HubbardModel < double, Symmetry::TranslationSymmetry > > CSRTranslationHubbardHamiltonian;
 
   typedef Hamiltonian < Storage::CRSStorage < Model::SingleImpurityAndersonModel < double > >, Model::SingleImpurityAndersonModel < double > > CSRSIAMHamiltonian;
   typedef Hamiltonian < Storage::CRSStorage < Model::SingleImpurityAndersonModel < float > >, Model::SingleImpurityAndersonModel < float > > CSRSIAMHamiltonian_float;
+  typedef Hamiltonian < Storage::MatrixFreeStorage < Model::SingleImpurityAndersonModel < double > >, Model::SingleImpurityAndersonModel < double > > MFSIAMHamiltonian;
+  typedef Hamiltonian < Storage::MatrixFreeStorage < Model::SingleImpurityAndersonModel < float > >, Model::SingleImpurityAndersonModel < float > > MFSIAMHamiltonian_float;
 
   typedef Hamiltonian < Storage::SpinResolvedStorage < Model::SingleImpurityAndersonModel < double > >, Model::SingleImpurityAndersonModel < double > > SRSSIAMHamiltonian;
   typedef Hamiltonian < Storage::SpinResolvedStorage < Model::SingleImpurityAndersonModel < float > >, Model::SingleImpurityAndersonModel < float > > SRSSIAMHamiltonian_float;
+
+  typedef Hamiltonian < Storage::CRSStorage < Model::SingleImpurityAndersonModel < double >, float >, Model::SingleImpurityAndersonModel < double > > CSRSIAMHamiltonian_mixed;
+  typedef Hamiltonian < Storage::SpinResolvedStorage < Model::SingleImpurityAndersonModel < double >, float >, Model::SingleImpurityAndersonModel < double > > SRSSIAMHamiltonian_mixed;
+
+#ifdef __SIZEOF_INT128__
+  typedef Hamiltonian < Storage::CRSStorage < Model::SingleImpurityAndersonModel < double, Symmetry::SzSymmetry128 > >, Model::SingleImpurityAndersonModel < double, Symmetry::SzSymmetry128 > > CSRSIAMHamiltonian128;
+  typedef Hamiltonian < Storage::MatrixFreeStorage < Model::SingleImpurityAndersonModel < double, Symmetry::SzSymmetry128 > >, Model::SingleImpurityAndersonModel < double, Symmetry::SzSymmetry128 > > MFSIAMHamiltonian128;
+  typedef Hamiltonian < Storage::CRSStorage < Model::HubbardModel < double, Symmetry::SzSymmetry128 > >, Model::HubbardModel < double, Symmetry::SzSymmetry128 > > CSRHubbardHamiltonian128;
+#endif
 }
 #endif //HUBBARD_HAMILTONIAN_H
@@ -5,10 +5,14 @@
 #ifndef HUBBARD_HUBBARDMODEL_H
 #define HUBBARD_HUBBARDMODEL_H
 
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
 #include <vector>
 
 #include <alps/params.hpp>
 #include "SzSymmetry.h"
+#include "TranslationSymmetry.h"
 #include "FermionicModel.h"
 
 namespace EDLib {
@@ -32,13 +36,18 @@ namespace EDLib {
       };
     }
 
-    template<typename prcsn>
+    /**
+     * @tparam prcsn - floating point precision
+     * @tparam Sym - symmetry: Symmetry::SzSymmetry or Symmetry::TranslationSymmetry for translation invariant clusters
+     */
+    template<typename prcsn, class Sym = Symmetry::SzSymmetry>
     class HubbardModel: public FermionicModel {
     public:
       typedef prcsn precision;
-      typedef typename Symmetry::SzSymmetry SYMMETRY;
+      typedef Sym SYMMETRY;
       typedef typename Hubbard::InnerState < precision > St;
-      typedef typename Symmetry::SzSymmetry::Sector Sector;
+      typedef typename Sym::Sector Sector;
+      typedef typename Sym::State State;
 
       HubbardModel(alps::params &p) : FermionicModel(p), _symmetry(p) {
         Eps.assign(p["NSITES"], std::vector < precision >(p["NSPINS"], precision(0.0)));
@@ -59,6 +68,7 @@ namespace EDLib {
         input_data >> alps::make_pvp("interaction/values", U);
         input_data >> alps::make_pvp("chemical_potential/values", _xmu);
         input_data.close();
+        check_symmetry(_symmetry);
         for (int ii = 0; ii < _Ns; ++ii) {
           for (int jj = 0; jj < _Ns; ++jj) {
             if (std::abs(t[ii][jj]) > 1e-10) {
@@ -70,12 +80,12 @@ namespace EDLib {
         }
       };
 
-      inline int valid(const St &state, long long nst) {
+      inline int valid(const St &state, State nst) {
         return (checkState(nst, state.indicies().first + state.spin() * _Ns, _Ip) * (1 - checkState(nst, state.indicies().second + state.spin() * _Ns, _Ip)));
       }
 
-      inline void set(const St &state, long long nst, long long &k, int &sign) {
-        long long k1, k2;
+      inline void set(const St &state, State nst, State &k, int &sign) {
+        State k1, k2;
         int isign1, isign2;
         a(state.indicies().first + state.spin() * _Ns, nst, k1, isign1);
         adag(state.indicies().second + state.spin() * _Ns, k1, k2, isign2);
@@ -84,7 +94,7 @@ namespace EDLib {
         sign = -isign1 * isign2;
       }
 
-      inline precision diagonal(long long state) const {
+      inline precision diagonal(State state) const {
         precision xtemp = 0.0;
         for (int im = 0; im < _Ns; ++im) {
           for (int is = 0; is < _ms; ++is) {
@@ -96,7 +106,7 @@ namespace EDLib {
         return xtemp;
       }
 
-      inline long long interacting_states(long long nst) {
+      inline State interacting_states(State nst) {
         return nst;
       }
 
@@ -108,17 +118,89 @@ namespace EDLib {
         return _Ns;
       }
 
-      inline const Symmetry::SzSymmetry &symmetry() const {
+      /**
+       * @return true if the Hamiltonian is invariant under the exchange of spin-up and spin-down electrons
+       */
+      bool spin_flip_symmetric() const {
+        if (!std::is_same < Sym, Symmetry::SzSymmetry >::value || _ms != 2 || std::abs(_Hmag) > 1e-14 || std::abs(_xmu[0] - _xmu[1]) > 1e-14) {
+          return false;
+        }
+        for (int im = 0; im < _Ns; ++im) {
+          if (std::abs(Eps[im][0] - Eps[im][1]) > 1e-14) {
+            return false;
+          }
+        }
+        return true;
+      }
+
+      /**
+       * Hopping and Hubbard interaction commute with the total spin, so the spin rotation symmetry is broken only
+       * by the magnetic field and the spin-dependent one-particle energies.
+       *
+       * @return true if the Hamiltonian commutes with S^2
+       */
+      bool su2_symmetric() const {
+        return spin_flip_symmetric();
+      }
+
+      /**
+       * Check that the Hamiltonian is invariant under the particle-hole transformation c_i -> eta_i c^+_i:
+       * the hopping matrix is symmetric and connects only sites of different sublattices, and the on-site energy
+       * is equal to -U/2 for each site and spin.
+       *
+       * @param sublattice [out] - sublattice (0 or 1) of each site
+       * @return true if the Hamiltonian is particle-hole symmetric
+       */
+      bool particle_hole_symmetric(std::vector < int > &sublattice) const {
+        if (!std::is_same < Sym, Symmetry::SzSymmetry >::value || _ms != 2 || std::abs(_Hmag) > 1e-14) {
+          return false;
+        }
+        for (int im = 0; im < _Ns; ++im) {
+          for (int is = 0; is < _ms; ++is) {
+            if (std::abs(Eps[im][is] - _xmu[is] + U[im] / 2.0) > 1e-14) {
+              return false;
+            }
+          }
+        }
+        /// two-colour the hopping graph
+        sublattice.assign(_Ns, -1);
+        for (int i0 = 0; i0 < _Ns; ++i0) {
+          if (sublattice[i0] >= 0) {
+            continue;
+          }
+          sublattice[i0] = 0;
+          std::vector < int > stack(1, i0);
+          while (!stack.empty()) {
+            int ii = stack.back();
+            stack.pop_back();
+            for (int jj = 0; jj < _Ns; ++jj) {
+              if (jj == ii || (std::abs(t[ii][jj]) < 1e-10 && std::abs(t[jj][ii]) < 1e-10)) {
+                continue;
+              }
+              if (std::abs(t[ii][jj] - t[jj][ii]) > 1e-14 || sublattice[jj] == sublattice[ii]) {
+                return false;
+              }
+              if (sublattice[jj] < 0) {
+                sublattice[jj] = 1 - sublattice[ii];
+                stack.push_back(jj);
+              }
+            }
+          }
+        }
+        return true;
+      }
+
+      inline const Sym &symmetry() const {
         return _symmetry;
       }
 
-      inline Symmetry::SzSymmetry &symmetry() {
+      inline Sym &symmetry() {
         return _symmetry;
       }
 
     private:
       // Symmetry
-      Symmetry::SzSymmetry _symmetry;
+      Sym _symmetry;
       // Hopping
       std::vector < std::vector < precision > > t;
       // Interaction
@@ -135,6 +217,33 @@ namespace EDLib {
       // Non-diagonal states iterator
       std::vector < St > _states;
       std::vector < St > _V_states;
+
+      template<typename State>
+      void check_symmetry(const Symmetry::SzSymmetryT < State > &) const {
+      }
+
+      /**
+       * Check that hopping, interaction and site energies are invariant under lattice translations
+       */
+      void check_symmetry(const Symmetry::TranslationSymmetry &symmetry) const {
+        for (int g = 0; g < symmetry.translations(); ++g) {
+          for (int ii = 0; ii < _Ns; ++ii) {
+            int ti = symmetry.translate_site(g, ii);
+            bool invariant = std::abs(U[ti] - U[ii]) < 1e-14;
+            for (int is = 0; is < _ms; ++is) {
+              invariant = invariant && std::abs(Eps[ti][is] - Eps[ii][is]) < 1e-14;
+            }
+            for (int jj = 0; jj < _Ns; ++jj) {
+              invariant = invariant && std::abs(t[ti][symmetry.translate_site(g, jj)] - t[ii][jj]) < 1e-14;
+            }
+            if (!invariant) {
+              std::stringstream s;
+              s << "Hamiltonian is not invariant under the lattice translation " << g << " of the site " << ii << ".";
+              throw std::invalid_argument(s.str().c_str());
+            }
+          }
+        }
+      }
     };
 
   }
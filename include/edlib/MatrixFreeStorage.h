@@ -0,0 +1,173 @@
+#ifndef HUBBARD_MATRIXFREESTORAGE_H
+#define HUBBARD_MATRIXFREESTORAGE_H
+
+
+#include <climits>
+#include <stdexcept>
+#include <vector>
+#include <iomanip>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "Storage.h"
+
+namespace EDLib {
+  namespace Storage {
+    /**
+     * @brief Matrix-free Hamiltonian storage
+     *
+     * Only the diagonal part of the Hamiltonian is stored. Off-diagonal elements are regenerated from the model
+     * hopping and interaction terms on each matrix-vector product, so memory consumption is proportional
+     * to the sector dimension. Useful for large sectors where even column indices do not fit into memory.
+     *
+     * @tparam Model - type of the model
+     */
+    template<class Model>
+    class MatrixFreeStorage : public Storage < typename Model::precision > {
+      typedef typename Model::precision prec;
+      using Storage < prec >::n;
+      using Storage < prec >::ntot;
+    public:
+#ifdef USE_MPI
+      MatrixFreeStorage(alps::params &p, Model &s, MPI_Comm comm) : Storage < prec >(p, comm),
+#else
+      MatrixFreeStorage(alps::params &p, Model &s) : Storage < prec >(p),
+#endif
+                                                 _model(s) {
+      };
+
+      void reset() {
+        _model.symmetry().init();
+        /// the rows are indexed by 32-bit integers
+        if (_model.symmetry().sector().size() > size_t(INT_MAX)) {
+          throw std::overflow_error("Sectors larger than 2^31 require the distributed SpinResolvedStorage.");
+        }
+        n() = _model.symmetry().sector().size();
+        ntot() = n();
+      }
+
+      /**
+       * Matrix-vector product with on-the-fly evaluation of the off-diagonal elements
+       */
+      virtual void av(prec *v, prec *w, size_t n, bool clear = true) {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (int i = 0; i < int(n); ++i) {
+          typename Model::State nst = _model.symmetry().state_by_index(i);
+          prec wi = (clear ? prec(0.0) : w[i]) + dvalues[i] * v[i];
+          /// hoppings
+          wi += off_diagonal < decltype(_model.T_states()) >(nst, _model.T_states(), v);
+          /// interactions
+          wi += off_diagonal < decltype(_model.V_states()) >(nst, _model.V_states(), v);
+          w[i] = wi;
+        }
+      }
+
+      /**
+       * Compute and store diagonal part of the Hamiltonian for the current sector
+       */
+      void fill() {
+        reset();
+        int sector_size = n();
+        std::vector < prec >(sector_size).swap(dvalues);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (int i = 0; i < sector_size; ++i) {
+          dvalues[i] = _model.diagonal(_model.symmetry().state_by_index(i));
+        }
+      }
+
+      void print() {
+        std::vector < prec > v(n(), prec(0.0));
+        std::vector < prec > line(n(), prec(0.0));
+        std::cout << std::setprecision(2) << std::fixed;
+        std::cout << "{";
+        for (int j = 0; j < n(); ++j) {
+          v[j] = prec(1.0);
+          av(v.data(), line.data(), n());
+          v[j] = prec(0.0);
+          std::cout << "{";
+          for (int i = 0; i < n(); ++i) {
+            std::cout << std::setw(6) << line[i] << (i == n() - 1 ? "" : ", ");
+          }
+          std::cout << "}" << (j == n() - 1 ? "" : ", \n");
+        }
+        std::cout << "}" << std::endl;
+      }
+
+      virtual void zero_eigenapair() {
+        Storage < prec >::eigenvalues().resize(1);
+        Storage < prec >::eigenvalues()[0] = dvalues[0];
+        Storage < prec >::eigenvectors().assign(1, std::vector < prec >(1, prec(1.0)));
+      }
+
+      virtual void diagonal(std::vector < prec > &d) {
+        d = dvalues;
+      }
+
+      size_t vector_size(typename Model::Sector sector) {
+        return sector.size();
+      }
+
+      prec vv(const std::vector < prec > &v, const std::vector < prec > &w) {
+        prec alf = prec(0.0);
+        int size = v.size();
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+:alf) schedule(static)
+#endif
+        for (int k = 0; k < size; ++k) {
+          alf += w[k] * v[k];
+        }
+        return alf;
+      }
+
+      void a_adag(int iii, const std::vector < prec > &invec, std::vector < prec > &outvec, const typename Model::Sector &next_sec, bool a) {
+        typename Model::State k;
+        int sign;
+        int i = 0;
+        while (_model.symmetry().next_state()) {
+          typename Model::State nst = _model.symmetry().state();
+          if (_model.checkState(nst, iii, _model.max_total_electrons()) == (a ? 1 : 0)) {
+            if (a) _model.a(iii, nst, k, sign);
+            else _model.adag(iii, nst, k, sign);
+            int i1 = _model.symmetry().index(k, next_sec);
+            outvec[i1] = sign * invec[i];
+          }
+          ++i;
+        };
+      }
+
+    private:
+      /// diagonal part of the Hamiltonian
+      std::vector < prec > dvalues;
+
+      Model &_model;
+
+      /**
+       * Compute off-diagonal contribution into the product for the row corresponding to the state nst
+       *
+       * @param nst - state corresponding to the current row
+       * @param states - transition terms of the model
+       * @param v - vector to multiply
+       * @return sum of the off-diagonal elements of the current row multiplied by the corresponding vector elements
+       */
+      template<typename T_states>
+      inline prec off_diagonal(typename Model::State nst, T_states states, const prec *v) {
+        typename Model::State k = 0;
+        int isign = 0;
+        prec result = prec(0.0);
+        for (int kkk = 0; kkk < states.size(); ++kkk) {
+          if (_model.valid(states[kkk], nst)) {
+            _model.set(states[kkk], nst, k, isign);
+            result += isign * states[kkk].value() * v[_model.symmetry().index(k)];
+          }
+        }
+        return result;
+      };
+    };
+
+  }
+}
+#endif //HUBBARD_MATRIXFREESTORAGE_H
@@ -11,7 +11,7 @@
 #include "Combination.h"
 namespace EDLib {
   namespace Symmetry {
-    class NSymmetry : public Symmetry {
+    class NSymmetry : public Symmetry<> {
     public:
       class Sector {
       public:
@@ -39,10 +39,16 @@ namespace EDLib {
         size_t _size;
       };
 
-      NSymmetry(int N) : Symmetry(), _N(N), _totstate(N, 0.0), _current_sector(-1, 0), _comb(N) {}
+      /// largest number of bits for which the index of each bit string is stored directly
+      static const int DIRECT_INDEX_BITS = 16;
 
-      NSymmetry(alps::params &p) : Symmetry(), _N(2 * int(p["NSITES"])), _totstate(2 * p["NSITES"].as<int>(), 0.0), _current_sector(-1, 0),
+      NSymmetry(int N) : Symmetry<>(), _N(N), _totstate(N, 0.0), _current_sector(-1, 0), _comb(N) {
+        init_index();
+      }
+
+      NSymmetry(alps::params &p) : Symmetry<>(), _N(2 * int(p["NSITES"])), _totstate(2 * p["NSITES"].as<int>(), 0.0), _current_sector(-1, 0),
                                _comb(2 * p["NSITES"].as<int>()) {
+        init_index();
         if (p.exists("arpack.SECTOR") && bool(p["arpack.SECTOR"])) {
           std::vector < std::vector < int > > sectors;
           std::string input = p["INPUT_FILE"];
@@ -79,8 +85,32 @@ namespace EDLib {
         return true;
       }
 
-      virtual int index(long long st) {
-        return _comb.c_n_k(_N, _current_sector.n()) - num(st, _N, _current_sector.n()) - 1;
+      virtual long long index(long long st) {
+        if (!_direct.empty()) {
+          return _direct[st];
+        }
+        return rank(st, _current_sector.n());
+      }
+
+      /**
+       * Compute the position of the bit string in the list of N-bit strings with k set bits without lookup tables
+       * for the whole bit string. For the set bits c_1 < ... < c_k the position is
+       *
+       *   C(N, k) - 1 - sum_i C(N - 1 - c_i, k - i + 1),
+       *
+       * the terms are precomputed for each bit position and number of remaining bits.
+       *
+       * @param st - bit string
+       * @param k - number of set bits
+       * @return position of the bit string
+       */
+      inline int rank(long long st, int k) const {
+        int res = _terms[k];
+        unsigned long long b = st;
+        for (int m = k; b != 0; --m, b &= b - 1) {
+          res -= _terms[(__builtin_ctzll(b) + 1) * (_N + 1) + m];
+        }
+        return res;
       }
 
       virtual void reset() {
@@ -120,6 +150,28 @@ namespace EDLib {
       std::queue < NSymmetry::Sector > _sectors;
       std::vector < int > _totstate;
       Combination _comb;
+      /// C(N, k) - 1 for j = 0 and C(N - j, m) for j = 1 .. N, stored at j * (N + 1) + m
+      std::vector < int > _terms;
+      /// index of each bit string for N <= DIRECT_INDEX_BITS
+      std::vector < int > _direct;
+
+      void init_index() {
+        _terms.assign((_N + 1) * (_N + 1), 0);
+        for (int m = 0; m <= _N; ++m) {
+          _terms[m] = _comb.c_n_k(_N, m) - 1;
+        }
+        for (int j = 1; j <= _N; ++j) {
+          for (int m = 0; m <= _N - j; ++m) {
+            _terms[j * (_N + 1) + m] = _comb.c_n_k(_N - j, m);
+          }
+        }
+        if (_N <= DIRECT_INDEX_BITS) {
+          _direct.resize(1ll << _N);
+          for (long long st = 0; st < (1ll << _N); ++st) {
+            _direct[st] = rank(st, __builtin_popcountll(st));
+          }
+        }
+      }
 
       int next_basis(int n, int k, std::vector < int > &old) {
         int res = 0;
@@ -135,15 +187,6 @@ namespace EDLib {
         }
         return res;
       }
-
-      inline int num(long long b, int n, int m) const {
-        int res = 0;
-        if (((b & (1ll << (_N - n))) == 0) and ((n - 1) > 0) and (m > 0) and (m < n))
-          res = num(b, n - 1, m);
-        else if (((n - 1) > 0) and (m > 0) and (m < n))
-          res = _comb.c_n_k(n - 1, m) + num(b, n - 1, m - 1);
-        return res;
-      }
     };
   }
 }
@@ -0,0 +1,107 @@
+#ifndef HUBBARD_PARTICLEHOLESYMMETRY_H
+#define HUBBARD_PARTICLEHOLESYMMETRY_H
+
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "SzSymmetry.h"
+
+namespace EDLib {
+  namespace Symmetry {
+    /**
+     * @brief Particle-hole transformation on top of the Sz symmetry
+     *
+     * For the bipartite lattice the transformation c_i -> eta_i c^+_i, where eta_i = +1 on the A sublattice and -1
+     * on the B sublattice, maps the (nup, ndown) sector onto the (Ns - nup, Ns - ndown) sector. The basis state is mapped
+     * to the state with all occupation numbers inverted, multiplied by the sign
+     *
+     *   prod_{occupied i} eta_i (-1)^i,
+     *
+     * where i is the position of the spin-orbital in the fermionic ordering. At half filling (Eps - mu = -U/2) the Hubbard
+     * Hamiltonian is invariant under this transformation, so only one sector of each pair has to be diagonalized.
+     */
+    class ParticleHoleSymmetry {
+    public:
+      /**
+       * @param Ns - number of sites
+       * @param sublattice - sublattice (0 or 1) of each site
+       */
+      ParticleHoleSymmetry(int Ns, const std::vector < int > &sublattice) : _Ns(Ns), _Ip(2 * Ns), _sign(2 * Ns, 1) {
+        if (sublattice.size() != size_t(Ns)) {
+          std::stringstream s;
+          s << "Sublattice is defined for " << sublattice.size() << " sites instead of " << Ns << ".";
+          throw std::invalid_argument(s.str().c_str());
+        }
+        for (int i = 0; i < _Ip; ++i) {
+          _sign[i] = ((sublattice[i % Ns] + i) % 2 == 0) ? 1 : -1;
+        }
+      }
+
+      /**
+       * @return sector the current sector is mapped onto
+       */
+      SzSymmetry::Sector partner(const SzSymmetry::Sector &sector) const {
+        return SzSymmetry::Sector(_Ns - sector.nup(), _Ns - sector.ndown(), sector.size());
+      }
+
+      /**
+       * Sector is diagonalized if it has no more particles than its partner. For the sectors at half filling the partner
+       * is (ndown, nup), in this case the sector with nup <= ndown is diagonalized.
+       *
+       * @return true if the sector is the representative of the pair
+       */
+      bool representative(const SzSymmetry::Sector &sector) const {
+        int n = sector.nup() + sector.ndown();
+        return n < _Ns || (n == _Ns && sector.nup() <= sector.ndown());
+      }
+
+      /**
+       * Apply particle-hole transformation to the basis state
+       *
+       * @param state [in] - basis state
+       * @param sign [out] - sign of the transformed state
+       * @return basis state with inverted occupation numbers
+       */
+      long long transform(long long state, int &sign) const {
+        sign = 1;
+        for (int i = 0; i < _Ip; ++i) {
+          if (state & (1ll << (_Ip - 1 - i))) {
+            sign *= _sign[i];
+          }
+        }
+        return state ^ ((1ll << _Ip) - 1);
+      }
+
+      /**
+       * Apply particle-hole transformation to the complete vector of the sector
+       *
+       * @param symmetry - Sz symmetry used to enumerate basis states, current sector is changed
+       * @param sector - sector of the input vector
+       * @param in - vector in the sector
+       * @param out - vector in the partner sector
+       */
+      template<typename prec>
+      void transform(SzSymmetry &symmetry, const SzSymmetry::Sector &sector, const std::vector < prec > &in, std::vector < prec > &out) const {
+        SzSymmetry::Sector next = partner(sector);
+        out.assign(sector.size(), prec(0.0));
+        symmetry.set_sector(sector);
+        int sign;
+        int i = 0;
+        while (symmetry.next_state()) {
+          long long k = transform(symmetry.state(), sign);
+          out[symmetry.index(k, next)] = sign * in[i];
+          ++i;
+        }
+      }
+
+    private:
+      int _Ns;
+      int _Ip;
+      /// eta_i (-1)^i for each spin-orbital
+      std::vector < int > _sign;
+    };
+  }
+}
+
+#endif //HUBBARD_PARTICLEHOLESYMMETRY_H
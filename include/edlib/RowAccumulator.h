@@ -0,0 +1,146 @@
+#ifndef HUBBARD_ROWACCUMULATOR_H
+#define HUBBARD_ROWACCUMULATOR_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace EDLib {
+  namespace Storage {
+
+    /**
+     * @brief Sparse accumulator for a single row of CRS matrix
+     *
+     * Collects the off-diagonal contributions of the current row. Contributions to the same column are summed up
+     * (in case of multi-orbital Coulomb interaction there can be several transitions between the same pair of states).
+     * Columns are looked up in small open-addressed hash table, so the row assembly is linear in the number of
+     * contributions. Elements are kept in the order of their first appearance.
+     *
+     * @tparam prec - floating point precision
+     * @tparam Index - type of the column indices
+     */
+    template<typename prec, typename Index = int>
+    class RowAccumulator {
+    public:
+      RowAccumulator(size_t capacity = 64) : _stamp(1) {
+        size_t size = 16;
+        while (size < 2 * capacity) {
+          size <<= 1;
+        }
+        rehash(size);
+      }
+
+      /**
+       * Start new row
+       */
+      void inline reset() {
+        _columns.clear();
+        _values.clear();
+        ++_stamp;
+        if (_stamp == 0) {
+          /// stamp counter overflow, clean the table
+          std::fill(_stamps.begin(), _stamps.end(), 0u);
+          _stamp = 1;
+        }
+      }
+
+      /**
+       * Add contribution v to the j-th column of the current row
+       */
+      void inline add(Index j, prec v) {
+        size_t h = hash(j);
+        while (_stamps[h] == _stamp) {
+          if (_keys[h] == j) {
+            _values[_slots[h]] += v;
+            return;
+          }
+          h = (h + 1) & _mask;
+        }
+        _stamps[h] = _stamp;
+        _keys[h] = j;
+        _slots[h] = _columns.size();
+        _columns.push_back(j);
+        _values.push_back(v);
+        /// keep the load factor below 1/2
+        if (2 * _columns.size() > _mask) {
+          rehash(2 * (_mask + 1));
+        }
+      }
+
+      /**
+       * @return number of different columns in the current row
+       */
+      size_t size() const {
+        return _columns.size();
+      }
+
+      /**
+       * Copy the current row into CRS arrays
+       *
+       * @param col_ind - column indices array
+       * @param values - values array, the accumulated values are rounded to its precision
+       * @param threshold - drop elements with absolute value smaller than threshold
+       * @return number of stored elements
+       */
+      template<typename Column, typename Value>
+      size_t flush(Column *col_ind, Value *values, prec threshold = prec(0)) const {
+        size_t k = 0;
+        for (size_t i = 0; i < _columns.size(); ++i) {
+          if (threshold > prec(0) && std::abs(_values[i]) < threshold) {
+            continue;
+          }
+          col_ind[k] = _columns[i];
+          values[k] = Value(_values[i]);
+          ++k;
+        }
+        return k;
+      }
+
+      const std::vector < Index > &columns() const {
+        return _columns;
+      }
+
+      const std::vector < prec > &values() const {
+        return _values;
+      }
+
+    private:
+      /// columns of the current row in order of appearance
+      std::vector < Index > _columns;
+      /// accumulated values of the current row
+      std::vector < prec > _values;
+      /// hash table
+      std::vector < Index > _keys;
+      std::vector < size_t > _slots;
+      /// table entry is occupied if its stamp is equal to the stamp of the current row
+      std::vector < unsigned int > _stamps;
+      unsigned int _stamp;
+      size_t _mask;
+
+      size_t inline hash(Index j) const {
+        return size_t((uint64_t(j) * 11400714819323198485ull) >> 32) & _mask;
+      }
+
+      void rehash(size_t size) {
+        _mask = size - 1;
+        _keys.assign(size, 0);
+        _slots.assign(size, 0);
+        _stamps.assign(size, 0u);
+        _stamp = 1;
+        for (size_t i = 0; i < _columns.size(); ++i) {
+          size_t h = hash(_columns[i]);
+          while (_stamps[h] == _stamp) {
+            h = (h + 1) & _mask;
+          }
+          _stamps[h] = _stamp;
+          _keys[h] = _columns[i];
+          _slots[h] = i;
+        }
+      }
+    };
+
+  }
+}
+
+#endif //HUBBARD_ROWACCUMULATOR_H
@@ -5,6 +5,7 @@
 #ifndef HUBBARD_SOCRSSTORAGE_H
 #define HUBBARD_SOCRSSTORAGE_H
 
+#include <cstdint>
 #include <vector>
 #include <iomanip>
 #ifdef _OPENMP
@@ -15,14 +16,18 @@
 namespace EDLib {
   namespace Storage {
 
-    template<class Model>
+    /**
+     * @tparam Model - model to diagonalize, its precision is used for the vectors and the eigensolver
+     * @tparam value_prec - precision of the stored diagonal matrix elements
+     */
+    template<class Model, typename value_prec = typename Model::precision>
     class SOCRSStorage : public Storage < typename Model::precision > {
       typedef typename Model::precision prec;
     public:
       using Storage < prec >::n;
       using Storage < prec >::ntot;
 #ifdef USE_MPI
-      SOCRSStorage(alps::params &p, Model &m, alps::mpi::communicator &comm) : Storage < prec >(p, comm),
+      SOCRSStorage(alps::params &p, Model &m, MPI_Comm comm) : Storage < prec >(p, comm),
 #else
       SOCRSStorage(alps::params &p, Model &m) : Storage < prec >(p),
 #endif
@@ -33,16 +38,16 @@ namespace EDLib {
                                             _nthreads(1),
 #endif
                                             _row_offset(_nthreads + 1), _vind_offset(_nthreads + 1),
-                                            _vind(_nthreads), _vind_byte(_nthreads), _vind_bit(_nthreads), _vind_start(_nthreads),
+                                            _vind(_nthreads), _vind_start(_nthreads),
                                             _max_dim(p["storage.MAX_DIM"]), _model(m) {
         /** init what you need from parameters*/
-        col_ind.assign(_max_size, 0);
-        // XXX I don't trust myself about this one:
-        signs.assign(std::ceil(_max_size / sizeof(char)), 1);
-        dvalues.assign(_max_dim, prec(0.0));
+        // av() reads col_ind[_vind] before it knows whether the transition is valid, keep one extra element at the end
+        col_ind.assign(_max_size + 1, 0);
+        signs.assign(_max_size / SIGN_BITS + 1, 0);
+        dvalues.assign(_max_dim, value_prec(0.0));
       };
 
-      virtual void av(prec *v, prec *w, int n, bool clear = true) {
+      virtual void av(prec *v, prec *w, size_t n, bool clear = true) {
         _model.symmetry().init();
 #ifdef _OPENMP
 #pragma omp parallel
@@ -52,39 +57,61 @@ namespace EDLib {
           int myid = 0;
 #endif
           size_t _vind = _vind_offset[myid];
-          size_t _vind_byte = _vind / sizeof(char);
-          size_t _vind_bit = _vind % sizeof(char);
           // Iteration over rows.
-          for(int i = _row_offset[myid]; (i < _row_offset[myid + 1]) && (i < n); ++i){
-            long long nst = _model.symmetry().state_by_index(i);
+          for(int i = _row_offset[myid]; (i < _row_offset[myid + 1]) && (size_t(i) < n); ++i){
+            typename Model::State nst = _model.symmetry().state_by_index(i);
             // Diagonal contribution.
-            w[i] = dvalues[i] * v[i] + (clear ? 0.0 : w[i]);
+            prec wi = prec(dvalues[i]) * v[i] + (clear ? 0.0 : w[i]);
             // Offdiagonal contribution.
             // Iteration over columns(unordered).
             for (int kkk = 0; kkk < _model.T_states().size(); ++kkk) {
               int test = _model.valid(_model.T_states()[kkk], nst);
               // If transition between states corresponding to row and column is possible, calculate the offdiagonal element.
-              w[i] += test * _model.T_states()[kkk].value() * (1 - 2 * ((signs[_vind_byte] >> _vind_bit) & 1)) * v[col_ind[_vind]];
-              _vind_bit += test;
-              _vind_byte += _vind_bit / sizeof(char);
-              _vind_bit %= sizeof(char);
+              wi += test * _model.T_states()[kkk].value() * sign(_vind) * v[col_ind[_vind]];
               _vind += test;
             }
             for (int kkk = 0; kkk < _model.V_states().size(); ++kkk) {
               int test = _model.valid(_model.V_states()[kkk], nst);
               // If transition between states corresponding to row and column is possible, calculate the offdiagonal element.
-              w[i] += test * _model.V_states()[kkk].value() * (1 - 2 * ((signs[_vind_byte] >> _vind_bit) & 1)) * v[col_ind[_vind]];
-              _vind_bit += test;
-              _vind_byte += _vind_bit / sizeof(char);
-              _vind_bit %= sizeof(char);
+              wi += test * _model.V_states()[kkk].value() * sign(_vind) * v[col_ind[_vind]];
               _vind += test;
             }
+            w[i] = wi;
           }
 #ifdef _OPENMP
         }
 #endif
       }
 
+      /**
+       * Product with k vectors in the interleaved layout, V[i * k + j] is the i-th element of the j-th vector.
+       * The transitions and signs of each row are decoded once for all k vectors.
+       */
+      virtual void av_block(const prec *V, prec *W, size_t n, int k) {
+        _model.symmetry().init();
+#ifdef _OPENMP
+#pragma omp parallel
+        {
+          int myid = omp_get_thread_num();
+#else
+        {
+          int myid = 0;
+#endif
+          size_t _vind = _vind_offset[myid];
+          std::vector < prec > acc(k);
+          for (int i = _row_offset[myid]; (i < _row_offset[myid + 1]) && (size_t(i) < n); ++i) {
+            typename Model::State nst = _model.symmetry().state_by_index(i);
+            const prec *vi = V + size_t(i) * k;
+            for (int l = 0; l < k; ++l) {
+              acc[l] = prec(dvalues[i]) * vi[l];
+            }
+            row_block(_model.T_states(), nst, V, k, _vind, acc);
+            row_block(_model.V_states(), nst, V, k, _vind, acc);
+            std::copy(acc.begin(), acc.end(), W + size_t(i) * k);
+          }
+        }
+      }
+
       void reset() {
         _model.symmetry().init();
         size_t sector_size = _model.symmetry().sector().size();
@@ -93,41 +120,39 @@ namespace EDLib {
           s << "New sector request more memory than allocated. Increase MAX_DIM parameter. Requested " << sector_size << ", allocated " << _max_dim << ".";
           throw std::runtime_error(s.str().c_str());
         }
-        if (sector_size * (_model.T_states().size() + _model.V_states().size()) > _max_size) {
-          std::stringstream s;
-          s << "New sector request more memory than allocated. Increase MAX_SIZE parameter. Requested " << sector_size * (_model.T_states().size() + _model.V_states().size()) << ", allocated " << _max_size << ".";
-          throw std::runtime_error(s.str().c_str());
-        }
-        for(int myid = 0; myid < _nthreads; ++myid){
-          _vind[myid] = 0;
-          _vind_byte[myid] = 0;
-          _vind_bit[myid] = 0;
-        }
-        ntot() = sector_size;
-        n() = ntot();
-      }
-
-      void fill() {
-        reset();
-        int i = 0;
-        long long k = 0;
-        int isign = 0;
         // Size chunks equally.
-        int step = (int)std::floor(_model.symmetry().sector().size() / _nthreads);
+        int step = (int)std::floor(sector_size / _nthreads);
         for (int i = 0; i <= _nthreads; i++){
           _row_offset[i] = step * i;
         }
         // Put the rest into some of the first threads.
-        int more = _model.symmetry().sector().size() - _row_offset[_nthreads];
+        int more = sector_size - _row_offset[_nthreads];
         for (int i = 0; i < more; i++){
           _row_offset[i] += i;
         }
         for (int i = more; i <= _nthreads; i++){
           _row_offset[i] += more;
         }
-        for(int myid = 0; myid <= _nthreads; ++myid){
-          _vind_offset[myid] = (_model.T_states().size() + _model.V_states().size()) * _row_offset[myid];
+        // Each chunk starts from the new word of the sign bitmap, so threads never write to the same word.
+        _vind_offset[0] = 0;
+        for(int myid = 0; myid < _nthreads; ++myid){
+          size_t chunk_size = (_model.T_states().size() + _model.V_states().size()) * (_row_offset[myid + 1] - _row_offset[myid]);
+          _vind_offset[myid + 1] = _vind_offset[myid] + (chunk_size + SIGN_BITS - 1) / SIGN_BITS * SIGN_BITS;
+        }
+        if (_vind_offset[_nthreads] > _max_size) {
+          std::stringstream s;
+          s << "New sector request more memory than allocated. Increase MAX_SIZE parameter. Requested " << _vind_offset[_nthreads] << ", allocated " << _max_size << ".";
+          throw std::runtime_error(s.str().c_str());
+        }
+        for(int myid = 0; myid < _nthreads; ++myid){
+          _vind[myid] = 0;
         }
+        ntot() = sector_size;
+        n() = ntot();
+      }
+
+      void fill() {
+        reset();
 #ifdef _OPENMP
 #pragma omp parallel
         {
@@ -138,10 +163,8 @@ namespace EDLib {
 // Variant: serial, but more compact.
 //        for (int myid = 0; myid < _nthreads; ++myid){
           _vind[myid] = _vind_offset[myid];
-          _vind_byte[myid] = _vind[myid] / sizeof(char);
-          _vind_bit[myid] = _vind[myid] % sizeof(char);
           for (int i = _row_offset[myid]; i < _row_offset[myid + 1]; ++i) {
-            long long nst = _model.symmetry().state_by_index(i);
+            typename Model::State nst = _model.symmetry().state_by_index(i);
             // Compute diagonal element for current i state
             addDiagonal(i, _model.diagonal(nst), myid);
             // non-diagonal terms calculation
@@ -164,27 +187,19 @@ namespace EDLib {
         std::cout << "[";
         for (int myid = 0; myid < _nthreads; ++myid) {
           size_t _vind = _vind_offset[myid];
-          size_t _vind_byte = _vind / sizeof(char);
-          size_t _vind_bit =  _vind % sizeof(char);
           for (int i = _row_offset[myid]; i < _row_offset[myid + 1]; ++i) {
             _model.symmetry().next_state();
-            long long nst = _model.symmetry().state();
+            typename Model::State nst = _model.symmetry().state();
             std::fill(line.begin(), line.end(), prec(0.0));
             line[i] = dvalues[i];
             for (int kkk = 0; kkk < _model.T_states().size(); ++kkk) {
               int test = _model.valid(_model.T_states()[kkk], nst);
-              line[col_ind[_vind]] += test * _model.T_states()[kkk].value() * (1 - 2 * ((signs[_vind_byte] >> _vind_bit) & 1));
-              _vind_bit += test;
-              _vind_byte += _vind_bit / sizeof(char);
-              _vind_bit %= sizeof(char);
+              line[col_ind[_vind]] += test * _model.T_states()[kkk].value() * sign(_vind);
               _vind += test;
             }
             for (int kkk = 0; kkk < _model.V_states().size(); ++kkk) {
               int test = _model.valid(_model.V_states()[kkk], nst);
-              line[col_ind[_vind]] += test * _model.V_states()[kkk].value() * (1 - 2 * ((signs[_vind_byte] >> _vind_bit) & 1));
-              _vind_bit += test;
-              _vind_byte += _vind_bit / sizeof(char);
-              _vind_bit %= sizeof(char);
+              line[col_ind[_vind]] += test * _model.V_states()[kkk].value() * sign(_vind);
               _vind += test;
             }
             std::cout << "[";
@@ -203,6 +218,21 @@ namespace EDLib {
         Storage < prec >::eigenvectors().assign(1, std::vector < prec >(1, prec(1.0)));
       }
 
+      virtual void diagonal(std::vector < prec > &d) {
+        d.assign(dvalues.begin(), dvalues.begin() + n());
+      }
+
+      /**
+       * @return number of stored non-zero elements in the current sector including diagonal
+       */
+      size_t nnz() {
+        size_t result = n();
+        for (int myid = 0; myid < _nthreads; ++myid) {
+          result += _vind[myid] - _vind_offset[myid];
+        }
+        return result;
+      }
+
       size_t vector_size(typename Model::Sector sector) {
         return sector.size();
       }
@@ -216,11 +246,11 @@ namespace EDLib {
       }
 
       void a_adag(int iii, const std::vector < prec > &invec, std::vector < prec > &outvec, const typename Model::Sector& next_sec, bool a) {
-        long long k;
+        typename Model::State k;
         int sign;
         int i = 0;
         while (_model.symmetry().next_state()) {
-          long long nst = _model.symmetry().state();
+          typename Model::State nst = _model.symmetry().state();
           if (_model.checkState(nst, iii, _model.max_total_electrons()) == (a ? 1 : 0)) {
             if(a) _model.a(iii, nst, k, sign);
             else _model.adag(iii, nst, k, sign);
@@ -237,9 +267,11 @@ namespace EDLib {
 
     private:
       // Internal storage structure
-      std::vector < prec > dvalues;
+      std::vector < value_prec > dvalues;
       std::vector < int > col_ind;
-      std::vector < char > signs;
+      // Fermi signs of the off-diagonal elements, one bit per element, set bit corresponds to negative sign
+      std::vector < uint64_t > signs;
+      static const size_t SIGN_BITS = 64;
 
       // the maximum sizes of all the objects
       size_t _max_size;
@@ -254,17 +286,34 @@ namespace EDLib {
       std::vector < size_t > _vind;
       // start of current row, used for checks
       std::vector < size_t > _vind_start;
-      // bit and byte of the bitmap corresponding to CRS index
-      std::vector < size_t > _vind_bit;
-      std::vector < size_t > _vind_byte;
 
       // Hubbard model parameters
       Model &_model;
 
 
+      /**
+       * Add the off-diagonal contribution of the transitions from the list to the row of k interleaved products
+       */
       template<typename T_states>
-      inline void off_diagonal(long long nst, int i, T_states& states, int chunk) {
-        long long k = 0;
+      inline void row_block(const T_states &states, typename Model::State nst, const prec *V, int k, size_t &vind, std::vector < prec > &acc) {
+        for (int kkk = 0; kkk < states.size(); ++kkk) {
+          if (_model.valid(states[kkk], nst)) {
+            prec value = states[kkk].value() * sign(vind);
+            const prec *vj = V + size_t(col_ind[vind]) * k;
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+            for (int l = 0; l < k; ++l) {
+              acc[l] += value * vj[l];
+            }
+            ++vind;
+          }
+        }
+      }
+
+      template<typename T_states>
+      inline void off_diagonal(typename Model::State nst, int i, T_states& states, int chunk) {
+        typename Model::State k = 0;
         int isign = 0;
         for (int kkk = 0; kkk < states.size(); ++kkk) {
           if (_model.valid(states[kkk], nst)) {
@@ -279,7 +328,7 @@ namespace EDLib {
        * Add diagonal H(i,i) element with value v.
        */
       void inline addDiagonal(int i, prec v, int chunk) {
-        dvalues[i] = v;
+        dvalues[i] = value_prec(v);
         _vind_start[chunk] = _vind[chunk];
       }
 
@@ -303,12 +352,17 @@ namespace EDLib {
         }
         // Store sign in CRS-like array, one bit per sign.
         col_ind[_vind[chunk]] = j;
-        signs[_vind_byte[chunk]] &= ~(1ll << _vind_bit[chunk]);
-        signs[_vind_byte[chunk]] |= sign < 0 ? 1ll << _vind_bit[chunk] : 0;
-        ++_vind_bit[chunk];
+        uint64_t mask = uint64_t(1) << (_vind[chunk] % SIGN_BITS);
+        uint64_t &word = signs[_vind[chunk] / SIGN_BITS];
+        word = (word & ~mask) | (mask & -uint64_t(sign < 0));
         ++_vind[chunk];
-        _vind_byte[chunk] += _vind_bit[chunk] / sizeof(char);
-        _vind_bit[chunk] %= sizeof(char);
+      }
+
+      /**
+       * Fermi sign of the element stored at position vind
+       */
+      inline prec sign(size_t vind) const {
+        return prec(1 - 2 * int((signs[vind / SIGN_BITS] >> (vind % SIGN_BITS)) & 1));
       }
 
     };
@@ -10,13 +10,13 @@
 namespace EDLib {
   namespace Model {
     namespace SingleImpurityAnderson {
-      template<typename prec>
+      template<typename prec, typename State>
       class InnerState {
       public:
-        virtual int valid(long long, int) const {return 0;};
-        virtual void set(long long,long long&, int&, int) const {};
-        int inline checkState(long long nst, int im, int Ns) const {
-          return (int)((nst & (1ll << (2*Ns - 1 - im))) >> (2*Ns - 1 - im));
+        virtual int valid(State, int) const {return 0;};
+        virtual void set(State, State&, int&, int) const {};
+        int inline checkState(State nst, int im, int Ns) const {
+          return (int)((nst & (State(1) << (2*Ns - 1 - im))) >> (2*Ns - 1 - im));
         }
 
         /**
@@ -27,13 +27,13 @@ namespace EDLib {
          * \param isign [out] - fermionic sign
          * \param Ip [in] - number of fermionic sites
          */
-        void inline a(int i, long long jold, long long &k, int &isign, int Ip) const {
+        void inline a(int i, State jold, State &k, int &isign, int Ip) const {
           long long sign = 0;
           for (int ll = 0; ll < i; ++ll) {
-            sign += ((jold & (1ll << (Ip - ll - 1))) != 0) ? 1 : 0;
+            sign += ((jold & (State(1) << (Ip - ll - 1))) != 0) ? 1 : 0;
           }
           isign = (sign % 2) == 0 ? 1 : -1;
-          k = jold - (1ll << (Ip - i - 1));
+          k = jold - (State(1) << (Ip - i - 1));
         }
 
         /**
@@ -44,22 +44,22 @@ namespace EDLib {
          * \param isign [out] - fermionic sign
          * \param Ip [in] - number of fermionic sites
          */
-        void inline adag(int i, long long jold, long long &k, int &isign, int Ip) const {
+        void inline adag(int i, State jold, State &k, int &isign, int Ip) const {
           long long sign = 0;
           for (int ll = 0; ll < i; ++ll) {
-            sign += ((jold & (1ll << (Ip - ll - 1))) != 0) ? 1 : 0;
+            sign += ((jold & (State(1) << (Ip - ll - 1))) != 0) ? 1 : 0;
           }
           isign = (sign % 2) == 0 ? 1 : -1;
-          k = jold + (1ll << (Ip - i - 1));
+          k = jold + (State(1) << (Ip - i - 1));
         }
 
         virtual inline prec value() const { return 0.0; }
       };
-      template<typename prec>
-      class InnerHybridizationState : public InnerState<prec> {
-        using InnerState<prec>::checkState;
-        using InnerState<prec>::a;
-        using InnerState<prec>::adag;
+      template<typename prec, typename State>
+      class InnerHybridizationState : public InnerState<prec, State> {
+        using InnerState<prec, State>::checkState;
+        using InnerState<prec, State>::a;
+        using InnerState<prec, State>::adag;
       public:
         InnerHybridizationState(int ii, int jj, int spin, prec val) : _indicies(ii, jj), _spin(spin), _value(val) {};
 
@@ -68,11 +68,11 @@ namespace EDLib {
         virtual inline prec value() const { return _value; }
 
         inline int spin() const { return _spin; }
-        virtual int valid(long long nst, int Ns) const {
+        virtual int valid(State nst, int Ns) const {
           return (checkState(nst, _indicies.first + _spin * Ns, Ns) * (1 - checkState(nst, _indicies.second + _spin * Ns, Ns)));
         }
-        virtual void set(long long nst,long long&k, int&sign, int Ns) const {
-          long long k1, k2;
+        virtual void set(State nst,State&k, int&sign, int Ns) const {
+          State k1, k2;
           int isign1, isign2;
           a(_indicies.first + _spin * Ns, nst, k1, isign1, 2*Ns);
           adag(_indicies.second + _spin * Ns, k1, k2, isign2, 2*Ns);
@@ -85,11 +85,11 @@ namespace EDLib {
         int _spin;
         prec _value;
       };
-      template<typename prec>
-      class InnerInteractionState : public InnerState<prec> {
-        using InnerState<prec>::checkState;
-        using InnerState<prec>::a;
-        using InnerState<prec>::adag;
+      template<typename prec, typename State>
+      class InnerInteractionState : public InnerState<prec, State> {
+        using InnerState<prec, State>::checkState;
+        using InnerState<prec, State>::a;
+        using InnerState<prec, State>::adag;
       public:
         InnerInteractionState(int i, int j, int k, int l, int sigma, int sigmaprime, prec U) :
           _i(i), _j(j), _k(k), _l(l), _sigma(sigma), _sigmaprime(sigmaprime), _U(U) {}
@@ -123,14 +123,14 @@ namespace EDLib {
          * @param Ns - number of fermionic sites
          * @return One if transition is possible
          */
-        virtual int valid(long long nst, int Ns) const {
+        virtual int valid(State nst, int Ns) const {
           int Ip = 2*Ns;
           if(checkState(nst, _k + _sigma * Ns, Ns) != 0) {
-            long long k3 = nst - (1ll << (Ip - 1 - _k - _sigma * Ns));
+            State k3 = nst - (State(1) << (Ip - 1 - _k - _sigma * Ns));
             if (checkState(k3, _l + _sigmaprime * Ns, Ns) != 0) {
-              long long k4 = k3 - (1ll << (Ip - 1 - _l - _sigmaprime * Ns));
+              State k4 = k3 - (State(1) << (Ip - 1 - _l - _sigmaprime * Ns));
               if (checkState(k4, _j + _sigmaprime * Ns, Ns) == 0) {
-                long long k2 = k4 | (1ll << (Ip - 1 - _j - _sigmaprime * Ns));
+                State k2 = k4 | (State(1) << (Ip - 1 - _j - _sigmaprime * Ns));
                 return (1-checkState(k2, _i + _sigma * Ns, Ns));
               }
             }
@@ -147,8 +147,8 @@ namespace EDLib {
          * @param sign - sign of transition
          * @param Ns - number of fermionic sites
          */
-        virtual void set(long long nst,long long&k, int&sign, int Ns) const {
-          long long k1, k2, k3, k4;
+        virtual void set(State nst,State&k, int&sign, int Ns) const {
+          State k1, k2, k3, k4;
           int isign1, isign2, isign3, isign4;
           a(_k + _sigma * Ns, nst, k3, isign1, 2*Ns);
           a(_l + _sigmaprime * Ns, k3, k4, isign2, 2*Ns);
@@ -174,15 +174,20 @@ namespace EDLib {
         prec _U;
       };
     }
-    template<typename prec>
+    /**
+     * @tparam prec - floating point precision
+     * @tparam Sym - symmetry: Symmetry::SzSymmetry or Symmetry::SzSymmetry128 for baths with more than 31 levels
+     */
+    template<typename prec, class Sym = Symmetry::SzSymmetry>
     class SingleImpurityAndersonModel : public FermionicModel {
     public:
       typedef prec precision;
-      typedef typename Symmetry::SzSymmetry SYMMETRY;
-      typedef typename SingleImpurityAnderson::InnerState<precision> St;
-      typedef typename SingleImpurityAnderson::InnerHybridizationState<precision> HSt;
-      typedef typename SingleImpurityAnderson::InnerInteractionState<precision> USt;
-      typedef typename Symmetry::SzSymmetry::Sector Sector;
+      typedef Sym SYMMETRY;
+      typedef typename Sym::State State;
+      typedef typename SingleImpurityAnderson::InnerState<precision, State> St;
+      typedef typename SingleImpurityAnderson::InnerHybridizationState<precision, State> HSt;
+      typedef typename SingleImpurityAnderson::InnerInteractionState<precision, State> USt;
+      typedef typename Sym::Sector Sector;
 
       SingleImpurityAndersonModel(alps::params &p): FermionicModel(p), _symmetry(p), _ml(p["siam.NORBITALS"]),
                                                     _Epsk(p["siam.NORBITALS"], std::vector<std::vector<double> >()),
@@ -253,7 +258,7 @@ namespace EDLib {
         }
       }
 
-      inline const precision diagonal(long long state) const {
+      inline const precision diagonal(State state) const {
         precision xtemp = 0.0;
         for (int im = 0; im < _ml; ++im) {
           for (int is = 0; is < _ms; ++is) {
@@ -275,20 +280,20 @@ namespace EDLib {
         return xtemp;
       }
 
-      inline long long interacting_states(long long nst) {
-        long long up = 0;
+      inline State interacting_states(State nst) {
+        State up = 0;
         for (int is = 0; is < _ms; ++is) {
           up = nst >> (_Ip - _ml);
         }
-        long long down = (nst & ((1ll<<_Ns) - 1))>>(_Ns-_ml);
+        State down = (nst & ((State(1)<<_Ns) - 1))>>(_Ns-_ml);
         return (up<<_ml) + down;
       }
 
-      inline int valid(const St &state, long long nst) {
+      inline int valid(const St &state, State nst) {
         return state.valid(nst, _Ns);
       }
 
-      inline void set(const St &state, long long nst, long long &k, int &sign) {
+      inline void set(const St &state, State nst, State &k, int &sign) {
         state.set(nst, k, sign, _Ns);
       }
 
@@ -308,6 +313,42 @@ namespace EDLib {
         return _ml;
       }
 
+      /**
+       * @return true if the Hamiltonian is invariant under the exchange of spin-up and spin-down electrons
+       */
+      bool spin_flip_symmetric() const {
+        for (int im = 0; im < _ml; ++im) {
+          if (std::abs(_Eps[im][0] - _Eps[im][1]) > 1e-14) {
+            return false;
+          }
+          for (int ik = 0; ik < _Vk[im].size(); ++ik) {
+            if (std::abs(_Vk[im][ik][0] - _Vk[im][ik][1]) > 1e-14 || std::abs(_Epsk[im][ik][0] - _Epsk[im][ik][1]) > 1e-14) {
+              return false;
+            }
+          }
+        }
+        return true;
+      }
+
+      /**
+       * Total spin projection is not used for the Anderson model: the multi-orbital interaction does not commute
+       * with S^2 in general.
+       *
+       * @return false
+       */
+      bool su2_symmetric() const {
+        return false;
+      }
+
+      /**
+       * Particle-hole transformation is not used for the Anderson model: the bath is not a bipartite lattice in general.
+       *
+       * @return false
+       */
+      bool particle_hole_symmetric(std::vector < int > &sublattice) const {
+        return false;
+      }
+
     private:
       SYMMETRY _symmetry;
       int _ml;
@@ -5,18 +5,30 @@
 #ifndef HUBBARD_SPINRESOLVEDSTORAGE_H
 #define HUBBARD_SPINRESOLVEDSTORAGE_H
 
+#include <algorithm>
 #include <bitset>
+#include <climits>
 #include <iomanip>
+#include <map>
+#include <stdexcept>
 #include <type_traits>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "Storage.h"
+#include "RowAccumulator.h"
 #include "SzSymmetry.h"
 #include "NSymmetry.h"
 
 namespace EDLib {
   namespace Storage {
 
-    template<class Model>
+    /**
+     * @tparam Model - model to diagonalize, its precision is used for the vectors and the eigensolver
+     * @tparam value_prec - precision of the stored matrix elements
+     */
+    template<class Model, typename value_prec = typename Model::precision>
     class SpinResolvedStorage : public Storage < typename Model::precision > {
       typedef typename Model::precision prec;
       static_assert(std::is_base_of<Symmetry::SzSymmetry, typename Model::SYMMETRY>::value, "Model have wrong symmetry.");
@@ -32,9 +44,10 @@ namespace EDLib {
 
       /**
        * Simple CRS matrix class. This class is used to store hopping matrices and off-diagonal interactions
-       * @tparam p
+       * @tparam p - precision of the stored values, the rows are accumulated in the vector precision
+       * @tparam Index - type of the column indices
        */
-      template<typename p>
+      template<typename p, typename Index = int>
       class CRSMatrix {
       public:
         CRSMatrix() {
@@ -51,6 +64,7 @@ namespace EDLib {
           _col_ind.assign(_nnz, 0);
           _row_ptr.assign(N + 1, 0);
           _vind = 0;
+          _row.reset();
         }
 
         /**
@@ -61,97 +75,120 @@ namespace EDLib {
          * @param t - value
          * @param sign - fermionic sign
          */
-        void inline addElement(int i, int j, prec t, int sign) {
-          /// flag that we already have data for (i,j)
-          bool hasstate = false;
-          /// index of (i,j) element in spare storage
-          size_t foundstate = 0;
+        void inline addElement(size_t i, Index j, prec t, int sign) {
           if (std::abs(t) == 0) {
             return;
           }
-          /// check that there is no any data on the k state
           /// In case of off-diagonal interaction there can be multiple possible transition from i-state to j-state
-          for (int iii = _row_ptr[i]; iii < _vind; ++iii) {
-            if (_col_ind[iii] == j) {
-              hasstate = true;
-              foundstate = iii;
-            }
-          }
-          if(hasstate) {
-            /// update existing value
-            _values[foundstate] += sign * t;
-          }else {
-            /// create new element in CRS arrays
-            _col_ind[_vind] = j;
-            _values[_vind] = sign * t;
-            ++_vind;
-            /// check that we have exceed the upper bound
-            if(_vind == _nnz) {
-              /// resize storage
-              _nnz *= 2;
-              _values.resize(_nnz);
-              _col_ind.resize(_nnz);
-            }
-          }
+          _row.add(j, sign * t);
         }
 
-        /// some of the interaction terms can compensate each other
-        /// in this case we need to remove zero elements from storage to reduce required memory and communications
-        void inline compress(int i) {
-          int shift = 0;
-          for (int iii = _row_ptr[i]; iii < _vind; ++iii){
-            if(std::abs(_values[iii])<1e-15) {
-              for(int kkk = iii; kkk<_vind-1; ++kkk) {
-                _values[kkk] = _values[kkk+1];
-                _col_ind[kkk] = _col_ind[kkk+1];
-              }
-              --_vind;
-            }
+        /**
+         * Store accumulated i-th row in CRS arrays.
+         * Some of the interaction terms can compensate each other,
+         * in this case we remove zero elements from storage to reduce required memory and communications
+         */
+        void inline endLine(size_t i) {
+          if (_vind + _row.size() > _nnz) {
+            /// resize storage
+            _nnz = std::max(2 * _nnz, _vind + _row.size());
+            _values.resize(_nnz);
+            _col_ind.resize(_nnz);
           }
+          _vind += _row.flush(_col_ind.data() + _vind, _values.data() + _vind, prec(1e-15));
+          _row.reset();
+          _row_ptr[i + 1] = _vind;
         }
 
-        void inline endLine(int i) {
-          compress(i);
-          _row_ptr[i + 1] = _vind;
+        /**
+         * Concatenate matrices built for the consecutive blocks of rows
+         *
+         * @param parts -- matrices for each block of rows
+         */
+        void join(const std::vector < CRSMatrix < p, Index > > &parts) {
+          size_t rows = 0;
+          _nnz = 0;
+          for (size_t ip = 0; ip < parts.size(); ++ip) {
+            rows += parts[ip]._row_ptr.size() - 1;
+            _nnz += parts[ip]._vind;
+          }
+          _values.resize(_nnz);
+          _col_ind.resize(_nnz);
+          _row_ptr.assign(rows + 1, 0);
+          _vind = 0;
+          size_t row = 0;
+          for (size_t ip = 0; ip < parts.size(); ++ip) {
+            const CRSMatrix < p, Index > &part = parts[ip];
+            std::copy(part._values.begin(), part._values.begin() + part._vind, _values.begin() + _vind);
+            std::copy(part._col_ind.begin(), part._col_ind.begin() + part._vind, _col_ind.begin() + _vind);
+            for (size_t i = 1; i < part._row_ptr.size(); ++i) {
+              _row_ptr[row + i] = part._row_ptr[i] + _vind;
+            }
+            row += part._row_ptr.size() - 1;
+            _vind += part._vind;
+          }
+          _row.reset();
         }
 
-        std::vector < int > &row_ptr() {
+        std::vector < size_t > &row_ptr() {
           return _row_ptr;
         };
 
-        std::vector < int > &col_ind() {
+        std::vector < Index > &col_ind() {
           return _col_ind;
         }
 
-        std::vector < prec > &values() {
+        std::vector < p > &values() {
           return _values;
         }
 
       private:
         /// matrix values
-        std::vector < prec > _values;
-        /// pointer to a row
-        std::vector < int > _row_ptr;
+        std::vector < p > _values;
+        /// pointer to a row, the number of non-zero elements can exceed 2^31
+        std::vector < size_t > _row_ptr;
         /// column indices
-        std::vector < int > _col_ind;
+        std::vector < Index > _col_ind;
         /// internal index of non-zero values
-        int _vind;
+        size_t _vind;
         /// number of non-zero elements allocated in memory
         size_t _nnz;
+        /// accumulator for the current row
+        RowAccumulator < prec, Index > _row;
       };
 
-      typedef CRSMatrix < prec > Matrix;
+      typedef CRSMatrix < value_prec > Matrix;
+      /// off-diagonal interaction with the column indices in the whole sector, which can exceed 2^31
+      typedef CRSMatrix < value_prec, long long > GlobalMatrix;
 
 #ifdef USE_MPI
       SpinResolvedStorage(alps::params &p, Model &m, MPI_Comm comm) : Storage < prec >(p, comm), _comm(comm), _model(m),_interaction_size(m.interacting_orbitals()),
                                                                       _Ns(p["NSITES"].as<int>()), _ms(p["NSPINS"].as<int>()), _up_symmetry(p["NSITES"].as<int>()),
-                                                                      _down_symmetry(p["NSITES"].as<int>()) {
+                                                                      _down_symmetry(p["NSITES"].as<int>()),
+                                                                      _split_down(false), _cache(nullptr), _neighbour_exchange(p.exists("spinstorage.COMMUNICATION") && p["spinstorage.COMMUNICATION"].as<std::string>() == "NEIGHBOR"),
+                                                                      _neighbour_comm(MPI_COMM_NULL) {
         MPI_Comm_size(_comm, &_nprocs);
         MPI_Comm_rank(_comm, &_myid);
       }
+
+      /**
+       * Release cached working communicators and communication windows.
+       * Cached objects are created collectively on all CPUs of the global communicator in the same order,
+       * so they are also released collectively here.
+       */
+      virtual ~SpinResolvedStorage() {
+        int finalized;
+        MPI_Finalized(&finalized);
+        if(finalized) return;
+        for(typename std::map<int, CommCache>::iterator it = _comm_cache.begin(); it != _comm_cache.end(); ++it) {
+          if(it->second.win != MPI_WIN_NULL) MPI_Win_free(&it->second.win);
+          if(it->second.comm != MPI_COMM_NULL) MPI_Comm_free(&it->second.comm);
+        }
+      }
 #else
       SpinResolvedStorage(alps::params &p, Model &m) : Storage < prec >(p), _model(m), _interaction_size(m.interacting_orbitals()),
-                                                   _Ns(p["NSITES"]), _ms(p["NSPINS"]), _up_symmetry(int(p["NSITES"])), _down_symmetry(int(p["NSITES"])) {}
+                                                   _Ns(p["NSITES"]), _ms(p["NSPINS"]), _up_symmetry(int(p["NSITES"])), _down_symmetry(int(p["NSITES"])),
+                                                   _split_down(false) {}
 #endif
 
       virtual void zero_eigenapair() {
@@ -160,63 +197,171 @@ namespace EDLib {
         Storage < prec >::eigenvectors().assign(1, std::vector < prec >(1, prec(1.0)));
       }
 
-      virtual void av(prec *v, prec *w, int n, bool clear = true) {
+      virtual void diagonal(std::vector < prec > &d) {
+        d.assign(_diagonal.begin(), _diagonal.end());
+      }
+
+      virtual void av(prec *v, prec *w, size_t n, bool clear = true) {
 #ifdef USE_MPI
         /// Initialize inter-processor communications
         /// we collect all data from the remote processes into _vecval array
-        MPI_Win_fence(MPI_MODE_NOPRECEDE, _win);
-        for(int i = 0; i<_procs.size(); ++i) {
-          if(_procs[i]!=0)
-          MPI_Get(&_vecval[_proc_offset[i]], _proc_size[i], alps::mpi::detail::mpi_type<prec>(), i, _loc_min[i], _proc_size[i], alps::mpi::detail::mpi_type<prec>(), _win);
-        }
-#endif
-        /// Iteration over diagonal contribution.
-        for (int i = 0; i < n; ++i) {
-          /// Diagonal contribution.
-          w[i] = _diagonal[i] * v[i] + (clear ? 0.0 : w[i]);
-        }
-        /// Off-diagonal contribution. Process spin-down contribution for each spin-up block
-        /// iterate over spin-up blocks
-        for (int k = 0; k < _up_size; ++k) {
-          /// Iteration over rows.
-          for (int i = 0; i < _down_symmetry.sector().size(); ++i) {
+        MPI_Request request;
+        if (_neighbour_exchange) {
+          MPI_Ineighbor_alltoallv(v, _send_size.data(), _send_offset.data(), alps::mpi::detail::mpi_type<prec>(),
+                                  _vecval.data(), _recv_size.data(), _recv_offset.data(), alps::mpi::detail::mpi_type<prec>(), _neighbour_comm, &request);
+        } else {
+          /// expose current vector through the cached window memory
+          std::copy(v, v + n, _cache->buffer);
+          MPI_Win_fence(MPI_MODE_NOPRECEDE, _win);
+          for (int i = 0; i < _procs.size(); ++i) {
+            if (_procs[i] != 0)
+              MPI_Get(&_vecval[_proc_offset[i]], _proc_size[i], alps::mpi::detail::mpi_type<prec>(), i, _loc_min[i], _proc_size[i], alps::mpi::detail::mpi_type<prec>(), _win);
+          }
+        }
+#endif
+        size_t down_size = _down_symmetry.sector().size();
+        if (_split_down) {
+          /// the sector is split along the spin-down index, all hoppings are stored in H_loc
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+          for (long long i = 0; i < (long long) _locsize; ++i) {
+            w[i] = prec(_diagonal[i]) * v[i] + (clear ? prec(0.0) : w[i]);
+          }
+        }
+        /// Diagonal and spin-down hopping contribution.
+        /// Vector is treated as a dense (up_size x down_size) matrix, the spin-down hopping is applied to
+        /// a block of UP_BLOCK rows at once, so each element of H_down is loaded only once per block.
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (int kb = 0; kb < int(_up_size); kb += UP_BLOCK) {
+          int kmax = std::min(kb + UP_BLOCK, int(_up_size));
+          for (int i = 0; i < down_size; ++i) {
+            prec wi[UP_BLOCK];
+            for (int k = kb; k < kmax; ++k) {
+              size_t ind = k * down_size + i;
+              wi[k - kb] = prec(_diagonal[ind]) * v[ind] + (clear ? prec(0.0) : w[ind]);
+            }
             /// Iteration over columns.
-            for (int j = H_down.row_ptr()[i]; j < H_down.row_ptr()[i + 1]; ++j) {
-              w[i + k * _down_symmetry.sector().size()] += H_down.values()[j] * v[H_down.col_ind()[j] + k * _down_symmetry.sector().size()];
+            for (size_t j = H_down.row_ptr()[i]; j < H_down.row_ptr()[i + 1]; ++j) {
+              prec value = H_down.values()[j];
+              const prec *vj = v + H_down.col_ind()[j];
+              for (int k = kb; k < kmax; ++k) {
+                wi[k - kb] += value * vj[k * down_size];
+              }
+            }
+            for (int k = kb; k < kmax; ++k) {
+              w[k * down_size + i] = wi[k - kb];
             }
           }
         }
 #ifdef USE_MPI
+        /// Compute contributions from the local part of the vector while remote data is in flight
+        up_product(H_up_local, 0, v, w);
+        loc_product(H_loc, v, w, n);
         /// Waiting for the data to be received
-        MPI_Win_fence(MPI_MODE_NOSUCCEED | MPI_MODE_NOPUT | MPI_MODE_NOSTORE, _win);
-#endif
+        if (_neighbour_exchange) {
+          MPI_Wait(&request, MPI_STATUS_IGNORE);
+        } else {
+          MPI_Win_fence(MPI_MODE_NOSUCCEED | MPI_MODE_NOPUT | MPI_MODE_NOSTORE, _win);
+        }
+        /// Compute contributions from the remote part of the vector
+        up_product(H_up_remote, 0, _vecval.data(), w);
+        loc_product(H_loc_remote, _vecval.data(), w, n);
+#else
         /// Process spin-up hopping contribution
-        /// Iteration over rows.
-        for (int i = 0; i < _up_size; ++i) {
-          /// Iteration over columns.
-          for (int j = H_up.row_ptr()[i+_up_shift]; j < H_up.row_ptr()[i + _up_shift + 1]; ++j) {
-            for (int k = 0; k < _down_symmetry.sector().size(); ++k) {
+        up_product(H_up, _up_shift, v, w);
+        /// Off-diagonal interaction contribution
+        loc_product(H_loc, v, w, n);
+#endif
+      }
+
+      /**
+       * Product with k vectors in the interleaved layout, V[i * k + j] is the i-th element of the j-th vector.
+       * Each element of the hopping and interaction matrices is loaded once for all k vectors, remote parts of
+       * the vectors are exchanged in a single message per neighbour CPU.
+       */
+      virtual void av_block(const prec *V, prec *W, size_t n, int k) {
 #ifdef USE_MPI
-              w[i * _down_symmetry.sector().size() + k] += H_up.values()[j] * _vecval[H_up.col_ind()[j] * _down_symmetry.sector().size() + k];
-#else
-              w[i * _down_symmetry.sector().size() + k] += H_up.values()[j] * v[H_up.col_ind()[j] * _down_symmetry.sector().size() + k];
+        MPI_Request request;
+        if (k > _max_block) {
+          throw std::overflow_error("Block of vectors is too large for MPI communications, reduce the block size or use more CPUs.");
+        }
+        if (_vecval.size() < _halo_size * k) {
+          _vecval.resize(_halo_size * k);
+        }
+        if (_neighbour_exchange) {
+          std::vector<int> send_size(_send_size.size()), send_offset(_send_size.size()), recv_size(_recv_size.size()), recv_offset(_recv_size.size());
+          for (size_t i = 0; i < send_size.size(); ++i) {
+            send_size[i] = block_count(_send_size[i], k);
+            send_offset[i] = block_count(_send_offset[i], k);
+          }
+          for (size_t i = 0; i < recv_size.size(); ++i) {
+            recv_size[i] = block_count(_recv_size[i], k);
+            recv_offset[i] = block_count(_recv_offset[i], k);
+          }
+          MPI_Ineighbor_alltoallv(V, send_size.data(), send_offset.data(), alps::mpi::detail::mpi_type<prec>(),
+                                  _vecval.data(), recv_size.data(), recv_offset.data(), alps::mpi::detail::mpi_type<prec>(), _neighbour_comm, &request);
+        } else {
+          reserve_window(k);
+          std::copy(V, V + n * k, _cache->buffer);
+          MPI_Win_fence(MPI_MODE_NOPRECEDE, _win);
+          for (int i = 0; i < _procs.size(); ++i) {
+            if (_procs[i] != 0)
+              MPI_Get(&_vecval[size_t(_proc_offset[i]) * k], block_count(_proc_size[i], k), alps::mpi::detail::mpi_type<prec>(), i,
+                      MPI_Aint(_loc_min[i]) * k, block_count(_proc_size[i], k), alps::mpi::detail::mpi_type<prec>(), _win);
+          }
+        }
 #endif
+        size_t down_size = _down_symmetry.sector().size();
+        /// Diagonal and spin-down hopping contribution
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        {
+          std::vector < prec > acc(k);
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+          for (long long r = 0; r < (long long) _locsize; ++r) {
+            const prec *vr = V + r * k;
+            for (int j = 0; j < k; ++j) {
+              acc[j] = prec(_diagonal[r]) * vr[j];
             }
+            if (_split_down) {
+              std::copy(acc.begin(), acc.end(), W + r * k);
+              continue;
+            }
+            size_t i = size_t(r) % down_size;
+            const prec *vrow = V + (r - i) * k;
+            for (size_t jj = H_down.row_ptr()[i]; jj < H_down.row_ptr()[i + 1]; ++jj) {
+              prec value = H_down.values()[jj];
+              const prec *vc = vrow + size_t(H_down.col_ind()[jj]) * k;
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+              for (int j = 0; j < k; ++j) {
+                acc[j] += value * vc[j];
+              }
+            }
+            std::copy(acc.begin(), acc.end(), W + r * k);
           }
         }
-
-        /// Off-diagonal interaction contribution
-        /// Check that we have off-diagonal interaction elements
-        if(H_loc.row_ptr().size()!=0)
-        for (size_t i = _int_start; i < n; ++i) {
-          for (int j = H_loc.row_ptr()[i]; j < H_loc.row_ptr()[i + 1]; ++j) {
 #ifdef USE_MPI
-            w[i] += H_loc.values()[j] * _vecval[H_loc.col_ind()[j]];
+        up_product(H_up_local, 0, V, W, k);
+        loc_product(H_loc, V, W, n, k);
+        if (_neighbour_exchange) {
+          MPI_Wait(&request, MPI_STATUS_IGNORE);
+        } else {
+          MPI_Win_fence(MPI_MODE_NOSUCCEED | MPI_MODE_NOPUT | MPI_MODE_NOSTORE, _win);
+        }
+        up_product(H_up_remote, 0, _vecval.data(), W, k);
+        loc_product(H_loc_remote, _vecval.data(), W, n, k);
 #else
-            w[i] += H_loc.values()[j] * v[H_loc.col_ind()[j]];
+        up_product(H_up, _up_shift, V, W, k);
+        loc_product(H_loc, V, W, n, k);
 #endif
-          }
-        }
       }
 
       void fill() {
@@ -226,33 +371,81 @@ namespace EDLib {
           return;
         }
         /// Hopping term
-        /// fill off-diagonal matrix for each spin
-        fill_spin(_up_symmetry, _Ns, H_up);
-        fill_spin(_down_symmetry, 0, H_down);
+        /// fill off-diagonal matrix for each spin, if the sector is split along the spin-down index hoppings are stored in H_loc
+        if (!_split_down) {
+          fill_spin(_up_symmetry, _Ns, H_up);
+          fill_spin(_down_symmetry, 0, H_down);
+        }
         /// fill local part;
-        int isign;
-        long long k;
-        _int_start = _locsize;
-        for(size_t i =0; i<_locsize; ++i) {
-          _model.symmetry().next_state();
-          long long nst = _model.symmetry().state();
-          /// add diagonal contribution
-          _diagonal[i] = _model.diagonal(nst);
-          /// Add off-diagonal contribution from interaction term
-          if(_model.V_states().size() > 0) {
-            for (int kkk = 0; kkk < _model.V_states().size(); ++kkk) {
-              if (_model.valid(_model.V_states()[kkk], nst)) {
-                _int_start = std::min(i, _int_start);
-                _model.set(_model.V_states()[kkk], nst, k, isign);
-                int j = _model.symmetry().index(k);
-                H_loc.addElement(i, j, _model.V_states()[kkk].value(), isign);
+        /// local rows are split into contiguous blocks, each thread fills its own block of H_loc
+        /// and the blocks are concatenated afterwards
+        size_t offset = 0;
+#ifdef USE_MPI
+        offset = _offset;
+#endif
+#ifdef _OPENMP
+        int nthreads = omp_get_max_threads();
+#else
+        int nthreads = 1;
+#endif
+        std::vector < GlobalMatrix > parts(_model.V_states().size() > 0 || _split_down ? nthreads : 0);
+        std::vector < size_t > int_start(nthreads, _locsize);
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads)
+        {
+          int myid = omp_get_thread_num();
+          int nth = omp_get_num_threads();
+#else
+        {
+          int myid = 0;
+          int nth = 1;
+#endif
+          for (int tid = myid; tid < nthreads; tid += nth) {
+            size_t first = _locsize * tid / nthreads;
+            size_t last = _locsize * (tid + 1) / nthreads;
+            if (!parts.empty()) {
+              parts[tid].init(last - first, 3);
+            }
+            for (size_t i = first; i < last; ++i) {
+              typename Model::State nst = _model.symmetry().state_by_index(offset + i);
+              /// add diagonal contribution
+              _diagonal[i] = value_prec(_model.diagonal(nst));
+              /// Add off-diagonal contribution from interaction term
+              if (!parts.empty()) {
+                bool found = off_diagonal(_model.V_states(), nst, i - first, parts[tid]);
+                if (_split_down) {
+                  found = off_diagonal(_model.T_states(), nst, i - first, parts[tid]) || found;
+                }
+                if (found) {
+                  int_start[tid] = std::min(i, int_start[tid]);
+                }
+                parts[tid].endLine(i - first);
               }
             }
-            H_loc.endLine(i);
           }
         }
+        _int_start = *std::min_element(int_start.begin(), int_start.end());
+        GlobalMatrix H_global;
+        if (!parts.empty()) {
+          H_global.join(parts);
+        }
 #ifdef USE_MPI
-        find_neighbours();
+        find_neighbours(H_global);
+#else
+        /// the local part is the whole sector, so the global columns are the local ones
+        H_loc = Matrix();
+        if (!parts.empty()) {
+          if (_locsize > size_t(INT_MAX)) {
+            throw std::overflow_error("Off-diagonal interaction in the sectors larger than 2^31 requires MPI distribution.");
+          }
+          H_loc.init(_locsize, H_global.row_ptr()[_locsize] / _locsize + 1);
+          for (size_t i = 0; i < _locsize; ++i) {
+            for (size_t j = H_global.row_ptr()[i]; j < H_global.row_ptr()[i + 1]; ++j) {
+              H_loc.addElement(i, int(H_global.col_ind()[j]), H_global.values()[j], 1);
+            }
+            H_loc.endLine(i);
+          }
+        }
 #endif
       }
 
@@ -275,34 +468,52 @@ namespace EDLib {
         H_up.init(up_size, 100);
         H_down.init(down_size, 100);
 #ifdef USE_MPI
-        MPI_Comm run_comm;
-        /// check that there is data for the current CPU
-        int color = _myid < up_size ? 1 : MPI_UNDEFINED;
-        /// Create new MPI communicator for the processors with defined color
-        MPI_Comm_split(_comm, color, _myid, &run_comm);
-        if(color == 1) {
+        /// distribution of the current sector, computed collectively on all CPUs of the global communicator
+        const std::vector<size_t> &bounds = partition(sector.nup(), sector.ndown());
+        _split_down = split_down(sector.nup());
+        _row_size = row_size(sector.nup(), sector.ndown());
+        /// the sector can exceed 2^31 elements but the local indices are 32-bit, bounds are the same on all CPUs
+        for(size_t ip = 0; ip + 1 < bounds.size(); ++ip) {
+          if((bounds[ip + 1] - bounds[ip]) * _row_size > size_t(INT_MAX)) {
+            throw std::overflow_error("Local part of the sector exceeds 2^31 elements, use more CPUs.");
+          }
+        }
+        /// number of CPUs that have data in the current sector
+        int active = int(bounds.size() - 1);
+        /// Working communicator depends only on the number of active CPUs, which is the same on all CPUs,
+        /// so the cache is hit or missed collectively
+        typename std::map<int, CommCache>::iterator cached = _comm_cache.find(active);
+        if(cached == _comm_cache.end()) {
+          CommCache entry;
+          /// check that there is data for the current CPU
+          int color = _myid < active ? 1 : MPI_UNDEFINED;
+          /// Create new MPI communicator for the processors with defined color
+          MPI_Comm_split(_comm, color, _myid, &entry.comm);
+          entry.win = MPI_WIN_NULL;
+          entry.buffer = nullptr;
+          entry.capacity = 0;
+          cached = _comm_cache.insert(std::make_pair(active, entry)).first;
+        }
+        _cache = &cached->second;
+        if(_cache->comm != MPI_COMM_NULL) {
           /// there is data for current CPU
           /// update working communicator
-          _run_comm = run_comm;
+          _run_comm = _cache->comm;
           /// get CPU rank and size for recently created working communicator
           int myid;
           MPI_Comm_rank(_run_comm,&myid);
           int size;
           MPI_Comm_size(_run_comm,&size);
           /// compute the size of local arrays and the offset from the beginning
-          int locsize = up_size / size;
-          if ((up_size % size) > myid) {
-            locsize += 1;
-            _offset =  myid * locsize* _down_symmetry.sector().size();
-          } else {
-            _offset = (myid* locsize + (up_size % size))* _down_symmetry.sector().size();
-          }
-          /// local dimension for the spin-up hopping Hamiltonian matrix
-          _up_size = locsize;
+          _up_bounds = bounds;
+          size_t locsize = _up_bounds[myid + 1] - _up_bounds[myid];
+          _offset = _up_bounds[myid] * _row_size;
+          /// local dimension for the spin-up hopping Hamiltonian matrix, there is no spin-up hopping matrix if the sector is split along the spin-down index
+          _up_size = _split_down ? 0 : locsize;
           /// offet in the spin-up channel
-          _up_shift = _offset / down_size;
+          _up_shift = _split_down ? 0 : _up_bounds[myid];
           /// local dimension for the whole Hamiltonian matrix
-          _locsize = locsize * down_size;
+          _locsize = locsize * _row_size;
           /// apply offset to the symmetry object to generate proper configuration state
           _model.symmetry().set_offset(_offset);
           /// inter processor communactions
@@ -317,6 +528,7 @@ namespace EDLib {
         } else {
           _up_size = 0;
           _locsize=0;
+          _max_block = INT_MAX;
         }
 #else
         _locsize = up_size*down_size;
@@ -324,18 +536,54 @@ namespace EDLib {
         _up_shift = 0;
 #endif
         /// allocate memory for local Hamiltonian
-        /// density-density contribution
-        _diagonal.assign(_locsize, prec(0.0));
-        /// off-diagonal contribution
-        if(_model.V_states().size()>0) {
-          H_loc.init(_locsize, 3);
-        }
+        /// density-density contribution, off-diagonal contribution is allocated in fill()
+        _diagonal.assign(_locsize, value_prec(0.0));
         /// local dimension of the Hamiltonian matrix
         n() = _locsize;
         /// total dimension of the Hamiltonian matrix
         ntot() = sector.size();
       }
 
+      /**
+       * @return number of non-zero elements of the local part of the Hamiltonian matrix
+       */
+      size_t nnz() {
+        if (n() == 0) {
+          return 0;
+        }
+        size_t down_size = _down_symmetry.sector().size();
+        size_t result = _locsize + _up_size * H_down.row_ptr()[down_size] + down_size * (H_up.row_ptr()[_up_shift + _up_size] - H_up.row_ptr()[_up_shift]);
+        if (H_loc.row_ptr().size() != 0) {
+          result += H_loc.row_ptr()[_locsize];
+        }
+#ifdef USE_MPI
+        if (H_loc_remote.row_ptr().size() != 0) {
+          result += H_loc_remote.row_ptr()[_locsize];
+        }
+#endif
+        return result;
+      }
+
+      /**
+       * @return number of non-zero elements stored in spin-up and spin-down hopping matrices and in off-diagonal interaction matrix
+       */
+      size_t stored_nnz() {
+        if (n() == 0) {
+          return 0;
+        }
+        size_t result = H_down.row_ptr()[_down_symmetry.sector().size()] + H_up.row_ptr()[_up_symmetry.sector().size()];
+        if (H_loc.row_ptr().size() != 0) {
+          result += H_loc.row_ptr()[_locsize];
+        }
+#ifdef USE_MPI
+        result += H_up_local.row_ptr()[_up_size] + H_up_remote.row_ptr()[_up_size];
+        if (H_loc_remote.row_ptr().size() != 0) {
+          result += H_loc_remote.row_ptr()[_locsize];
+        }
+#endif
+        return result;
+      }
+
       /**
        * Compute local dimension for the specific sector
        * @param sector -- symmetry sector to compute dimension
@@ -349,20 +597,13 @@ namespace EDLib {
         /// get rank and size for current CPU in the global communicator
         MPI_Comm_rank(_comm,&myid);
         MPI_Comm_size(_comm,&size);
-        size_t up_size = _model.symmetry().comb().c_n_k(_Ns, sector.nup());
-        size_t down_size = sector_size / up_size;
-        size = up_size>size ? size : up_size;
+        const std::vector<size_t> &bounds = partition(sector.nup(), sector.ndown());
         /// there is no data for current CPU
-        if(myid >= size) {
+        if(myid + 1 >= bounds.size()) {
           return 0;
         }
-        /// compute local dimension for the spin-up channel
-        size_t locsize = up_size / size;
-        if ((up_size % size) > myid) {
-          locsize += 1;
-        }
         /// compute and return the total dimension
-        return locsize * down_size;
+        return (bounds[myid + 1] - bounds[myid]) * row_size(sector.nup(), sector.ndown());
 #else
         return sector_size;
 #endif
@@ -382,12 +623,6 @@ namespace EDLib {
         size_t locsize = invec.size();
         /// maximal local dimension of current vector
         size_t locsize_max = locsize;
-        /// dimension of the resulting symmetry sector
-        size_t next_size = next_sec.size();
-        /// dimension of spin-up channel Hamiltonian matrix
-        size_t up_size = _model.symmetry().comb().c_n_k(_Ns, next_sec.nup());
-        /// dimension of spin-down channel Hamiltonian matrix
-        size_t down_size = next_size / up_size;
         long long k;
         int sign;
 #ifdef USE_MPI
@@ -400,10 +635,14 @@ namespace EDLib {
         int t = 0;
         /// synchronization flag
         bool fence = false;
-        /// adjust maximal local dimension
-        if(_up_symmetry.sector().size()%size != 0) {
-          locsize_max+= _down_symmetry.sector().size();
+        /// maximal local dimension over all CPUs
+        const std::vector<size_t> &bounds = partition(_up_symmetry.sector().n(), _down_symmetry.sector().n());
+        for(size_t ip = 0; ip + 1 < bounds.size(); ++ip) {
+          locsize_max = std::max(locsize_max, (bounds[ip + 1] - bounds[ip]) * _row_size);
         }
+        /// distribution of the resulting vector
+        const std::vector<size_t> &next_bounds = partition(next_sec.nup(), next_sec.ndown());
+        size_t next_row_size = row_size(next_sec.nup(), next_sec.ndown());
         /// communication buffer
         std::vector<prec> buff(1000, 0.0);
         /// communication window
@@ -422,18 +661,16 @@ namespace EDLib {
           /// destroy (create) particle if index is within boundary
           if(ind<locsize) {
             _model.symmetry().next_state();
-            long long nst = _model.symmetry().state();
+            typename Model::State nst = _model.symmetry().state();
             /// check that particle can be destroyed (created)
             if (_model.checkState(nst, i, _model.max_total_electrons()) == (a ? 1 : 0)) {
               if (a) _model.a(i, nst, k, sign);
               else _model.adag(i, nst, k, sign);
               /// compute index of the new state
-              int i1 = _model.symmetry().index(k, next_sec);
+              long long i1 = _model.symmetry().index(k, next_sec);
 #ifdef USE_MPI
-              int size;
-              MPI_Comm_size(_run_comm, &size);
               /// compute CPU id and local index of new state
-              calcIndex(ci, cid, i1, up_size, down_size, size);
+              calcIndex(ci, cid, i1, next_bounds, next_row_size);
               /// avoid intra-CPU MPI communications
               if(myid == cid) {
                 outvec[ci] = sign * invec[ind];
@@ -473,7 +710,11 @@ namespace EDLib {
       prec vv(const std::vector<prec> & v, const std::vector<prec> & w) {
         prec alf = prec(0.0);
         prec temp = prec(0.0);
-        for (int k = 0; k < v.size(); ++k) {
+        int size = v.size();
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+:temp) schedule(static)
+#endif
+        for (int k = 0; k < size; ++k) {
           temp += w[k] * v[k];
         }
 #ifdef USE_MPI
@@ -486,21 +727,45 @@ namespace EDLib {
 
 #ifdef USE_MPI
       /**
-       * Initialize the communication window for the *data object from the specific offset
+       * Prepare inter-process communications for the current sector.
+       * In RMA mode the communication window is allocated by MPI_Win_allocate once for each working communicator and
+       * reused for all subsequent sectors and Lanczos runs. The window is only reallocated when the largest local
+       * vector in the current sector does not fit into it. The vector is copied into the window memory in av(),
+       * so the data array itself is not exposed.
+       * In case of neighbourhood collectives create distributed graph communicator instead.
        * @param data -- input array
        * @param shift -- offset in the input array
        */
       virtual void prepare_work_arrays(prec * data, size_t shift = 0) {
-//        if(MPI_WIN_NULL != _win){
-//          // TODO: handle already allocated window
-//        }
-        MPI_Info info;
-        MPI_Info_create( &info );
-        MPI_Info_set( info, (char *) "no_locks", (char *) "true");
-        MPI_Win_create(&data[shift], n() * sizeof(prec), sizeof(prec), info, _run_comm, &_win);
-        MPI_Info_free(&info);
+        if(_neighbour_exchange) {
+          MPI_Dist_graph_create_adjacent(_run_comm, _sources.size(), _sources.data(), MPI_UNWEIGHTED,
+                                         _destinations.size(), _destinations.data(), MPI_UNWEIGHTED, MPI_INFO_NULL, 0, &_neighbour_comm);
+          return;
+        }
+        reserve_window(1);
+      }
+
+      /**
+       * Make the communication window large enough for k vectors. Collective in the working communicator.
+       */
+      void reserve_window(int k) {
         int size;
         MPI_Comm_size(_run_comm, &size);
+        /// the largest local vector size is the same on all CPUs of the working communicator
+        size_t max_size = 0;
+        for(int ip = 0; ip < size; ++ip) {
+          max_size = std::max(max_size, (_up_bounds[ip + 1] - _up_bounds[ip]) * _row_size * k);
+        }
+        if(_cache->capacity < max_size) {
+          if(_cache->win != MPI_WIN_NULL) MPI_Win_free(&_cache->win);
+          MPI_Info info;
+          MPI_Info_create( &info );
+          MPI_Info_set( info, (char *) "no_locks", (char *) "true");
+          MPI_Win_allocate(max_size * sizeof(prec), sizeof(prec), info, _run_comm, &_cache->buffer, &_cache->win);
+          MPI_Info_free(&info);
+          _cache->capacity = max_size;
+        }
+        _win = _cache->win;
       }
 
       /**
@@ -512,8 +777,8 @@ namespace EDLib {
       }
 
       /**
-       * Finalize current MPI execution. Broadcast eigenvalues if necessary. Release window and communicator.
-       * Set the global MPI communicator as the current MPI communicator.
+       * Finalize current MPI execution. Broadcast eigenvalues if necessary. Working communicator and window are kept
+       * in the cache for the next sector. Set the global MPI communicator as the current MPI communicator.
        */
       virtual int finalize(int info, bool bcast = true, bool empty = true) {
         MPI_Bcast(&info,1, MPI_INT, 0, Storage<prec>::comm());
@@ -521,9 +786,9 @@ namespace EDLib {
           if(bcast) broadcast_evals(empty);
         }
         if(ntot() > 1 && n() > 0) {
-          MPI_Win_free(&_win);
-          MPI_Comm run_comm = _run_comm;
-          MPI_Comm_free(&run_comm);
+          if(_neighbour_exchange) {
+            MPI_Comm_free(&_neighbour_comm);
+          }
           _run_comm = Storage < prec >::comm();
         }
         return info;
@@ -535,6 +800,11 @@ namespace EDLib {
 #endif
 
     private:
+      /// number of spin-up rows processed at once in spin-down hopping product
+      static const int UP_BLOCK = 8;
+      /// number of spin-down elements processed at once in spin-up hopping product
+      static const size_t DOWN_BLOCK = 2048;
+
       /// Current model
       Model &_model;
       /// Off-diagonal part of local Hamiltonian
@@ -545,7 +815,7 @@ namespace EDLib {
       Matrix H_down;
 
       /// diagonal part
-      std::vector < prec > _diagonal;
+      std::vector < value_prec > _diagonal;
       /// array to store remote processes communication data
       std::vector < prec > _vecval;
 
@@ -567,6 +837,8 @@ namespace EDLib {
       size_t _locsize;
       /// staring index in interaction Hamiltonian
       size_t _int_start;
+      /// the current sector is split between CPUs along the spin-down index
+      bool _split_down;
 
 #ifdef USE_MPI
       /// global communicator
@@ -582,104 +854,418 @@ namespace EDLib {
       std::vector<int> _procs;
       std::vector<int> _loc_min;
       std::vector<int> _proc_size;
+      /// size of the remote part of a single vector
+      size_t _halo_size;
+      /// largest number of vectors in av_block for which the MPI counts and displacements fit into int
+      int _max_block;
       /// MPI communication window
       MPI_Win _win;
+      /// Working communicator with the communication window allocated for it
+      struct CommCache {
+        MPI_Comm comm;
+        MPI_Win win;
+        /// window memory
+        prec * buffer;
+        /// window size in elements
+        size_t capacity;
+      };
+      /// Working communicators for each number of active CPUs
+      std::map<int, CommCache> _comm_cache;
+      /// Cache entry for the current sector
+      CommCache * _cache;
+      /// Distribution of the spin-up rows between CPUs for each sector
+      std::map<std::pair<int, int>, std::vector<size_t> > _partitions;
+      /// Distribution of the spin-up rows for the current sector
+      std::vector<size_t> _up_bounds;
+      /// number of consecutive vector elements in a distributed row of the current sector
+      size_t _row_size;
+      /// Local and remote parts of the spin-up hopping for the local rows
+      Matrix H_up_local;
+      Matrix H_up_remote;
+      /// Remote part of the off-diagonal interaction, H_loc keeps the local part
+      Matrix H_loc_remote;
+      /// Use non-blocking neighbourhood collectives instead of one-sided communications
+      bool _neighbour_exchange;
+      /// Distributed graph communicator for neighbourhood collectives
+      MPI_Comm _neighbour_comm;
+      /// CPUs we receive data from and the position and size of the data in _vecval array
+      std::vector<int> _sources;
+      std::vector<int> _recv_offset;
+      std::vector<int> _recv_size;
+      /// CPUs we send data to and the position and size of the data in the local vector
+      std::vector<int> _destinations;
+      std::vector<int> _send_offset;
+      std::vector<int> _send_size;
 
       /**
-       * Find neighbour CPUs for the current Hamiltonian matrix
+       * Find neighbour CPUs for the current Hamiltonian matrix.
+       * Split spin-up hopping and off-diagonal interaction matrices into the parts that act on the local part of the vector
+       * and the parts that act on the data received from the remote CPUs.
+       *
+       * @param H_global -- off-diagonal interaction with the global column indices
        */
-      void find_neighbours() {
+      void find_neighbours(GlobalMatrix &H_global) {
         int ci, cid;
         /// size of the working communicator
         int nprocs;
         MPI_Comm_size(_run_comm, &nprocs);
-        std::vector<int> loc_offset(nprocs, 0);
-        /// Find smallest and largest index in the current Hamiltonian
+        int myid;
+        MPI_Comm_rank(_run_comm, &myid);
+        size_t down_size = _down_symmetry.sector().size();
+        size_t up_size = _up_symmetry.sector().size();
+        std::vector<long long> loc_offset(nprocs, 0);
+        /// Find smallest and largest index of the remote data in the current Hamiltonian
         std::vector<int> l_loc_max(_loc_min.size(), INT_MIN);
         std::vector<int> l_loc_min(_loc_min.size(), INT_MAX);
         /// For the spin-up channel
         for(int i = 0; i< _up_size; ++ i) {
-          for (int j = H_up.row_ptr()[i+_up_shift]; j < H_up.row_ptr()[i + _up_shift + 1]; ++j) {
-            calcIndex(ci, cid, H_up.col_ind()[j]*_down_symmetry.sector().size(), _up_symmetry.sector().size(), _down_symmetry.sector().size(), nprocs);
+          for (size_t j = H_up.row_ptr()[i+_up_shift]; j < H_up.row_ptr()[i + _up_shift + 1]; ++j) {
+            calcIndex(ci, cid, H_up.col_ind()[j]*down_size, _up_bounds, down_size);
+            if(cid == myid) continue;
             l_loc_max[cid] = std::max(ci, l_loc_max[cid]);
             l_loc_min[cid] = std::min(ci, l_loc_min[cid]);
-            if(_procs[cid]==0)  {_procs[cid]=1;}
+            _procs[cid]=1;
           }
         }
         /// For the off-diagonal interaction term
-        if(H_loc.row_ptr().size()!=0) {
+        if(H_global.row_ptr().size()!=0) {
           for (size_t i = _int_start; i < _locsize; ++i) {
-            for (int j = H_loc.row_ptr()[i]; j < H_loc.row_ptr()[i + 1]; ++j) {
-              calcIndex(ci, cid, _down_symmetry.sector().size()*(H_loc.col_ind()[j]/_down_symmetry.sector().size()), _up_symmetry.sector().size(), _down_symmetry.sector().size(), nprocs);
+            for (size_t j = H_global.row_ptr()[i]; j < H_global.row_ptr()[i + 1]; ++j) {
+              calcIndex(ci, cid, _row_size*(H_global.col_ind()[j]/_row_size), _up_bounds, _row_size);
+              if(cid == myid) continue;
               l_loc_max[cid] = std::max(ci, l_loc_max[cid]);
               l_loc_min[cid] = std::min(ci, l_loc_min[cid]);
-              if(_procs[cid]==0)  {_procs[cid]=1;}
+              _procs[cid]=1;
             }
           }
         }
-        int oset = 0;
+        size_t oset = 0;
+        for(int i=0; i < nprocs; i++) {
+          if(_procs[i]) {
+            oset += _up_bounds[i + 1] - _up_bounds[i];
+          }
+        }
+        /// positions in the working array are 32-bit, the check is collective since all CPUs of the working communicator exchange data
+        int overflow = oset * _row_size > size_t(INT_MAX) ? 1 : 0;
+        MPI_Allreduce(MPI_IN_PLACE, &overflow, 1, MPI_INT, MPI_MAX, _run_comm);
+        if(overflow) {
+          throw std::overflow_error("Remote part of the vector exceeds 2^31 elements, use more CPUs.");
+        }
+        oset = 0;
         for(int i=0; i < nprocs; i++) {
           if(_procs[i]) {
-            _procs[i]=1;
             /// calculate offset for i-th CPU
-            _proc_offset[i]=oset * _down_symmetry.sector().size() + l_loc_min[i];
+            _proc_offset[i]=int(oset * _row_size) + l_loc_min[i];
             /// The index of the first element of the vector to be received from i-th CPU
             _loc_min[i] = l_loc_min[i];
-            int ls=_up_symmetry.sector().size()/nprocs;
-            if((_up_symmetry.sector().size()% nprocs) > i) {
-              ls++;
-              loc_offset[i] = (i * ls) - oset;
-            }else{
-              loc_offset[i] = i * ls + (_up_symmetry.sector().size() % nprocs) - oset;
-            }
+            loc_offset[i] = (long long) (_up_bounds[i]) - (long long) (oset);
             /// number of elements to be received from the i-th CPU
-            _proc_size[i]= l_loc_max[i] - l_loc_min[i] + _down_symmetry.sector().size();
-            oset+=ls;
+            _proc_size[i]= l_loc_max[i] - l_loc_min[i] + int(_row_size);
+            oset += _up_bounds[i + 1] - _up_bounds[i];
           }
         }
         /// alloacte memory for the working array
-        _vecval.assign(oset * _down_symmetry.sector().size(), prec(0.0));
-        /// adjust indexes
+        _halo_size = oset * _row_size;
+        _vecval.assign(_halo_size, prec(0.0));
+        /// the limit is the same on all CPUs of the working communicator, so av_block fails collectively
+        unsigned long long largest = std::max(_locsize, _halo_size);
+        MPI_Allreduce(MPI_IN_PLACE, &largest, 1, MPI_UNSIGNED_LONG_LONG, MPI_MAX, _run_comm);
+        _max_block = largest == 0 ? INT_MAX : int(std::min((unsigned long long) (INT_MAX) / largest, (unsigned long long) (INT_MAX)));
+        /// split spin-up hopping matrix
+        size_t nnzl = H_up.row_ptr()[up_size] / up_size + 1;
+        H_up_local.init(_up_size, nnzl);
+        H_up_remote.init(_up_size, nnzl);
         for (int i = 0; i < _up_size; ++i) {
-          for (int j = H_up.row_ptr()[i + _up_shift]; j < H_up.row_ptr()[i + _up_shift + 1]; ++j) {
-            calcIndex(ci, cid, H_up.col_ind()[j]*_down_symmetry.sector().size(), _up_symmetry.sector().size(), _down_symmetry.sector().size(), nprocs);
-            H_up.col_ind()[j] -= loc_offset[cid];
+          for (size_t j = H_up.row_ptr()[i + _up_shift]; j < H_up.row_ptr()[i + _up_shift + 1]; ++j) {
+            calcIndex(ci, cid, H_up.col_ind()[j]*down_size, _up_bounds, down_size);
+            if(cid == myid) {
+              H_up_local.addElement(i, ci / down_size, H_up.values()[j], 1);
+            } else {
+              H_up_remote.addElement(i, int(H_up.col_ind()[j] - loc_offset[cid]), H_up.values()[j], 1);
+            }
           }
+          H_up_local.endLine(i);
+          H_up_remote.endLine(i);
         }
-        if(H_loc.row_ptr().size()!=0) {
-          for (size_t i = _int_start; i < _locsize; ++i) {
-            for (int j = H_loc.row_ptr()[i]; j < H_loc.row_ptr()[i + 1]; ++j) {
-              calcIndex(ci, cid, H_loc.col_ind()[j], _up_symmetry.sector().size(), _down_symmetry.sector().size(), nprocs);
-              H_loc.col_ind()[j] -= loc_offset[cid]*_down_symmetry.sector().size();
+        /// split off-diagonal interaction matrix
+        H_loc = Matrix();
+        if(H_global.row_ptr().size()!=0) {
+          nnzl = H_global.row_ptr()[_locsize] / _locsize + 1;
+          H_loc.init(_locsize, nnzl);
+          H_loc_remote.init(_locsize, nnzl);
+          for (size_t i = 0; i < _locsize; ++i) {
+            for (size_t j = H_global.row_ptr()[i]; j < H_global.row_ptr()[i + 1]; ++j) {
+              calcIndex(ci, cid, H_global.col_ind()[j], _up_bounds, _row_size);
+              if(cid == myid) {
+                H_loc.addElement(i, ci, H_global.values()[j], 1);
+              } else {
+                H_loc_remote.addElement(i, int(H_global.col_ind()[j] - loc_offset[cid] * (long long) (_row_size)), H_global.values()[j], 1);
+              }
+            }
+            H_loc.endLine(i);
+            H_loc_remote.endLine(i);
+          }
+        } else {
+          H_loc_remote = Matrix();
+        }
+        if(_neighbour_exchange) {
+          /// tell each CPU which part of its vector we need
+          std::vector<int> recv_range(2 * nprocs, 0);
+          std::vector<int> send_range(2 * nprocs, 0);
+          for(int i = 0; i < nprocs; ++i) {
+            if(_procs[i]) {
+              recv_range[2 * i] = _loc_min[i];
+              recv_range[2 * i + 1] = _proc_size[i];
+            }
+          }
+          MPI_Alltoall(recv_range.data(), 2, MPI_INT, send_range.data(), 2, MPI_INT, _run_comm);
+          _sources.clear(); _recv_offset.clear(); _recv_size.clear();
+          _destinations.clear(); _send_offset.clear(); _send_size.clear();
+          for(int i = 0; i < nprocs; ++i) {
+            if(_procs[i]) {
+              _sources.push_back(i);
+              _recv_offset.push_back(_proc_offset[i]);
+              _recv_size.push_back(_proc_size[i]);
+            }
+            if(send_range[2 * i + 1] > 0) {
+              _destinations.push_back(i);
+              _send_offset.push_back(send_range[2 * i]);
+              _send_size.push_back(send_range[2 * i + 1]);
             }
           }
         }
       }
 
       /// Calculate local index, ci, and CPU id, cid, for the global index i
-      void calcIndex(int &ci, int &cid, int i) {
-        int size;
-        MPI_Comm_size(_run_comm, &size);
-        calcIndex(ci, cid, i*_down_symmetry.sector().size(), _up_symmetry.sector().size(), _down_symmetry.sector().size(), size);
+      void calcIndex(int &ci, int &cid, size_t i) {
+        calcIndex(ci, cid, i*_down_symmetry.sector().size(), _up_bounds, _down_symmetry.sector().size());
       }
-      void calcIndex(int &ci, int &cid, int i, size_t u_s, size_t d_s, int nprocs) {
-        //       local variables
-        int tmp1, tmp2, tmp3, tmp4;
-        int i_rest = i % d_s;
-        int i_up = i / d_s;
-        tmp1 = u_s / nprocs + 1;
-        tmp2 = u_s % nprocs;
-        tmp3 = u_s / nprocs;
-        tmp4 = (i_up) - (tmp1 * tmp2);
-        if (i_up > (tmp1 * tmp2)) {
-          ci = ((tmp4%tmp3))*d_s + i_rest;
-          cid = (i_up - tmp2) / tmp3;
-        } else {
-          ci = (i_up%(tmp3 + 1))*d_s + i_rest;
-          cid = (i_up)/ (tmp3 + 1);
+      /// the global index can exceed 2^31, the local index is checked against INT_MAX in reset()
+      void calcIndex(int &ci, int &cid, size_t i, const std::vector<size_t> &bounds, size_t d_s) {
+        size_t i_rest = i % d_s;
+        size_t i_up = i / d_s;
+        cid = int(std::upper_bound(bounds.begin(), bounds.end(), i_up) - bounds.begin()) - 1;
+        ci = int((i_up - bounds[cid]) * d_s) + i_rest;
+      }
+
+      /**
+       * @param count -- number of elements of a single vector
+       * @param k -- number of interleaved vectors
+       * @return number of elements of k vectors as MPI count
+       * @throws std::overflow_error if the count does not fit into int
+       */
+      static int block_count(size_t count, int k) {
+        size_t result = count * size_t(k);
+        if (result > size_t(INT_MAX)) {
+          throw std::overflow_error("Block of vectors is too large for MPI communications, reduce the block size or use more CPUs.");
+        }
+        return int(result);
+      }
+
+      /**
+       * @param nup -- number of spin-up electrons
+       * @return true if there are less spin-up rows than CPUs and the sector is split along the spin-down index
+       */
+      bool split_down(int nup) const {
+        return size_t(_model.symmetry().comb().c_n_k(_Ns, nup)) < size_t(_nprocs);
+      }
+
+      /**
+       * @return number of consecutive vector elements in a distributed row: the spin-down dimension,
+       * or a single element if the sector is split along the spin-down index
+       */
+      size_t row_size(int nup, int ndown) const {
+        return split_down(nup) ? 1 : _model.symmetry().comb().c_n_k(_Ns, ndown);
+      }
+
+      /**
+       * Split spin-up rows of the symmetry sector between CPUs. Each CPU gets a contiguous block of rows
+       * with approximately the same estimated cost of the matrix-vector product. The cost of a spin-up row is
+       * the number of diagonal and spin-up hopping elements for all spin-down states plus the number of
+       * non-zero elements in the spin-down hopping matrix plus the number of off-diagonal interaction
+       * transitions from the states of the row. The interaction transitions are counted by all CPUs of the global
+       * communicator, each CPU takes every nprocs-th row, so the first call for each sector is collective.
+       * The partition is cached for each sector.
+       *
+       * If there are less spin-up rows than CPUs the sector is split along the spin-down index instead, i.e. the vector
+       * is treated as a single row of the dense (up_size x down_size) matrix and each CPU gets the same number of elements.
+       *
+       * @param nup -- number of spin-up electrons
+       * @param ndown -- number of spin-down electrons
+       * @return first row for each CPU that has data, the last element is the number of rows
+       */
+      const std::vector<size_t> &partition(int nup, int ndown) {
+        std::pair<int, int> key(nup, ndown);
+        typename std::map<std::pair<int, int>, std::vector<size_t> >::iterator cached = _partitions.find(key);
+        if(cached != _partitions.end()) {
+          return cached->second;
+        }
+        size_t up_size = _model.symmetry().comb().c_n_k(_Ns, nup);
+        size_t down_size = _model.symmetry().comb().c_n_k(_Ns, ndown);
+        if(split_down(nup)) {
+          size_t size = up_size * down_size;
+          size_t nprocs = std::min(size, size_t(_nprocs));
+          std::vector<size_t> bounds(nprocs + 1, size);
+          for(size_t ip = 0; ip < nprocs; ++ip) {
+            bounds[ip] = size * ip / nprocs;
+          }
+          return _partitions.insert(std::make_pair(key, bounds)).first->second;
+        }
+        Symmetry::NSymmetry up_symmetry(_Ns);
+        Symmetry::NSymmetry down_symmetry(_Ns);
+        up_symmetry.set_sector(Symmetry::NSymmetry::Sector(nup, up_size));
+        down_symmetry.set_sector(Symmetry::NSymmetry::Sector(ndown, down_size));
+        Matrix up, down;
+        up.init(up_size, 10);
+        down.init(down_size, 10);
+        fill_spin(up_symmetry, _Ns, up);
+        fill_spin(down_symmetry, 0, down);
+        /// number of off-diagonal interaction transitions for each spin-up row
+        std::vector<double> interaction(up_size, 0.0);
+        if(_model.V_states().size() > 0) {
+          up_symmetry.init();
+          for(size_t i = 0; up_symmetry.next_state(); ++i) {
+            if(int(i % _nprocs) != _myid) continue;
+            long long up_state = up_symmetry.state() << _Ns;
+            down_symmetry.init();
+            while(down_symmetry.next_state()) {
+              long long nst = up_state + down_symmetry.state();
+              for(int kkk = 0; kkk < _model.V_states().size(); ++kkk) {
+                interaction[i] += _model.valid(_model.V_states()[kkk], nst) ? 1 : 0;
+              }
+            }
+          }
+          MPI_Allreduce(MPI_IN_PLACE, interaction.data(), int(up_size), MPI_DOUBLE, MPI_SUM, _comm);
+        }
+        /// accumulated cost of the spin-up rows
+        std::vector<double> cost(up_size + 1, 0.0);
+        for(size_t i = 0; i < up_size; ++i) {
+          cost[i + 1] = cost[i] + double(down_size) * (1 + up.row_ptr()[i + 1] - up.row_ptr()[i]) + down.row_ptr()[down_size] + interaction[i];
+        }
+        size_t nprocs = size_t(_nprocs);
+        std::vector<size_t> bounds(nprocs + 1, up_size);
+        bounds[0] = 0;
+        for(size_t ip = 1; ip < nprocs; ++ip) {
+          size_t row = std::lower_bound(cost.begin(), cost.end(), cost[up_size] * ip / nprocs) - cost.begin();
+          /// each CPU gets at least one row
+          bounds[ip] = std::min(std::max(row, bounds[ip - 1] + 1), up_size - (nprocs - ip));
+        }
+        return _partitions.insert(std::make_pair(key, bounds)).first->second;
+      }
+#endif
+
+      /**
+       * Add spin-up hopping contribution. Each non-zero element of the spin-up matrix adds scaled row of the vector
+       * to the row of the result. Rows are split into the blocks of DOWN_BLOCK elements to keep the part of the result in cache.
+       *
+       * @param H -- spin-up hopping matrix, column indices are the spin-up row numbers in x
+       * @param shift -- index of the matrix row that corresponds to the first local row
+       * @param x -- input vector
+       * @param w -- output vector
+       * @param k -- number of interleaved vectors
+       */
+      void up_product(Matrix &H, size_t shift, const prec *x, prec *w, int k = 1) {
+        if (H.row_ptr().size() == 0) {
+          return;
+        }
+        /// for the interleaved vectors the row of the dense (up_size x down_size) matrix is k times longer
+        size_t down_size = _down_symmetry.sector().size() * k;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (int i = 0; i < int(_up_size); ++i) {
+          prec *wi = w + i * down_size;
+          for (size_t kb = 0; kb < down_size; kb += DOWN_BLOCK) {
+            size_t kmax = std::min(kb + DOWN_BLOCK, down_size);
+            /// Iteration over columns.
+            for (size_t j = H.row_ptr()[i + shift]; j < H.row_ptr()[i + shift + 1]; ++j) {
+              prec value = H.values()[j];
+              const prec *xj = x + H.col_ind()[j] * down_size;
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+              for (size_t k = kb; k < kmax; ++k) {
+                wi[k] += value * xj[k];
+              }
+            }
+          }
+        }
+      }
+
+      /**
+       * Add off-diagonal interaction contribution
+       *
+       * @param H -- off-diagonal interaction matrix
+       * @param x -- input vector
+       * @param w -- output vector
+       * @param n -- local dimension
+       */
+      void loc_product(Matrix &H, const prec *x, prec *w, size_t n) {
+        /// Check that we have off-diagonal interaction elements
+        if (H.row_ptr().size() == 0) {
+          return;
+        }
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (size_t i = _int_start; i < n; ++i) {
+          prec wi = w[i];
+          for (size_t j = H.row_ptr()[i]; j < H.row_ptr()[i + 1]; ++j) {
+            wi += prec(H.values()[j]) * x[H.col_ind()[j]];
+          }
+          w[i] = wi;
         }
       }
+
+      /**
+       * Add off-diagonal interaction contribution for k vectors in the interleaved layout
+       */
+      void loc_product(Matrix &H, const prec *x, prec *w, size_t n, int k) {
+        if (H.row_ptr().size() == 0) {
+          return;
+        }
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
 #endif
+        for (size_t i = _int_start; i < n; ++i) {
+          prec *wi = w + i * k;
+          for (size_t j = H.row_ptr()[i]; j < H.row_ptr()[i + 1]; ++j) {
+            prec value = H.values()[j];
+            const prec *xj = x + size_t(H.col_ind()[j]) * k;
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+            for (int l = 0; l < k; ++l) {
+              wi[l] += value * xj[l];
+            }
+          }
+        }
+      }
+
+      /**
+       * Add the off-diagonal transitions from the state nst to the i-th row of the matrix
+       *
+       * @param states -- list of the transitions
+       * @param nst -- current configuration state
+       * @param i -- row number
+       * @param H -- matrix to be filled
+       * @return true if there is at least one transition from the current state
+       */
+      template<typename States>
+      bool off_diagonal(const States &states, typename Model::State nst, size_t i, GlobalMatrix &H) {
+        bool found = false;
+        typename Model::State k;
+        int isign;
+        for (int kkk = 0; kkk < states.size(); ++kkk) {
+          if (_model.valid(states[kkk], nst)) {
+            _model.set(states[kkk], nst, k, isign);
+            long long j = _model.symmetry().index(k);
+            H.addElement(i, j, states[kkk].value(), isign);
+            found = true;
+          }
+        }
+        return found;
+      }
 
       /**
        * Fill the Hamiltonian matrix for the specific spin
@@ -73,20 +73,14 @@ namespace EDLib {
         std::partial_sort(all.begin(), all.begin()+nmax, all.end(), [] (Element a, Element b) -> bool {return (a > b);});
         for(size_t i = 0; i < nmax; ++i){
           std::cout << all[i].val << " * |";
-          long long nst = _ham.model().symmetry().state_by_index(all[i].ind);
-          std::string spin_down = std::bitset< 64 >( nst ).to_string().substr(64-  _ham.model().orbitals(), _ham.model().orbitals());
-          std::string spin_up   = std::bitset< 64 >( nst ).to_string().substr(64-2*_ham.model().orbitals(), _ham.model().orbitals());
-          std::cout<<spin_up<< "|"<<spin_down;
+          std::cout << configuration(_ham.model().symmetry().state_by_index(all[i].ind));
           std::cout << ">" << std::endl;
         }
       }
 #else
       for(size_t i = 0; i < count; ++i){
         std::cout << pair.eigenvector()[largest[i]] << " * |";
-        long long nst = _ham.model().symmetry().state_by_index(largest[i]);
-        std::string spin_down = std::bitset< 64 >( nst ).to_string().substr(64-  _ham.model().orbitals(), _ham.model().orbitals());
-        std::string spin_up   = std::bitset< 64 >( nst ).to_string().substr(64-2*_ham.model().orbitals(), _ham.model().orbitals());
-        std::cout<<spin_up<< "|"<<spin_down;
+        std::cout << configuration(_ham.model().symmetry().state_by_index(largest[i]));
         std::cout << ">" << std::endl;
       }
       std::cout << std::endl;
@@ -97,6 +91,16 @@ namespace EDLib {
 
     Hamiltonian& _ham;
 
+    /**
+     * @return spin-up and spin-down occupations of the basis state separated by "|"
+     */
+    std::string configuration(typename Hamiltonian::ModelType::State nst) const {
+      int Ns = _ham.model().orbitals();
+      std::string spin_down = std::bitset< 64 >( (unsigned long long) (nst) ).to_string().substr(64 - Ns, Ns);
+      std::string spin_up   = std::bitset< 64 >( (unsigned long long) (nst >> Ns) ).to_string().substr(64 - Ns, Ns);
+      return spin_up + "|" + spin_down;
+    }
+
 #ifdef USE_MPI
     struct Element{
       Element() {};
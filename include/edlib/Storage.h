@@ -6,12 +6,24 @@
 #define HUBBARD_STORAGE_H
 
 #include "fortranbinding.h"
+#include "ThickRestartLanczos.h"
+#include "BlockDavidson.h"
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <functional>
 #include <iostream>
+#include <random>
 #include <alps/params.hpp>
 
 namespace EDLib {
   namespace Storage {
 
+    /// eigensolver used for the diagonalization of the sectors
+    enum class Eigensolver {
+      ARPACK, LANCZOS, DAVIDSON
+    };
+
     template<typename prec>
     class Storage {
     public:
@@ -28,6 +40,20 @@ namespace EDLib {
         } else {
           _ncv = 2 * _nev + 3;
         }
+        _tol = p.exists("arpack.TOLERANCE") ? p["arpack.TOLERANCE"].as<double>() : 1e-14;
+        _maxitr = p.exists("arpack.MAXITER") ? p["arpack.MAXITER"].as<int>() : 1000;
+        std::string solver = p.exists("storage.EIGENSOLVER") ? p["storage.EIGENSOLVER"].as<std::string>() : std::string("ARPACK");
+        if (solver == "ARPACK") {
+          _solver = Eigensolver::ARPACK;
+        } else if (solver == "LANCZOS") {
+          _solver = Eigensolver::LANCZOS;
+        } else if (solver == "DAVIDSON") {
+          _solver = Eigensolver::DAVIDSON;
+        } else {
+          throw std::invalid_argument("Unknown eigensolver " + solver);
+        }
+        _float_krylov = p.exists("storage.FLOAT_KRYLOV") && bool(p["storage.FLOAT_KRYLOV"]);
+        _matvecs = 0;
       }
 
       /**
@@ -41,8 +67,15 @@ namespace EDLib {
        * Diagonalize current Hamiltonian
        */
       int diag() {
-        int ido = 0;
-        int n = _n;
+        /// starting vector and additional operator are used only for the current diagonalization
+        std::vector < prec > start;
+        start.swap(_start);
+        std::function < void(const prec *, prec *, size_t) > shift;
+        shift.swap(_shift);
+        std::function < void(prec *, size_t) > projection;
+        projection.swap(_projection);
+        fortran_int ido = 0;
+        fortran_int n = fortran_int(_n);
         if (n == 0) {
           return finalize(0, true, true);
         }
@@ -50,22 +83,28 @@ namespace EDLib {
           zero_eigenapair();
           return finalize(0);
         }
+        if (_solver == Eigensolver::LANCZOS) {
+          return lanczos_diag(start, shift);
+        }
+        if (_solver == Eigensolver::DAVIDSON) {
+          return davidson_diag(start, shift, projection);
+        }
         std::cout << "diag matrix:" << n << std::endl;
-        int ncv = std::min(_ncv, _ntot);
-        int nev = std::min(_nev, ncv - 1);
+        fortran_int ncv = fortran_int(std::min(size_t(_ncv), _ntot));
+        fortran_int nev = std::min(fortran_int(_nev), ncv - 1);
         char which[3] = "SA";
         prec sigma = 0.0;
         char bmat[2] = "I";
-        int lworkl = ncv * (ncv + 8);
-        prec tol = 1e-14;
-        int info = 0;
-        std::vector < int > iparam(11, 0);
-        std::vector < int > ipntr(11, 0);
-        std::vector < int > select(ncv, 0);
-        int ishfts = 1;
-        int maxitr = 1000;
-        int mode = 1;
-        int ldv = n;
+        fortran_int lworkl = ncv * (ncv + 8);
+        prec tol = prec(_tol);
+        fortran_int info = 0;
+        std::vector < fortran_int > iparam(11, 0);
+        std::vector < fortran_int > ipntr(11, 0);
+        std::vector < fortran_int > select(ncv, 0);
+        fortran_int ishfts = 1;
+        fortran_int maxitr = _maxitr;
+        fortran_int mode = 1;
+        fortran_int ldv = n;
 
         iparam[0] = ishfts;
         iparam[2] = maxitr;
@@ -74,11 +113,18 @@ namespace EDLib {
         resid.assign(size_t(n), prec(0.0));
         workd.assign(3 * size_t(n), prec(0.0));
         workl.assign(lworkl, prec(0.0));
+        if (start.size() == size_t(n)) {
+          std::copy(start.begin(), start.end(), resid.begin());
+          info = 1;
+        }
         prepare_work_arrays(&workd[0], size_t(2 * n));
         do {
           saupd(&ido, bmat, &n, which, &nev, &tol, &resid[0], &ncv, &v[0], &ldv, &iparam[0], &ipntr[0], &workd[0], &workl[0], &lworkl, &info);
           if (ido == -1 || ido == 1) {
             av(&workd[ipntr[0] - 1], &workd[ipntr[1] - 1], n);
+            if (shift) {
+              shift(&workd[ipntr[0] - 1], &workd[ipntr[1] - 1], n);
+            }
           }
         } while (ido != 99);
         if (info < 0) {
@@ -88,9 +134,10 @@ namespace EDLib {
           std::cout << "' '" << std::endl;
           return finalize(info);
         }
-        int rvec = 1 - _eval_only;
+        _matvecs = size_t(iparam[8]);
+        fortran_int rvec = 1 - _eval_only;
         char howmny[2] = "A";
-        int nconv = iparam[4];
+        int nconv = int(iparam[4]);
         evals.resize(nconv);
         seupd(&rvec, howmny, &select[0], &evals[0], &v[0], &ldv, &sigma, bmat, &n, which, &nev, &tol, &resid[0], &ncv, &v[0],
               &ldv, &iparam[0], &ipntr[0], &workd[0], &workl[0], &lworkl, &info);
@@ -106,11 +153,11 @@ namespace EDLib {
         if (_eval_only == 0) {
           evecs.assign(nconv, std::vector < prec >(n, prec(0.0)));
           for (int i = 0; i < nconv; ++i) {
-            int offset = i * n;
-            std::memcpy(&evecs[i][0], &v[offset], n * sizeof(prec));
+            size_t offset = size_t(i) * n;
+            std::memcpy(&evecs[i][0], &v[offset], size_t(n) * sizeof(prec));
           }
         } else {
-          int nconv = iparam[4];
+          int nconv = int(iparam[4]);
           evecs.assign(nconv, std::vector < prec >(1, prec(0.0)));
         };
         int lout = 6, on = 2, idigit = -6;
@@ -148,6 +195,135 @@ namespace EDLib {
         return 0;
       }
 
+      /**
+       * Estimate the lowest eigenvalue of the current Hamiltonian with a few Lanczos steps.
+       * The lowest Ritz value is an upper bound for the lowest eigenvalue. There is an eigenvalue within the residual
+       * norm of the Ritz value, but it is not necessarily the lowest one, e.g. if the starting vector is nearly orthogonal
+       * to the ground state, so the Ritz value minus the residual norm is not a rigorous lower bound.
+       *
+       * @param nlanc -- number of Lanczos steps
+       * @param ritz -- lowest Ritz value
+       * @param residual -- residual norm of the lowest Ritz pair
+       * @param width -- distance between the lowest and the highest Ritz values, estimate of the spectral width
+       */
+      void eigenvalue_estimate(int nlanc, prec &ritz, prec &residual, prec &width) {
+        size_t n = _n;
+        std::vector < double > estimate(3, 0.0);
+        if (n > 0 && _ntot == 1) {
+          zero_eigenapair();
+          estimate[0] = evals[0];
+        } else if (n > 0) {
+          std::vector < prec > v(n), w(n, prec(0.0));
+#ifdef USE_MPI
+          int rank;
+          MPI_Comm_rank(comm(), &rank);
+          std::mt19937 gen(rank + 1);
+#else
+          std::mt19937 gen(1);
+#endif
+          std::uniform_real_distribution < double > dist(-1.0, 1.0);
+          for (size_t j = 0; j < n; ++j) {
+            v[j] = prec(dist(gen));
+          }
+          prec norm = std::sqrt(dot(v, v));
+          for (size_t j = 0; j < n; ++j) {
+            v[j] /= norm;
+          }
+          std::vector < double > alpha;
+          std::vector < double > beta;
+          prec bet = prec(0.0);
+          prepare_work_arrays(v.data());
+          for (int iter = 0; iter < int(std::min(size_t(nlanc), _ntot)); ++iter) {
+            if (iter != 0) {
+              for (size_t j = 0; j < n; ++j) {
+                prec dummy = v[j];
+                v[j] = w[j] / bet;
+                w[j] = -bet * dummy;
+              }
+            }
+            av(v.data(), w.data(), n, false);
+            prec alf = dot(v, w);
+            alpha.push_back(alf);
+            for (size_t j = 0; j < n; ++j) {
+              w[j] -= alf * v[j];
+            }
+            bet = std::sqrt(dot(w, w));
+            if (std::abs(bet) < 1e-10) {
+              bet = prec(0.0);
+              break;
+            }
+            beta.push_back(bet);
+          }
+          /// eigen-decomposition of the tridiagonal Lanczos matrix
+          fortran_int m = alpha.size();
+          char jobz[2] = "V";
+          std::vector < double > z(m * m), work(std::max(fortran_int(1), 2 * m - 2));
+          beta.resize(std::max(fortran_int(1), m));
+          fortran_int info = 0;
+          dstev_(jobz, &m, &alpha[0], &beta[0], &z[0], &m, &work[0], &info);
+          estimate[0] = alpha[0];
+          /// residual norm of the lowest Ritz pair
+          estimate[1] = std::abs(bet * z[m - 1]);
+          estimate[2] = alpha[m - 1] - alpha[0];
+        }
+        finalize(0, false);
+#ifdef USE_MPI
+        MPI_Bcast(estimate.data(), 3, MPI_DOUBLE, 0, _comm);
+#endif
+        ritz = prec(estimate[0]);
+        residual = prec(estimate[1]);
+        width = prec(estimate[2]);
+      }
+
+      /**
+       * Rayleigh quotient of the current Hamiltonian, it is an upper bound for the lowest eigenvalue
+       *
+       * @param vec -- local part of the vector
+       * @return <vec|H|vec> / <vec|vec>
+       */
+      prec rayleigh_quotient(const std::vector < prec > &vec) {
+        size_t n = _n;
+        double quotient = 0.0;
+        if (n > 0) {
+          std::vector < prec > v(vec.begin(), vec.begin() + n), w(n, prec(0.0));
+          prepare_work_arrays(v.data());
+          av(v.data(), w.data(), n, false);
+          quotient = dot(v, w) / dot(v, v);
+        }
+        finalize(0, false);
+#ifdef USE_MPI
+        MPI_Bcast(&quotient, 1, MPI_DOUBLE, 0, _comm);
+#endif
+        return prec(quotient);
+      }
+
+      /**
+       * Set the ARPACK starting vector for the next diagonalization
+       *
+       * @param start -- local part of the starting vector
+       */
+      void start_vector(const std::vector < prec > &start) {
+        _start = start;
+      }
+
+      /**
+       * Set the operator that is added to the Hamiltonian in the next diagonalization, e.g. the energy penalty
+       * for the unwanted states. The operator is called after each matrix-vector product as op(v, w, n) and should
+       * add its product with the local part of v to w.
+       */
+      void shift_operator(const std::function < void(const prec *, prec *, size_t) > &op) {
+        _shift = op;
+      }
+
+      /**
+       * Set the projection onto the wanted subspace for the next diagonalization. The Davidson solver applies it
+       * as op(v, n) to the local part of each new basis vector, the Krylov solvers keep the projected starting
+       * vector in the subspace by themselves.
+       */
+      void projection_operator(const std::function < void(prec *, size_t) > &op) {
+        _projection = op;
+      }
+
       const std::vector < prec > &eigenvalues() const {
         return evals;
       }
@@ -164,23 +340,64 @@ namespace EDLib {
         return evecs;
       }
 
+      Eigensolver &eigensolver() {
+        return _solver;
+      }
+
+      /// compute only the eigen-values, the eigen-vectors are replaced by single zeros
+      int &eigenvalues_only() {
+        return _eval_only;
+      }
+
+      /// store the Lanczos basis in single precision
+      bool &float_krylov() {
+        return _float_krylov;
+      }
+
+      /// number of matrix-vector products in the last diagonalization
+      size_t matvecs() const {
+        return _matvecs;
+      }
+
       /**
        * Matrix-Vector product
        * Should be implemented based on storage type
        */
-      virtual void av(prec *v, prec *w, int n, bool clear = true) = 0;
+      virtual void av(prec *v, prec *w, size_t n, bool clear = true) = 0;
+
+      /**
+       * Product of the matrix with k vectors stored in the interleaved layout, V[i * k + j] is the i-th element
+       * of the j-th vector. Generic implementation performs k matrix-vector products.
+       */
+      virtual void av_block(const prec *V, prec *W, size_t n, int k) {
+        std::vector < prec > v(n), w(n);
+        for (int j = 0; j < k; ++j) {
+          for (size_t i = 0; i < n; ++i) {
+            v[i] = V[i * k + j];
+          }
+          av(v.data(), w.data(), n);
+          for (size_t i = 0; i < n; ++i) {
+            W[i * k + j] = w[i];
+          }
+        }
+      }
+
+      /**
+       * Local part of the diagonal of the current Hamiltonian, it is used as preconditioner by the Davidson solver
+       */
+      virtual void diagonal(std::vector < prec > &d) = 0;
       virtual void prepare_work_arrays(prec *w, size_t shift = 0){};
       virtual int finalize(int info, bool bcast = true, bool empty = false){return info;};
 
-      void saupd(int *ido, char *bmat, int *n, char *which, int *nev, prec *tol, prec *resid, int *ncv, prec *v, int *ldv, int *iparam, int *ipntr,
-                 prec *workd, prec *workl, int *lworkl, int *info) {};
+      void saupd(fortran_int *ido, char *bmat, fortran_int *n, char *which, fortran_int *nev, prec *tol, prec *resid, fortran_int *ncv, prec *v, fortran_int *ldv, fortran_int *iparam, fortran_int *ipntr,
+                 prec *workd, prec *workl, fortran_int *lworkl, fortran_int *info) {};
 
-      inline void seupd(int *rvec, char *All, int *select, prec *d,
-                        prec *z, int *ldz, prec *sigma,
-                        char *bmat, int *n, char *which, int *nev,
-                        prec *tol, prec *resid, int *ncv, prec *v,
-                        int *ldv, int *iparam, int *ipntr, prec *workd,
-                        prec *workl, int *lworkl, int *ierr) {};
+      inline void seupd(fortran_int *rvec, char *All, fortran_int *select, prec *d,
+                        prec *z, fortran_int *ldz, prec *sigma,
+                        char *bmat, fortran_int *n, char *which, fortran_int *nev,
+                        prec *tol, prec *resid, fortran_int *ncv, prec *v,
+                        fortran_int *ldv, fortran_int *iparam, fortran_int *ipntr, prec *workd,
+                        prec *workl, fortran_int *lworkl, fortran_int *ierr) {};
       void mout(int* lout, int *m, int*n, prec*A, int*lda, int* idigit,char* ifmt);
 #ifdef USE_MPI
       virtual MPI_Comm comm() {
@@ -188,8 +405,166 @@ namespace EDLib {
       }
 #endif
     protected:
-      int &n() { return _n; }
-      int &ntot() { return _ntot; }
+      size_t &n() { return _n; }
+      size_t &ntot() { return _ntot; }
+
+      /**
+       * Dot product of the distributed vectors
+       */
+      prec dot(const std::vector < prec > &v, const std::vector < prec > &w) {
+        prec local = prec(0.0);
+        for (size_t j = 0; j < v.size(); ++j) {
+          local += v[j] * w[j];
+        }
+#ifdef USE_MPI
+        prec result;
+        MPI_Allreduce(&local, &result, 1, alps::mpi::detail::mpi_type < prec >(), MPI_SUM, comm());
+        return result;
+#else
+        return local;
+#endif
+      }
+
+      /**
+       * Diagonalize current Hamiltonian with the thick-restart Lanczos method
+       *
+       * @param start -- local part of the starting vector or empty vector
+       * @param shift -- operator added to the Hamiltonian or empty function
+       */
+      int lanczos_diag(const std::vector < prec > &start, const std::function < void(const prec *, prec *, size_t) > &shift) {
+        size_t n = _n;
+        std::vector < prec > work(n);
+        prepare_work_arrays(work.data());
+        typename ThickRestartLanczos < prec >::Operator op = [this, &shift](prec *v, prec *w, size_t n) {
+          av(v, w, n);
+          if (shift) {
+            shift(v, w, n);
+          }
+        };
+        typename ThickRestartLanczos < prec >::Reduction sum = [this](double *x, int k) {
+#ifdef USE_MPI
+          MPI_Allreduce(MPI_IN_PLACE, x, k, MPI_DOUBLE, MPI_SUM, comm());
+#endif
+        };
+        int seed = 1;
+#ifdef USE_MPI
+        int myid;
+        MPI_Comm_rank(comm(), &myid);
+        seed += myid;
+#endif
+        int restarts = 0;
+        int info = _float_krylov ? run_lanczos < float >(op, sum, start, seed, restarts) : run_lanczos < prec >(op, sum, start, seed, restarts);
+        if (_eval_only != 0) {
+          evecs.assign(evals.size(), std::vector < prec >(1, prec(0.0)));
+        }
+        finalize(info);
+#ifdef USE_MPI
+        if (myid == 0) {
+#endif
+          std::cout << "Here is eigenvalues" << std::endl;
+          for (int j = 0; j < evals.size(); ++j) {
+            std::cout << evals[j] << std::endl << std::flush;
+          }
+          if (info == 1) {
+            std::cout << "Maximum number of restarts reached." << std::endl;
+          }
+          std::cout << " ========================= " << std::endl;
+          std::cout << " Size of the matrix is " << _ntot << std::endl;
+          std::cout << " Thick-restart Lanczos with " << (_float_krylov ? "single" : "double") << " precision basis" << std::endl;
+          std::cout << " The number of Ritz values requested is: " << _nev << std::endl;
+          std::cout << " The number of Lanczos vectors generated: " << std::min(size_t(_ncv), _ntot) << std::endl;
+          std::cout << " The number of restarts taken is: " << restarts << std::endl;
+          std::cout << " The number of OP*x is: " << _matvecs << std::endl;
+          std::cout << " The convergence criterion is:  " << _tol << std::endl;
+          std::cout << " ========================= " << std::endl;
+#ifdef USE_MPI
+        }
+#endif
+        return 0;
+      }
+
+      /**
+       * Diagonalize current Hamiltonian with the block Davidson method
+       *
+       * @param start -- local part of the starting vector or empty vector
+       * @param shift -- operator added to the Hamiltonian or empty function
+       * @param projection -- projection of the basis vectors or empty function
+       */
+      int davidson_diag(const std::vector < prec > &start, const std::function < void(const prec *, prec *, size_t) > &shift,
+                        const std::function < void(prec *, size_t) > &projection) {
+        size_t n = _n;
+        std::vector < prec > work(n);
+        prepare_work_arrays(work.data());
+        std::vector < prec > d;
+        diagonal(d);
+        typename BlockDavidson < prec >::BlockOperator op = [this, &shift, &work](const prec *V, prec *W, size_t n, int k) {
+          av_block(V, W, n, k);
+          if (shift) {
+            std::vector < prec > w(n);
+            for (int j = 0; j < k; ++j) {
+              for (size_t i = 0; i < n; ++i) {
+                work[i] = V[i * k + j];
+                w[i] = prec(0.0);
+              }
+              shift(work.data(), w.data(), n);
+              for (size_t i = 0; i < n; ++i) {
+                W[i * k + j] += w[i];
+              }
+            }
+          }
+        };
+        typename BlockDavidson < prec >::Reduction sum = [this](double *x, int k) {
+#ifdef USE_MPI
+          MPI_Allreduce(MPI_IN_PLACE, x, k, MPI_DOUBLE, MPI_SUM, comm());
+#endif
+        };
+        int seed = 1;
+#ifdef USE_MPI
+        int myid;
+        MPI_Comm_rank(comm(), &myid);
+        seed += myid;
+#endif
+        BlockDavidson < prec > davidson(n, _ntot, _nev, _ncv, _tol, _maxitr);
+        int info = davidson.solve(op, sum, d, start, seed, evals, evecs, _eval_only == 0, projection);
+        _matvecs = davidson.matvecs();
+        if (_eval_only != 0) {
+          evecs.assign(evals.size(), std::vector < prec >(1, prec(0.0)));
+        }
+        finalize(info);
+#ifdef USE_MPI
+        if (myid == 0) {
+#endif
+          std::cout << "Here is eigenvalues" << std::endl;
+          for (int j = 0; j < evals.size(); ++j) {
+            std::cout << evals[j] << std::endl << std::flush;
+          }
+          if (info == 1) {
+            std::cout << "Maximum number of restarts reached or the basis can not be extended." << std::endl;
+          }
+          std::cout << " ========================= " << std::endl;
+          std::cout << " Size of the matrix is " << _ntot << std::endl;
+          std::cout << " Block Davidson with diagonal preconditioner" << std::endl;
+          std::cout << " The number of Ritz values requested is: " << _nev << std::endl;
+          std::cout << " The number of iterations taken is: " << davidson.iterations() << std::endl;
+          std::cout << " The number of restarts taken is: " << davidson.restarts() << std::endl;
+          std::cout << " The number of OP*x is: " << _matvecs << std::endl;
+          std::cout << " The convergence criterion is:  " << _tol << std::endl;
+          std::cout << " ========================= " << std::endl;
+#ifdef USE_MPI
+        }
+#endif
+        return 0;
+      }
+
+      template<typename basis_prec>
+      int run_lanczos(const typename ThickRestartLanczos < prec >::Operator &op, const typename ThickRestartLanczos < prec >::Reduction &sum,
+                      const std::vector < prec > &start, int seed, int &restarts) {
+        ThickRestartLanczos < prec, basis_prec > lanczos(_n, _ntot, _nev, _ncv, _tol, _maxitr);
+        int info = lanczos.solve(op, sum, start, seed, evals, evecs, _eval_only == 0);
+        restarts = lanczos.restarts();
+        _matvecs = lanczos.matvecs();
+        return info;
+      }
 
 #ifdef USE_MPI
       void broadcast_evals(bool empty = false) {
@@ -209,15 +584,29 @@ namespace EDLib {
 
 #endif
     private:
-      int _ntot;
-      int _n;
+      /// dimension of the current sector
+      size_t _ntot;
+      /// local dimension of the current sector
+      size_t _n;
       int _nev;
       int _ncv;
       int _eval_only;
+      /// ARPACK tolerance and maximum number of iterations, also used by the Lanczos solver
+      double _tol;
+      int _maxitr;
+      Eigensolver _solver;
+      bool _float_krylov;
+      size_t _matvecs;
       std::vector < prec > v;
       std::vector < prec > resid;
       std::vector < prec > workd;
       std::vector < prec > workl;
+      /// starting vector for the next diagonalization
+      std::vector < prec > _start;
+      /// operator added to the Hamiltonian in the next diagonalization
+      std::function < void(const prec *, prec *, size_t) > _shift;
+      /// projection of the Davidson basis vectors in the next diagonalization
+      std::function < void(prec *, size_t) > _projection;
 
       std::vector < prec > evals;
       std::vector < std::vector < prec > > evecs;
@@ -227,10 +616,10 @@ namespace EDLib {
     };
 
     template<>
-    void Storage < double >::saupd(int *ido, char *bmat, int *n, char *which, int *nev, double *tol, double *resid, int *ncv, double *v, int *ldv, int *iparam, int *ipntr,
-                                   double *workd, double *workl, int *lworkl, int *info) {
+    void Storage < double >::saupd(fortran_int *ido, char *bmat, fortran_int *n, char *which, fortran_int *nev, double *tol, double *resid, fortran_int *ncv, double *v, fortran_int *ldv, fortran_int *iparam, fortran_int *ipntr,
+                                   double *workd, double *workl, fortran_int *lworkl, fortran_int *info) {
 #ifdef USE_MPI
-      int scomm = PMPI_Comm_c2f(comm());
+      fortran_int scomm = PMPI_Comm_c2f(comm());
       pdsaupd_(&scomm, ido, bmat, n, which, nev, tol, resid, ncv, v, ldv, iparam, ipntr, workd, workl, lworkl, info);
 #else
       dsaupd_(ido, bmat, n, which, nev, tol, resid, ncv, v, ldv, iparam, ipntr, workd, workl, lworkl, info);
@@ -238,14 +627,14 @@ namespace EDLib {
     }
 
     template<>
-    void Storage < double >::seupd(int *rvec, char *All, int *select, double *d,
-                                   double *z, int *ldz, double *sigma,
-                                   char *bmat, int *n, char *which, int *nev,
-                                   double *tol, double *resid, int *ncv, double *v,
-                                   int *ldv, int *iparam, int *ipntr, double *workd,
-                                   double *workl, int *lworkl, int *ierr) {
+    void Storage < double >::seupd(fortran_int *rvec, char *All, fortran_int *select, double *d,
+                                   double *z, fortran_int *ldz, double *sigma,
+                                   char *bmat, fortran_int *n, char *which, fortran_int *nev,
+                                   double *tol, double *resid, fortran_int *ncv, double *v,
+                                   fortran_int *ldv, fortran_int *iparam, fortran_int *ipntr, double *workd,
+                                   double *workl, fortran_int *lworkl, fortran_int *ierr) {
 #ifdef USE_MPI
-      int scomm = PMPI_Comm_c2f(comm());
+      fortran_int scomm = PMPI_Comm_c2f(comm());
       pdseupd_(&scomm, rvec, All, select, d, z, ldz, sigma, bmat, n, which, nev, tol, resid, ncv, v,
                ldv, iparam, ipntr, workd, workl, lworkl, ierr);
 #else
@@ -255,10 +644,10 @@ namespace EDLib {
     }
 
     template<>
-    void Storage < float >::saupd(int *ido, char *bmat, int *n, char *which, int *nev, float *tol, float *resid, int *ncv, float *v, int *ldv, int *iparam, int *ipntr,
-                                  float *workd, float *workl, int *lworkl, int *info) {
+    void Storage < float >::saupd(fortran_int *ido, char *bmat, fortran_int *n, char *which, fortran_int *nev, float *tol, float *resid, fortran_int *ncv, float *v, fortran_int *ldv, fortran_int *iparam, fortran_int *ipntr,
+                                  float *workd, float *workl, fortran_int *lworkl, fortran_int *info) {
 #ifdef USE_MPI
-      int scomm = PMPI_Comm_c2f(comm());
+      fortran_int scomm = PMPI_Comm_c2f(comm());
       pssaupd_(&scomm, ido, bmat, n, which, nev, tol, resid, ncv, v, ldv, iparam, ipntr, workd, workl, lworkl, info);
 #else
       ssaupd_(ido, bmat, n, which, nev, tol, resid, ncv, v, ldv, iparam, ipntr, workd, workl, lworkl, info);
@@ -266,14 +655,14 @@ namespace EDLib {
     }
 
     template<>
-    void Storage < float >::seupd(int *rvec, char *All, int *select, float *d,
-                                  float *z, int *ldz, float *sigma,
-                                  char *bmat, int *n, char *which, int *nev,
-                                  float *tol, float *resid, int *ncv, float *v,
-                                  int *ldv, int *iparam, int *ipntr, float *workd,
-                                  float *workl, int *lworkl, int *ierr) {
+    void Storage < float >::seupd(fortran_int *rvec, char *All, fortran_int *select, float *d,
+                                  float *z, fortran_int *ldz, float *sigma,
+                                  char *bmat, fortran_int *n, char *which, fortran_int *nev,
+                                  float *tol, float *resid, fortran_int *ncv, float *v,
+                                  fortran_int *ldv, fortran_int *iparam, fortran_int *ipntr, float *workd,
+                                  float *workl, fortran_int *lworkl, fortran_int *ierr) {
 #ifdef USE_MPI
-      int scomm = PMPI_Comm_c2f(comm());
+      fortran_int scomm = PMPI_Comm_c2f(comm());
       psseupd_(&scomm, rvec, All, select, d, z, ldz, sigma, bmat, n, which, nev, tol, resid, ncv, v,
                ldv, iparam, ipntr, workd, workl, lworkl, ierr);
 #else
@@ -282,18 +671,18 @@ namespace EDLib {
 #endif
     }
 //    template<>
-//    void Storage<float>::mout(int* lout, int *m, int*n, float*A, int*lda, int* idigit,char* ifmt) {
+//    void Storage<float>::mout(int* lout, fortran_int *m, int*n, float*A, int*lda, int* idigit,char* ifmt) {
 //#ifdef USE_MPI
-//      int scomm = PMPI_Comm_c2f(comm());
+//      fortran_int scomm = PMPI_Comm_c2f(comm());
 //      psmout(&scomm, lout, m, n, A, lda, idigit,ifmt);
 //#else
 //      smout(lout, m, n, A, lda, idigit,ifmt);
 //#endif
 //    }
 //    template<>
-//    void Storage<double>::mout(int* lout, int *m, int*n, double*A, int*lda, int* idigit,char* ifmt) {
+//    void Storage<double>::mout(int* lout, fortran_int *m, int*n, double*A, int*lda, int* idigit,char* ifmt) {
 //#ifdef USE_MPI
-//      int scomm = PMPI_Comm_c2f(comm());
+//      fortran_int scomm = PMPI_Comm_c2f(comm());
 //      pdmout(&scomm, lout, m, n, A, lda, idigit,ifmt);
 //#else
 //      dmout(lout, m, n, A, lda, idigit,ifmt);
@@ -11,24 +11,30 @@ namespace EDLib {
   namespace Symmetry {
 /**
  * Base class for symmetries
+ *
+ * @tparam St - integer type of the binary represented basis states: long long for up to 63 spin-orbitals or
+ *                 unsigned __int128 for up to 128 spin-orbitals
  */
+    template<typename St = long long>
     class Symmetry {
     public:
+      typedef St State;
+
       Symmetry() : _state(0) {};
 
       virtual ~Symmetry() {};
 
       virtual bool next_state() = 0;
 
-      long long state() const {
+      State state() const {
         return _state;
       };
 
-      long long &state() {
+      State &state() {
         return _state;
       };
 
-      virtual int index(long long combination) = 0;
+      virtual long long index(State combination) = 0;
 
       virtual void reset() = 0;
 
@@ -37,8 +43,15 @@ namespace EDLib {
       // check that there is the next simmetry sector. if exist set current sector to the next available
       virtual bool next_sector() = 0;
 
+      /**
+       * @return maximal number of spin-orbitals that can be represented by the State type
+       */
+      static int max_orbitals() {
+        return int(8 * sizeof(State)) - (State(-1) < State(0) ? 1 : 0);
+      }
+
     private:
-      long long _state;
+      State _state;
     };
   }
 }
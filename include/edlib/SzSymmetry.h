@@ -6,55 +6,68 @@
 #define HUBBARD_SZCOMBINATION_H
 
 #include <queue>
+#include <sstream>
+#include <stdexcept>
 
 #include "Symmetry.h"
 #include "Combination.h"
+#include "CombinationIndex.h"
 #include "NSymmetry.h"
 
 namespace EDLib {
   namespace Symmetry {
-/**
- * Sz symmetry class
- */
-    class SzSymmetry : public Symmetry {
+    /**
+     * Symmetry sector with fixed numbers of spin-up and spin-down electrons
+     */
+    class SzSector {
     public:
-      class Sector {
-      public:
-        friend class SzSymmetry;
+      template<typename St>
+      friend class SzSymmetryT;
 
-        friend std::ostream &operator<<(std::ostream &o, const SzSymmetry::Sector &c) { return o << " (nup: " << c._nup << " ndown: " << c._ndown << ") size: " << c._size; }
+      friend std::ostream &operator<<(std::ostream &o, const SzSector &c) { return o << " (nup: " << c._nup << " ndown: " << c._ndown << ") size: " << c._size; }
 
-        Sector(int up, int down, size_t size) : _nup(up), _ndown(down), _size(size) {};
+      SzSector(int up, int down, size_t size) : _nup(up), _ndown(down), _size(size) {};
 
-        int nup() const { return _nup; }
+      int nup() const { return _nup; }
 
-        int ndown() const { return _ndown; }
+      int ndown() const { return _ndown; }
 
-        size_t size() const { return _size; }
+      size_t size() const { return _size; }
 
-        void print() const {
-          std::cout << _nup << " " << _ndown;
-        }
-      protected:
-        bool operator<(Sector s) {
-          return _size < s._size;
-        }
+      void print() const {
+        std::cout << _nup << " " << _ndown;
+      }
+    protected:
+      bool operator<(SzSector s) {
+        return _size < s._size;
+      }
 
-      private:
-        int _nup;
-        int _ndown;
-        size_t _size;
-      };
+    private:
+      int _nup;
+      int _ndown;
+      size_t _size;
+    };
 
-      SzSymmetry(int N) :Symmetry(), _current_sector(-1, -1, 0), _Ns(N), upstate(N + 1), dostate(N + 1),
-                         _comb(N), basis(N + 1), ninv(N + 1, std::vector < int >(1 << N, 0)),
-                         _first(true) {
+/**
+ * Sz symmetry class
+ *
+ * Basis state keeps the spin-up configuration in the upper Ns bits and the spin-down configuration in the lower Ns bits.
+ * Each configuration is ranked separately, so both halves should fit in 64 bits.
+ *
+ * @tparam St - integer type of the basis states
+ */
+    template<typename St>
+    class SzSymmetryT : public Symmetry < St > {
+    public:
+      typedef St State;
+      typedef SzSector Sector;
+      using Symmetry < St >::state;
+
+      SzSymmetryT(int N) : Symmetry < St >(), _current_sector(-1, -1, 0), _Ns(N), _comb(N), _index(N), _first(true) {
         initial_fill();
       };
 
-      SzSymmetry(alps::params &p) : Symmetry(), _current_sector(-1, -1, 0), _Ns(p["NSITES"]), upstate(_Ns + 1), dostate(_Ns + 1),
-                                _comb(_Ns), basis(_Ns + 1), ninv(_Ns + 1, std::vector < int >(1 << _Ns, 0)),
-                                _first(true) {
+      SzSymmetryT(alps::params &p) : Symmetry < St >(), _current_sector(-1, -1, 0), _Ns(p["NSITES"]), _comb(_Ns), _index(_Ns), _first(true) {
         initial_fill();
         if (p.exists("arpack.SECTOR") && bool(p["arpack.SECTOR"])) {
           std::vector < std::vector < int > > sectors;
@@ -63,18 +76,18 @@ namespace EDLib {
           input_file >> alps::make_pvp("sectors/values", sectors);
           input_file.close();
           for (int i = 0; i < sectors.size(); ++i) {
-            _sectors.push(SzSymmetry::Sector(sectors[i][0], sectors[i][1], (size_t) (_comb.c_n_k(_Ns, sectors[i][0]) * _comb.c_n_k(_Ns, sectors[i][1]))));
+            _sectors.push(Sector(sectors[i][0], sectors[i][1], (size_t) (_comb.c_n_k(_Ns, sectors[i][0]) * _comb.c_n_k(_Ns, sectors[i][1]))));
           }
         } else {
           for (int i = 0; i <= _Ns; ++i) {
             for (int j = 0; j <= _Ns; ++j) {
-              _sectors.push(SzSymmetry::Sector(i, j, (size_t) (_comb.c_n_k(_Ns, i) * _comb.c_n_k(_Ns, j))));
+              _sectors.push(Sector(i, j, (size_t) (_comb.c_n_k(_Ns, i) * _comb.c_n_k(_Ns, j))));
             }
           }
         }
       }
 
-      virtual ~SzSymmetry() {};
+      virtual ~SzSymmetryT() {};
 
       virtual bool next_state() {
         if (_first) {
@@ -88,29 +101,40 @@ namespace EDLib {
         return true;
       }
 
-      inline long long state_by_index(int ind) {
-        int u = ind / _comb.c_n_k(_Ns, _current_sector.ndown());
-        int d = ind % _comb.c_n_k(_Ns, _current_sector.ndown());
-        long long res = basis[_current_sector.nup()][u];
+      /**
+       * @param ind - index of the basis state in the current sector, the sector dimension can exceed 2^31
+       * @return basis state
+       */
+      inline State state_by_index(size_t ind) {
+        long long u = (long long) (ind / _comb.c_n_k(_Ns, _current_sector.ndown()));
+        long long d = (long long) (ind % _comb.c_n_k(_Ns, _current_sector.ndown()));
+        State res = _index.state(u, _current_sector.nup());
         res <<= _Ns;
-        res += basis[_current_sector.ndown()][d];
+        res += _index.state(d, _current_sector.ndown());
         return res;
       }
 
-      int index(long long state, const SzSymmetry::Sector &sector) {
-        long long up = state >> _Ns;
-        long long down = state & ((1ll << _Ns) - 1);
-        int cup = _comb.c_n_k(_Ns, sector.nup());
-        int cdo = _comb.c_n_k(_Ns, sector.ndown());
-        return ninv[sector.nup()][(int) up] * (cdo) + ninv[sector.ndown()][(int) down];
+      long long index(State state, const Sector &sector) {
+        unsigned long long up = (unsigned long long) (state >> _Ns);
+        unsigned long long down = (unsigned long long) (state & ((State(1) << _Ns) - 1));
+        long long cdo = (long long) (_comb.c_n_k(_Ns, sector.ndown()));
+        return _index.index(up, sector.nup()) * cdo + _index.index(down, sector.ndown());
       }
 
-      virtual int index(long long state) {
+      virtual long long index(State state) {
         return index(state, _current_sector);
       }
 
+      /**
+       * Add matrix element between the i-th basis state and the state to the i-th row of the Hamiltonian matrix
+       */
+      template<typename prec, typename Row>
+      inline void add_element(int i, State state, prec value, Row &row) {
+        row.add(index(state, _current_sector), value);
+      }
+
       virtual void reset() {
-        state() = 0ll;
+        state() = State(0);
         _first = true;
         _ind = 0;
       }
@@ -118,8 +142,6 @@ namespace EDLib {
       virtual void init() {
         // TODO: Decide what we should have to init
         reset();
-        _comb.init_state(_current_sector.nup(), upstate);
-        _comb.init_state(_current_sector.ndown(), dostate);
       };
 
       virtual bool next_sector() {
@@ -132,12 +154,12 @@ namespace EDLib {
         return true;
       }
 
-      void set_sector(const SzSymmetry::Sector &sector) {
+      void set_sector(const Sector &sector) {
         _current_sector = sector;
         init();
       }
 
-      const SzSymmetry::Sector &sector() const {
+      const Sector &sector() const {
         return _current_sector;
       }
 
@@ -149,49 +171,36 @@ namespace EDLib {
 #endif
     private:
       void initial_fill() {
+        if (2 * _Ns > Symmetry < St >::max_orbitals() || _Ns > 64) {
+          std::stringstream s;
+          s << "Basis state type can not represent " << 2 * _Ns << " spin-orbitals.";
+          throw std::invalid_argument(s.str().c_str());
+        }
         _Ip = 2 * _Ns;
         _ind = 0;
-        for (int i = 0; i <= _Ns; ++i) {
-          int cnk = _comb.c_n_k(_Ns, i);
-          basis[i].reserve(cnk);
-          for (int k = 0; k < cnk; ++k) {
-            basis[i][k] = next_basis(_Ns, i, upstate, k == 0);
-            ninv[i][basis[i][k]] = k;
-          }
-        }
       };
 
-      int next_basis(int n, int k, std::vector < int > &old, bool start) {
-        int res = 0;
-        if (start) {
-          _comb.init_state(k, old);
-          //pass
-        } else {
-          _comb.next_combination(n, k, old);
-        }
-        for (int i = 0; i < k; i++) {
-          res += (1 << old[i]);
-        }
-        return res;
-      }
-
-      SzSymmetry::Sector _current_sector;
-      std::queue < SzSymmetry::Sector > _sectors;
+      Sector _current_sector;
+      std::queue < Sector > _sectors;
       int _Ns;
       int _Ip;
-      int _ind;
-      std::vector < int > upstate;
-      std::vector < int > dostate;
-      std::vector < std::vector < int > > basis;
-      std::vector < std::vector < int > > ninv;
+      size_t _ind;
       Combination _comb;
+      /// ranking of the spin-up and spin-down configurations
+      CombinationIndex _index;
       bool _first;
     protected:
     public:
-      std::queue<SzSymmetry::Sector> &sectors() {
+      std::queue<Sector> &sectors() {
         return _sectors;
       }
     };
+
+    typedef SzSymmetryT < long long > SzSymmetry;
+#ifdef __SIZEOF_INT128__
+    /// Sz symmetry for up to 128 spin-orbitals
+    typedef SzSymmetryT < unsigned __int128 > SzSymmetry128;
+#endif
   }
 }
 
@@ -0,0 +1,393 @@
+#ifndef HUBBARD_THICKRESTARTLANCZOS_H
+#define HUBBARD_THICKRESTARTLANCZOS_H
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace EDLib {
+  namespace Storage {
+
+    /**
+     * @brief Thick-restart Lanczos method for the lowest eigen-pairs of a real symmetric matrix
+     *
+     * The Krylov basis is extended up to ncv vectors, then it is restarted with the lowest Ritz vectors and the residual
+     * vector (K. Wu and H. Simon, SIAM J. Matrix Anal. Appl. 22, 602 (2000)). After the restart the projected matrix is
+     * an arrowhead matrix followed by the tridiagonal Lanczos matrix. Each new Lanczos vector is orthogonalized against
+     * the basis by classical Gram-Schmidt, the second pass is performed only if the first one has removed most of the norm
+     * of the vector (DGKS criterion). The projected matrix is diagonalized by the Jacobi method.
+     *
+     * The Krylov basis can be stored in lower precision than the vectors of the matrix-vector product. Projections,
+     * Ritz values and Ritz vectors are computed in double precision, and the eigenvalues are recomputed as the Rayleigh
+     * quotients of the Ritz vectors.
+     *
+     * @tparam prec - precision of the vectors of the matrix-vector product and of the eigen-pairs
+     * @tparam basis_prec - precision of the stored Krylov basis
+     */
+    template<typename prec, typename basis_prec = prec>
+    class ThickRestartLanczos {
+    public:
+      /// w = A v for the local parts of the vectors
+      typedef std::function < void(prec *, prec *, size_t) > Operator;
+      /// in-place sum of the array over all CPUs that share the vectors
+      typedef std::function < void(double *, int) > Reduction;
+
+      /**
+       * @param n - local dimension
+       * @param ntot - total dimension
+       * @param nev - number of eigen-pairs
+       * @param ncv - largest size of the Krylov basis
+       * @param tol - relative tolerance for the residual norms of the Ritz pairs
+       * @param maxitr - largest number of restarts
+       */
+      ThickRestartLanczos(size_t n, size_t ntot, int nev, int ncv, double tol, int maxitr) : _n(n), _m(int(std::min(size_t(std::max(ncv, nev + 1)), ntot))),
+                                                                                         _nev(std::min(nev, _m)), _tol(tol), _maxitr(maxitr),
+                                                                                         _restarts(0), _matvecs(0), _anorm(0.0) {
+        if (std::numeric_limits < basis_prec >::epsilon() > 10 * std::numeric_limits < double >::epsilon()) {
+          /// the residual norm estimates are limited by the rounding of the basis vectors
+          _tol = std::max(_tol, 10.0 * std::numeric_limits < basis_prec >::epsilon());
+        }
+      }
+
+      /**
+       * Compute the lowest eigen-pairs
+       *
+       * @param op - matrix-vector product
+       * @param sum - reduction over the CPUs
+       * @param start - local part of the starting vector, random vector is used if it is empty
+       * @param seed - seed for the random vectors
+       * @param evals - lowest eigenvalues in ascending order
+       * @param evecs - local parts of the eigenvectors
+       * @param vectors - compute eigenvectors
+       * @return 0 if all eigen-pairs have converged, 1 if the maximum number of restarts has been reached
+       */
+      int solve(const Operator &op, const Reduction &sum, const std::vector < prec > &start, int seed,
+                std::vector < prec > &evals, std::vector < std::vector < prec > > &evecs, bool vectors) {
+        std::mt19937 gen(seed);
+        _V.assign(_m + 1, std::vector < basis_prec >(_n, basis_prec(0.0)));
+        _T.assign(_m * _m, 0.0);
+        _restarts = 0;
+        _matvecs = 0;
+        _anorm = 0.0;
+        std::vector < prec > v(_n), w(_n);
+        if (start.size() == _n) {
+          std::copy(start.begin(), start.end(), w.begin());
+        }
+        if (normalize(sum, w) == 0.0) {
+          random_vector(gen, w);
+          orthogonalize(sum, 0, w);
+          normalize(sum, w);
+        }
+        store(w, _V[0]);
+        std::vector < double > theta, Y;
+        int k = 0;
+        int info = 0;
+        double beta = 0.0;
+        while (true) {
+          for (int j = k; j < _m; ++j) {
+            load(_V[j], v);
+            op(v.data(), w.data(), _n);
+            ++_matvecs;
+            /// known couplings to the previous vectors
+            for (int i = 0; i < j; ++i) {
+              double t = _T[i * _m + j];
+              if (t != 0.0) {
+                axpy(-t, _V[i], w);
+              }
+            }
+            _T[j * _m + j] = orthogonalize(sum, j + 1, w)[j];
+            beta = norm(sum, w);
+            if (beta <= std::numeric_limits < double >::epsilon() * _anorm && j + 1 < _m) {
+              /// invariant subspace has been found, continue with a random vector
+              random_vector(gen, w);
+              orthogonalize(sum, j + 1, w);
+              normalize(sum, w);
+              beta = 0.0;
+            } else if (beta > 0.0) {
+              scale(1.0 / beta, w);
+            }
+            _anorm = std::max(_anorm, std::abs(_T[j * _m + j]) + beta);
+            store(w, _V[j + 1]);
+            if (j + 1 < _m) {
+              _T[j * _m + j + 1] = _T[(j + 1) * _m + j] = beta;
+            }
+          }
+          eigen(_T, _m, theta, Y);
+          int nconv = 0;
+          double eps23 = std::pow(std::numeric_limits < double >::epsilon(), 2.0 / 3.0);
+          for (int i = 0; i < _nev; ++i) {
+            if (std::abs(beta * Y[(_m - 1) * _m + i]) <= _tol * std::max(eps23, std::abs(theta[i]))) {
+              ++nconv;
+            }
+          }
+          if (nconv == _nev || beta == 0.0) {
+            break;
+          }
+          if (_restarts >= _maxitr) {
+            info = 1;
+            break;
+          }
+          ++_restarts;
+          /// keep the lowest Ritz vectors and the residual vector
+          k = std::min(_nev + (_m - _nev) / 2, _m - 1);
+          ritz_vectors(Y, k, _V);
+          _V[k].swap(_V[_m]);
+          std::fill(_T.begin(), _T.end(), 0.0);
+          for (int i = 0; i < k; ++i) {
+            _T[i * _m + i] = theta[i];
+            _T[i * _m + k] = _T[k * _m + i] = beta * Y[(_m - 1) * _m + i];
+          }
+        }
+        evals.assign(theta.begin(), theta.begin() + _nev);
+        if (vectors || !is_same_precision()) {
+          ritz_vectors(Y, _nev, _V);
+          evecs.assign(_nev, std::vector < prec >(_n));
+          for (int i = 0; i < _nev; ++i) {
+            load(_V[i], evecs[i]);
+          }
+          if (!is_same_precision()) {
+            /// Rayleigh quotients of the Ritz vectors
+            for (int i = 0; i < _nev; ++i) {
+              normalize(sum, evecs[i]);
+              op(evecs[i].data(), w.data(), _n);
+              ++_matvecs;
+              double rq = 0.0;
+              for (size_t l = 0; l < _n; ++l) {
+                rq += double(evecs[i][l]) * double(w[l]);
+              }
+              sum(&rq, 1);
+              evals[i] = prec(rq);
+            }
+          }
+        }
+        _V.clear();
+        return info;
+      }
+
+      /**
+       * @return number of restarts in the last run
+       */
+      int restarts() const {
+        return _restarts;
+      }
+
+      /**
+       * @return number of matrix-vector products in the last run
+       */
+      size_t matvecs() const {
+        return _matvecs;
+      }
+
+      /**
+       * Eigen-decomposition of the dense symmetric matrix by the cyclic Jacobi method
+       *
+       * @param A - row-major m x m matrix
+       * @param m - matrix size
+       * @param evals - eigenvalues in ascending order
+       * @param evecs - row-major m x m matrix, i-th column is the i-th eigenvector
+       */
+      static void eigen(std::vector < double > A, int m, std::vector < double > &evals, std::vector < double > &evecs) {
+        std::vector < double > Q(m * m, 0.0);
+        for (int i = 0; i < m; ++i) {
+          Q[i * m + i] = 1.0;
+        }
+        for (int sweep = 0; sweep < 100; ++sweep) {
+          double off = 0.0;
+          double diag = 0.0;
+          for (int p = 0; p < m; ++p) {
+            diag += A[p * m + p] * A[p * m + p];
+            for (int q = p + 1; q < m; ++q) {
+              off += A[p * m + q] * A[p * m + q];
+            }
+          }
+          if (off <= std::numeric_limits < double >::epsilon() * std::numeric_limits < double >::epsilon() * diag || off == 0.0) {
+            break;
+          }
+          for (int p = 0; p < m; ++p) {
+            for (int q = p + 1; q < m; ++q) {
+              double apq = A[p * m + q];
+              if (apq == 0.0) {
+                continue;
+              }
+              double tau = (A[q * m + q] - A[p * m + p]) / (2.0 * apq);
+              double t = (tau >= 0.0 ? 1.0 : -1.0) / (std::abs(tau) + std::sqrt(1.0 + tau * tau));
+              double c = 1.0 / std::sqrt(1.0 + t * t);
+              double s = t * c;
+              for (int r = 0; r < m; ++r) {
+                double arp = A[r * m + p];
+                double arq = A[r * m + q];
+                A[r * m + p] = c * arp - s * arq;
+                A[r * m + q] = s * arp + c * arq;
+              }
+              for (int r = 0; r < m; ++r) {
+                double apr = A[p * m + r];
+                double aqr = A[q * m + r];
+                A[p * m + r] = c * apr - s * aqr;
+                A[q * m + r] = s * apr + c * aqr;
+              }
+              for (int r = 0; r < m; ++r) {
+                double qrp = Q[r * m + p];
+                double qrq = Q[r * m + q];
+                Q[r * m + p] = c * qrp - s * qrq;
+                Q[r * m + q] = s * qrp + c * qrq;
+              }
+            }
+          }
+        }
+        std::vector < int > order(m);
+        for (int i = 0; i < m; ++i) {
+          order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&A, m](int a, int b) { return A[a * m + a] < A[b * m + b]; });
+        evals.resize(m);
+        evecs.resize(m * m);
+        for (int i = 0; i < m; ++i) {
+          evals[i] = A[order[i] * m + order[i]];
+          for (int r = 0; r < m; ++r) {
+            evecs[r * m + i] = Q[r * m + order[i]];
+          }
+        }
+      }
+
+    private:
+      size_t _n;
+      /// size of the Krylov basis
+      int _m;
+      int _nev;
+      double _tol;
+      int _maxitr;
+      int _restarts;
+      size_t _matvecs;
+      /// estimate of the matrix norm
+      double _anorm;
+      /// Krylov basis and the residual vector
+      std::vector < std::vector < basis_prec > > _V;
+      /// projected matrix
+      std::vector < double > _T;
+
+      static bool is_same_precision() {
+        return std::numeric_limits < basis_prec >::digits >= std::numeric_limits < prec >::digits;
+      }
+
+      /**
+       * Orthogonalize w against the first nvec basis vectors
+       *
+       * @return projections of w on the basis vectors
+       */
+      std::vector < double > orthogonalize(const Reduction &sum, int nvec, std::vector < prec > &w) {
+        std::vector < double > h(nvec, 0.0);
+        if (nvec == 0) {
+          return h;
+        }
+        double before = norm(sum, w);
+        for (int pass = 0; pass < 2; ++pass) {
+          std::vector < double > c(nvec, 0.0);
+          for (int i = 0; i < nvec; ++i) {
+            const std::vector < basis_prec > &vi = _V[i];
+            double s = 0.0;
+            for (size_t l = 0; l < _n; ++l) {
+              s += double(vi[l]) * double(w[l]);
+            }
+            c[i] = s;
+          }
+          sum(c.data(), nvec);
+          for (int i = 0; i < nvec; ++i) {
+            axpy(-c[i], _V[i], w);
+            h[i] += c[i];
+          }
+          double after = norm(sum, w);
+          /// DGKS criterion: repeat only if the cancellation was significant
+          if (after > 0.7071 * before) {
+            break;
+          }
+          before = after;
+        }
+        return h;
+      }
+
+      double norm(const Reduction &sum, const std::vector < prec > &w) const {
+        double s = 0.0;
+        for (size_t l = 0; l < _n; ++l) {
+          s += double(w[l]) * double(w[l]);
+        }
+        sum(&s, 1);
+        return std::sqrt(s);
+      }
+
+      double normalize(const Reduction &sum, std::vector < prec > &w) const {
+        double nrm = norm(sum, w);
+        if (nrm > 0.0) {
+          scale(1.0 / nrm, w);
+        }
+        return nrm;
+      }
+
+      void scale(double a, std::vector < prec > &w) const {
+        for (size_t l = 0; l < _n; ++l) {
+          w[l] = prec(a * w[l]);
+        }
+      }
+
+      void axpy(double a, const std::vector < basis_prec > &x, std::vector < prec > &w) const {
+        for (size_t l = 0; l < _n; ++l) {
+          w[l] = prec(w[l] + a * double(x[l]));
+        }
+      }
+
+      void random_vector(std::mt19937 &gen, std::vector < prec > &w) const {
+        std::uniform_real_distribution < double > dist(-1.0, 1.0);
+        for (size_t l = 0; l < _n; ++l) {
+          w[l] = prec(dist(gen));
+        }
+      }
+
+      void store(const std::vector < prec > &w, std::vector < basis_prec > &x) const {
+        for (size_t l = 0; l < _n; ++l) {
+          x[l] = basis_prec(w[l]);
+        }
+      }
+
+      void load(const std::vector < basis_prec > &x, std::vector < prec > &w) const {
+        for (size_t l = 0; l < _n; ++l) {
+          w[l] = prec(x[l]);
+        }
+      }
+
+      /**
+       * Replace the first k basis vectors by the Ritz vectors, the rows of the basis are transformed independently
+       *
+       * @param Y - eigenvectors of the projected matrix
+       * @param k - number of Ritz vectors
+       */
+      void ritz_vectors(const std::vector < double > &Y, int k, std::vector < std::vector < basis_prec > > &V) const {
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        {
+          std::vector < double > row(k);
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+          for (long long l = 0; l < (long long) (_n); ++l) {
+            std::fill(row.begin(), row.end(), 0.0);
+            for (int j = 0; j < _m; ++j) {
+              double vj = double(V[j][l]);
+              for (int i = 0; i < k; ++i) {
+                row[i] += vj * Y[j * _m + i];
+              }
+            }
+            for (int i = 0; i < k; ++i) {
+              V[i][l] = basis_prec(row[i]);
+            }
+          }
+        }
+      }
+    };
+
+  }
+}
+
+#endif //HUBBARD_THICKRESTARTLANCZOS_H
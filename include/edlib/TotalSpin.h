@@ -0,0 +1,233 @@
+#ifndef HUBBARD_TOTALSPIN_H
+#define HUBBARD_TOTALSPIN_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "SzSymmetry.h"
+
+namespace EDLib {
+  namespace Symmetry {
+    /**
+     * @brief Total spin operator S^2 in the basis of the Sz symmetry
+     *
+     * S^2 is applied as S^- S^+ + Sz^2 + Sz, where S^+ = sum_i c^+_{i up} c_{i down}, so the product does not leave
+     * the (nup, ndown) sector. In the sector with Sz = -S all states have total spin S' >= S and the states with S' = S
+     * are the lowest states of the multiplets, so the S-projection of a vector can be computed with the Lowdin projector
+     *
+     *   P_S = prod_{S' != S} (S^2 - S'(S'+1)) / (S(S+1) - S'(S'+1)).
+     *
+     * All routines work with the complete vectors of the sector.
+     */
+    class TotalSpin {
+    public:
+      /**
+       * @param Ns - number of sites
+       */
+      TotalSpin(int Ns) : _Ns(Ns), _Ip(2 * Ns) {}
+
+      /**
+       * Apply S^2 to the vector. S^2 is a real symmetric matrix, so each row of the product is computed independently
+       * and only the rows [begin, end) can be computed for the distributed vectors.
+       *
+       * @param symmetry - Sz symmetry used to enumerate basis states, current sector is set to the sector
+       * @param sector - sector of the vector
+       * @param in - complete vector in the sector
+       * @param out - rows [begin, end) of S^2 applied to the vector
+       * @param begin - first row
+       * @param end - row after the last one, the sector dimension if not specified
+       */
+      template<typename prec>
+      void apply(SzSymmetry &symmetry, const SzSymmetry::Sector &sector, const std::vector < prec > &in, std::vector < prec > &out,
+                 size_t begin = 0, size_t end = size_t(-1)) const {
+        symmetry.set_sector(sector);
+        end = std::min(end, sector.size());
+        out.assign(end - begin, prec(0.0));
+        for (size_t i = begin; i < end; ++i) {
+          prec result = prec(0.0);
+          row(symmetry, sector, i, [&result, &in] (size_t j, double value) {
+            result += prec(value) * in[j];
+          });
+          out[i - begin] = result;
+        }
+      }
+
+      /**
+       * Store the rows [begin, end) of S^2 in the compressed row format, so that S^2 can be applied repeatedly without
+       * enumeration of the basis states.
+       *
+       * @param symmetry - Sz symmetry used to enumerate basis states, current sector is set to the sector
+       * @param sector - sector of the matrix
+       * @param row_ptr - position of the first element of each row and the total number of elements
+       * @param col_ind - column of each element
+       * @param values - matrix elements
+       * @param begin - first row
+       * @param end - row after the last one, the sector dimension if not specified
+       */
+      template<typename prec>
+      void matrix(SzSymmetry &symmetry, const SzSymmetry::Sector &sector, std::vector < size_t > &row_ptr, std::vector < size_t > &col_ind,
+                  std::vector < prec > &values, size_t begin = 0, size_t end = size_t(-1)) const {
+        symmetry.set_sector(sector);
+        end = std::min(end, sector.size());
+        row_ptr.assign(1, 0);
+        col_ind.clear();
+        values.clear();
+        for (size_t i = begin; i < end; ++i) {
+          row(symmetry, sector, i, [&col_ind, &values] (size_t j, double value) {
+            col_ind.push_back(j);
+            values.push_back(prec(value));
+          });
+          row_ptr.push_back(col_ind.size());
+        }
+      }
+
+      /**
+       * Apply S^+ to the vector, the product belongs to the sector (nup + 1, ndown - 1). Within a multiplet S^+ raises
+       * Sz by one, so the other members of the multiplet are obtained from its Sz = -S member.
+       *
+       * @param symmetry - Sz symmetry used to enumerate basis states, current sector is set to the sector
+       * @param sector - sector of the vector
+       * @param in - complete vector in the sector
+       * @param out - complete vector in the sector (nup + 1, ndown - 1)
+       */
+      template<typename prec>
+      void raise(SzSymmetry &symmetry, const SzSymmetry::Sector &sector, const std::vector < prec > &in, std::vector < prec > &out) const {
+        SzSymmetry::Sector next(sector.nup() + 1, sector.ndown() - 1,
+                                symmetry.comb().c_n_k(_Ns, sector.nup() + 1) * symmetry.comb().c_n_k(_Ns, sector.ndown() - 1));
+        symmetry.set_sector(sector);
+        out.assign(next.size(), prec(0.0));
+        for (size_t i = 0; i < sector.size(); ++i) {
+          long long nst = symmetry.state_by_index(i);
+          for (int jj = 0; jj < _Ns; ++jj) {
+            int sign;
+            long long k;
+            if (hop(nst, jj + _Ns, jj, k, sign)) {
+              out[symmetry.index(k, next)] += prec(sign) * in[i];
+            }
+          }
+        }
+      }
+
+      /**
+       * @return expectation value of S^2 for the vector
+       */
+      template<typename prec>
+      double expectation(SzSymmetry &symmetry, const SzSymmetry::Sector &sector, const std::vector < prec > &vec) const {
+        std::vector < prec > s2;
+        apply(symmetry, sector, vec, s2);
+        double num = 0.0;
+        double norm = 0.0;
+        for (size_t i = 0; i < vec.size(); ++i) {
+          num += double(vec[i]) * s2[i];
+          norm += double(vec[i]) * vec[i];
+        }
+        return norm > 0.0 ? num / norm : 0.0;
+      }
+
+      /**
+       * Project the vector onto the states with total spin S and normalize it.
+       *
+       * @param symmetry - Sz symmetry used to enumerate basis states
+       * @param sector - sector of the vector, Sz = (nup - ndown) / 2 should satisfy |Sz| <= S
+       * @param S - total spin
+       * @param vec - vector to project
+       * @return norm of the projected vector before normalization
+       */
+      template<typename prec>
+      double project(SzSymmetry &symmetry, const SzSymmetry::Sector &sector, double S, std::vector < prec > &vec) const {
+        int n = sector.nup() + sector.ndown();
+        double smin = 0.5 * std::abs(sector.nup() - sector.ndown());
+        double smax = 0.5 * std::min(n, _Ip - n);
+        double target = S * (S + 1);
+        std::vector < prec > s2;
+        for (double sp = smin; sp <= smax + 1e-8; sp += 1.0) {
+          if (std::abs(sp - S) < 1e-8) {
+            continue;
+          }
+          double eig = sp * (sp + 1);
+          apply(symmetry, sector, vec, s2);
+          for (size_t i = 0; i < vec.size(); ++i) {
+            vec[i] = prec((s2[i] - eig * vec[i]) / (target - eig));
+          }
+        }
+        double norm = 0.0;
+        for (size_t i = 0; i < vec.size(); ++i) {
+          norm += double(vec[i]) * vec[i];
+        }
+        norm = std::sqrt(norm);
+        if (norm > 0.0) {
+          for (size_t i = 0; i < vec.size(); ++i) {
+            vec[i] = prec(vec[i] / norm);
+          }
+        }
+        return norm;
+      }
+
+    private:
+      int _Ns;
+      int _Ip;
+
+      /**
+       * Enumerate the non-zero elements of the i-th row of S^2, the diagonal element Sz^2 + Sz goes first and the
+       * elements of S^- S^+ follow, so the same column can appear more than once.
+       *
+       * @param element - callback called with the column index and the matrix element
+       */
+      template<typename Callback>
+      void row(SzSymmetry &symmetry, const SzSymmetry::Sector &sector, size_t i, Callback element) const {
+        long long nst = symmetry.state_by_index(int(i));
+        double sz = 0.5 * (sector.nup() - sector.ndown());
+        element(i, sz * sz + sz);
+        for (int jj = 0; jj < _Ns; ++jj) {
+          int sign1;
+          long long k1;
+          /// S^+_j: move the spin-down electron of the site j to the spin-up orbital
+          if (!hop(nst, jj + _Ns, jj, k1, sign1)) {
+            continue;
+          }
+          for (int ii = 0; ii < _Ns; ++ii) {
+            int sign2;
+            long long k2;
+            /// S^-_i: move the spin-up electron of the site i to the spin-down orbital
+            if (!hop(k1, ii, ii + _Ns, k2, sign2)) {
+              continue;
+            }
+            element(size_t(symmetry.index(k2, sector)), double(sign1 * sign2));
+          }
+        }
+      }
+
+      /**
+       * Apply c^+_to c_from to the basis state
+       *
+       * @return false if the from orbital is empty or the to orbital is occupied
+       */
+      bool hop(long long state, int from, int to, long long &k, int &sign) const {
+        long long bfrom = 1ll << (_Ip - 1 - from);
+        long long bto = 1ll << (_Ip - 1 - to);
+        if ((state & bfrom) == 0 || (state & bto) != 0) {
+          return false;
+        }
+        k = state - bfrom;
+        int count = occupied_before(state, from) + occupied_before(k, to);
+        k += bto;
+        sign = (count % 2 == 0) ? 1 : -1;
+        return true;
+      }
+
+      /**
+       * @return number of occupied spin-orbitals preceding the spin-orbital i in the fermionic ordering
+       */
+      int occupied_before(long long state, int i) const {
+        int count = 0;
+        for (int ll = 0; ll < i; ++ll) {
+          count += (state & (1ll << (_Ip - 1 - ll))) != 0 ? 1 : 0;
+        }
+        return count;
+      }
+    };
+  }
+}
+
+#endif //HUBBARD_TOTALSPIN_H
@@ -0,0 +1,403 @@
+#ifndef HUBBARD_TRANSLATIONSYMMETRY_H
+#define HUBBARD_TRANSLATIONSYMMETRY_H
+
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "Symmetry.h"
+#include "Combination.h"
+
+namespace EDLib {
+  namespace Symmetry {
+    /**
+     * @brief Sz and lattice momentum symmetry for periodic LX x LY clusters
+     *
+     * Site (x, y) has index x + LX * y. Translation T_g by g = (gx, gy) maps creation operator of site i onto the creation
+     * operator of the translated site, so T_g|s> = tau_g(s) |T_g s>, where tau_g(s) is the sign of the permutation of
+     * the occupied spin-orbitals. Each translation orbit is represented by its smallest state r, the momentum state
+     *
+     *   |r, k> = 1/sqrt(N |S_r|) sum_g exp(-i k g) T_g |r>,
+     *
+     * exists if exp(i k h) = tau_h(r) for all translations h from the stabilizer S_r of r.
+     *
+     * Hamiltonian in momentum sector k is complex Hermitian matrix M = A + iB. To keep the real arithmetic of the storages
+     * and eigen-solvers, sectors k and -k are combined in one sector with the real symmetric matrix
+     *
+     *   | A  -B |
+     *   | B   A |
+     *
+     * acting on real vectors (Re v, Im v). Basis states [0, nrep) are the real parts and [nrep, 2 nrep) are the imaginary
+     * parts of the momentum states. Sectors with k = -k (k = 0 and k = pi) have real matrix of dimension nrep.
+     * Sector dimension is approximately 2/N (1/N for k = -k) of the corresponding Sz sector.
+     */
+    class TranslationSymmetry : public Symmetry<> {
+    public:
+      class Sector {
+      public:
+        friend class TranslationSymmetry;
+
+        friend std::ostream &operator<<(std::ostream &o, const TranslationSymmetry::Sector &c) {
+          return o << " (nup: " << c._nup << " ndown: " << c._ndown << " kx: " << c._kx << " ky: " << c._ky << ") size: " << c._size;
+        }
+
+        Sector(int up, int down, int kx, int ky, size_t size) : _nup(up), _ndown(down), _kx(kx), _ky(ky), _size(size) {};
+
+        int nup() const { return _nup; }
+
+        int ndown() const { return _ndown; }
+
+        int kx() const { return _kx; }
+
+        int ky() const { return _ky; }
+
+        size_t size() const { return _size; }
+
+        void print() const {
+          std::cout << _nup << " " << _ndown << " " << _kx << " " << _ky;
+        }
+
+      private:
+        int _nup;
+        int _ndown;
+        int _kx;
+        int _ky;
+        size_t _size;
+      };
+
+      TranslationSymmetry(alps::params &p) : Symmetry<>(), _current_sector(-1, -1, 0, 0, 0), _table_sector(-1, -1, 0, 0, 0), _Ns(p["NSITES"]),
+                                             _Lx(p.exists("lattice.LX") && p["lattice.LX"].as<int>() > 0 ? p["lattice.LX"].as<int>() : _Ns),
+                                             _Ly(p.exists("lattice.LY") ? p["lattice.LY"].as<int>() : 1),
+                                             _comb(_Ns), _ind(0), _nrep(0), _real(true) {
+        if (_Lx * _Ly != _Ns) {
+          std::stringstream s;
+          s << "Lattice " << _Lx << "x" << _Ly << " does not match the number of sites " << _Ns << ".";
+          throw std::invalid_argument(s.str().c_str());
+        }
+        initial_fill();
+        for (int i = 0; i <= _Ns; ++i) {
+          for (int j = 0; j <= _Ns; ++j) {
+            for (int ky = 0; ky < _Ly; ++ky) {
+              for (int kx = 0; kx < _Lx; ++kx) {
+                /// k and -k are combined in one sector
+                int mk = (_Lx - kx) % _Lx + _Lx * ((_Ly - ky) % _Ly);
+                if (mk < kx + _Lx * ky) {
+                  continue;
+                }
+                size_t size = sector_size(i, j, kx, ky);
+                if (size != 0) {
+                  _sectors.push(Sector(i, j, kx, ky, size));
+                }
+              }
+            }
+          }
+        }
+      }
+
+      virtual ~TranslationSymmetry() {};
+
+      virtual bool next_state() {
+        if (_ind >= _current_sector.size()) {
+          return false;
+        }
+        state() = state_by_index(_ind);
+        _ind++;
+        return true;
+      }
+
+      /**
+       * @return representative state of the i-th basis vector
+       */
+      inline long long state_by_index(int i) const {
+        return _states[i < _nrep ? i : i - _nrep];
+      }
+
+      /**
+       * @return index of the real part of the momentum state that contains the state or -1
+       */
+      virtual long long index(long long state) {
+        int g;
+        int sign;
+        return representative_index(representative(state, g, sign));
+      }
+
+      virtual void reset() {
+        state() = 0ll;
+        _ind = 0;
+      }
+
+      virtual void init() {
+        reset();
+        if (_current_sector.size() != 0 && (_current_sector.nup() != _table_sector.nup() || _current_sector.ndown() != _table_sector.ndown() ||
+                                            _current_sector.kx() != _table_sector.kx() || _current_sector.ky() != _table_sector.ky())) {
+          fill_table();
+        }
+      };
+
+      virtual bool next_sector() {
+        if (_sectors.empty())
+          return false;
+        _current_sector = _sectors.front();
+        _sectors.pop();
+        return true;
+      }
+
+      void set_sector(const Sector &sector) {
+        _current_sector = sector;
+        init();
+      }
+
+      const Sector &sector() const {
+        return _current_sector;
+      }
+
+      inline const Combination &comb() const {
+        return _comb;
+      }
+
+      std::queue < Sector > &sectors() {
+        return _sectors;
+      }
+
+      /**
+       * Add the contribution of the transition from the representative of the i-th basis vector into the state to
+       * the i-th row of the Hamiltonian matrix
+       *
+       * @param i - row
+       * @param state - state obtained from the representative of the i-th basis vector
+       * @param value - matrix element between the representative and the state
+       * @param row - row accumulator
+       */
+      template<typename prec, typename Row>
+      inline void add_element(int i, long long state, prec value, Row &row) const {
+        int g;
+        int sign;
+        int j = representative_index(representative(state, g, sign));
+        if (j < 0) {
+          /// translation orbit of the state has no component with momentum k
+          return;
+        }
+        int ir = i < _nrep ? i : i - _nrep;
+        prec a = value * sign * std::sqrt(prec(_stabilizer[j]) / prec(_stabilizer[ir]));
+        if (_real) {
+          row.add(j, a * prec(_cos[g]));
+        } else if (i < _nrep) {
+          if (_cos[g] != 0.0) row.add(j, a * prec(_cos[g]));
+          if (_sin[g] != 0.0) row.add(j + _nrep, a * prec(_sin[g]));
+        } else {
+          if (_sin[g] != 0.0) row.add(j, -a * prec(_sin[g]));
+          if (_cos[g] != 0.0) row.add(j + _nrep, a * prec(_cos[g]));
+        }
+      }
+
+      /**
+       * @return number of lattice translations
+       */
+      int translations() const {
+        return _Lx * _Ly;
+      }
+
+      /**
+       * @return site the i-th site is moved to by the g-th translation
+       */
+      int translate_site(int g, int i) const {
+        int x = i % _Lx;
+        int y = i / _Lx;
+        return (x + g % _Lx) % _Lx + _Lx * ((y + g / _Lx) % _Ly);
+      }
+
+    private:
+      Sector _current_sector;
+      /// sector of the current representative table
+      Sector _table_sector;
+      std::queue < Sector > _sectors;
+      int _Ns;
+      int _Lx;
+      int _Ly;
+      Combination _comb;
+      int _ind;
+      /// Ns-bit words with n particles in ascending order
+      std::vector < std::vector < int > > _words;
+      /// translated Ns-bit word and the parity of the permutation for each translation
+      std::vector < std::vector < int > > _translated;
+      std::vector < std::vector < char > > _parity;
+      std::vector < std::vector < double > > _trace;
+      /// representative states of the current sector in ascending order and the size of their stabilizers
+      std::vector < long long > _states;
+      std::vector < int > _stabilizer;
+      int _nrep;
+      /// true if k = -k in the current sector
+      bool _real;
+      /// cos and sin of the phase -k g acquired by the state when it is mapped onto its representative by T_g
+      std::vector < double > _cos;
+      std::vector < double > _sin;
+
+      void initial_fill() {
+        int N = translations();
+        int nwords = 1 << _Ns;
+        _words.assign(_Ns + 1, std::vector < int >());
+        for (int w = 0; w < nwords; ++w) {
+          _words[std::bitset < 32 >(w).count()].push_back(w);
+        }
+        _translated.assign(N, std::vector < int >(nwords));
+        _parity.assign(N, std::vector < char >(nwords));
+        for (int g = 0; g < N; ++g) {
+          for (int w = 0; w < nwords; ++w) {
+            unsigned long long placed = 0;
+            int inversions = 0;
+            int tw = 0;
+            /// occupied sites in the order of creation operators
+            for (int im = 0; im < _Ns; ++im) {
+              if (w & (1 << (_Ns - 1 - im))) {
+                int p = translate_site(g, im);
+                inversions += int(std::bitset < 64 >(placed >> (p + 1)).count());
+                placed |= 1ull << p;
+                tw |= 1 << (_Ns - 1 - p);
+              }
+            }
+            _translated[g][w] = tw;
+            _parity[g][w] = char(inversions % 2);
+          }
+        }
+        /// trace of each translation in the space of Ns-bit words with n particles
+        _trace.assign(N, std::vector < double >(_Ns + 1, 0.0));
+        for (int g = 0; g < N; ++g) {
+          for (int w = 0; w < nwords; ++w) {
+            if (_translated[g][w] == w) {
+              _trace[g][std::bitset < 32 >(w).count()] += _parity[g][w] ? -1.0 : 1.0;
+            }
+          }
+        }
+      }
+
+      /**
+       * @return phase k g of the g-th translation
+       */
+      double phase(int kx, int ky, int g) const {
+        return 2.0 * M_PI * (double(kx * (g % _Lx)) / _Lx + double(ky * (g / _Lx)) / _Ly);
+      }
+
+      /**
+       * Number of momentum states (nup, ndown, k) is 1/N sum_g exp(-i k g) Tr T_g, the trace factorizes into spin-up and
+       * spin-down traces.
+       */
+      size_t sector_size(int nup, int ndown, int kx, int ky) const {
+        int N = translations();
+        double dim = 0.0;
+        for (int g = 0; g < N; ++g) {
+          dim += std::cos(phase(kx, ky, g)) * _trace[g][nup] * _trace[g][ndown];
+        }
+        size_t nrep = size_t(std::floor(dim / N + 0.5));
+        bool real = (2 * kx) % _Lx == 0 && (2 * ky) % _Ly == 0;
+        return real ? nrep : 2 * nrep;
+      }
+
+      /**
+       * Find the representative of the state
+       *
+       * @param state [in] - state
+       * @param g [out] - translation that maps the state onto its representative
+       * @param sign [out] - fermionic sign of the translation
+       * @return representative state
+       */
+      inline long long representative(long long state, int &g, int &sign) const {
+        int up = int(state >> _Ns);
+        int down = int(state & ((1ll << _Ns) - 1));
+        long long rep = state;
+        g = 0;
+        sign = 1;
+        for (int h = 1; h < translations(); ++h) {
+          long long ts = ((long long) (_translated[h][up]) << _Ns) | _translated[h][down];
+          if (ts < rep) {
+            rep = ts;
+            g = h;
+            sign = (_parity[h][up] ^ _parity[h][down]) ? -1 : 1;
+          }
+        }
+        return rep;
+      }
+
+      /**
+       * @return position of the representative in the current sector or -1
+       */
+      inline int representative_index(long long rep) const {
+        std::vector < long long >::const_iterator it = std::lower_bound(_states.begin(), _states.end(), rep);
+        if (it == _states.end() || *it != rep) {
+          return -1;
+        }
+        return int(it - _states.begin());
+      }
+
+      /**
+       * Build the table of representatives of the current sector. Representative (u, d) has the smallest spin-up word u
+       * in its orbit and the smallest spin-down word d among the translations that leave u unchanged.
+       */
+      void fill_table() {
+        int N = translations();
+        int kx = _current_sector.kx();
+        int ky = _current_sector.ky();
+        _real = (2 * kx) % _Lx == 0 && (2 * ky) % _Ly == 0;
+        _cos.resize(N);
+        _sin.resize(N);
+        for (int g = 0; g < N; ++g) {
+          double c = std::cos(phase(kx, ky, g));
+          double s = -std::sin(phase(kx, ky, g));
+          _cos[g] = std::abs(c) < 1e-14 ? 0.0 : c;
+          _sin[g] = std::abs(s) < 1e-14 ? 0.0 : s;
+        }
+        _states.clear();
+        _stabilizer.clear();
+        const std::vector < int > &up_words = _words[_current_sector.nup()];
+        const std::vector < int > &down_words = _words[_current_sector.ndown()];
+        std::vector < int > up_stabilizer;
+        for (size_t iu = 0; iu < up_words.size(); ++iu) {
+          int u = up_words[iu];
+          up_stabilizer.clear();
+          bool smallest = true;
+          for (int g = 0; g < N && smallest; ++g) {
+            smallest = _translated[g][u] >= u;
+            if (_translated[g][u] == u) {
+              up_stabilizer.push_back(g);
+            }
+          }
+          if (!smallest) {
+            continue;
+          }
+          for (size_t id = 0; id < down_words.size(); ++id) {
+            int d = down_words[id];
+            bool compatible = true;
+            int stabilizer = 0;
+            for (size_t ih = 0; ih < up_stabilizer.size() && compatible; ++ih) {
+              int h = up_stabilizer[ih];
+              int td = _translated[h][d];
+              compatible = td >= d;
+              if (td == d) {
+                /// exp(i k h) should be equal to the fermionic sign of the translation
+                double sign = (_parity[h][u] ^ _parity[h][d]) ? -1.0 : 1.0;
+                compatible = std::abs(std::cos(phase(kx, ky, h)) - sign) < 1e-10;
+                ++stabilizer;
+              }
+            }
+            if (compatible) {
+              _states.push_back(((long long) (u) << _Ns) | d);
+              _stabilizer.push_back(stabilizer);
+            }
+          }
+        }
+        _nrep = int(_states.size());
+        if (size_t(_real ? _nrep : 2 * _nrep) != _current_sector.size()) {
+          std::stringstream s;
+          s << "Number of momentum states " << _nrep << " does not match the dimension of the sector" << _current_sector << ".";
+          throw std::logic_error(s.str().c_str());
+        }
+        _table_sector = _current_sector;
+      }
+    };
+  }
+}
+
+#endif //HUBBARD_TRANSLATIONSYMMETRY_H
@@ -0,0 +1,52 @@
+#ifndef HUBBARD_UNINITIALIZEDALLOCATOR_H
+#define HUBBARD_UNINITIALIZEDALLOCATOR_H
+
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace EDLib {
+  namespace Storage {
+
+    /**
+     * @brief Allocator that leaves default-inserted elements uninitialized
+     *
+     * std::vector value-initializes its elements when resized, so all memory pages are touched by the calling thread.
+     * On NUMA systems a page is placed on the memory node of the thread that touches it first, so large arrays should
+     * be written for the first time by the same threads that will use them later. With this allocator the first
+     * write is done by the owner thread during the matrix construction.
+     *
+     * @tparam T - type of the array element
+     */
+    template<typename T>
+    class UninitializedAllocator : public std::allocator < T > {
+    public:
+      template<typename U>
+      struct rebind {
+        typedef UninitializedAllocator < U > other;
+      };
+
+      UninitializedAllocator() noexcept {}
+
+      template<typename U>
+      UninitializedAllocator(const UninitializedAllocator < U > &) noexcept {}
+
+      /**
+       * Default-insert element without initialization
+       */
+      template<typename U>
+      void construct(U *p) noexcept(std::is_nothrow_default_constructible < U >::value) {
+        ::new(static_cast<void *>(p)) U;
+      }
+
+      template<typename U, typename... Args>
+      void construct(U *p, Args &&... args) {
+        ::new(static_cast<void *>(p)) U(std::forward < Args >(args)...);
+      }
+    };
+
+  }
+}
+
+#endif //HUBBARD_UNINITIALIZEDALLOCATOR_H
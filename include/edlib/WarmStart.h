@@ -0,0 +1,175 @@
+#ifndef HUBBARD_WARMSTART_H
+#define HUBBARD_WARMSTART_H
+
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <alps/hdf5/archive.hpp>
+#include <alps/hdf5/vector.hpp>
+
+namespace EDLib {
+
+  /**
+   * @brief Data of the previous diagonalization that is used to speed up the next one
+   *
+   * In the self-consistency loop the Hamiltonian changes only slightly from one iteration to the next. For each symmetry
+   * sector the lowest eigen-pair of the previous diagonalization is kept and its eigen-vector is used as the starting
+   * vector of the eigensolver, together with the list of the sectors that survived the pruning. In memory each CPU keeps
+   * the local part of the vector in the layout of the storage, so the data can be transferred only between Hamiltonians
+   * with the same storage and communicator. The hdf5 archive keeps complete vectors. Sectors are identified by their
+   * printed representation, so the data can be saved independently of the symmetry.
+   *
+   * @tparam prec - floating point precision
+   */
+  template<typename prec>
+  class WarmStart {
+  public:
+
+    /**
+     * @return true if there is no data of the previous diagonalization
+     */
+    bool empty() const {
+      return _vectors.empty() && _sectors.empty();
+    }
+
+    /**
+     * Forget the data of the previous diagonalization
+     */
+    void clear() {
+      _vectors.clear();
+      _eigenvalues.clear();
+      _sectors.clear();
+    }
+
+    /**
+     * @param sector - symmetry sector
+     * @return lowest eigen-vector of the sector from the previous diagonalization, nullptr if there is none
+     */
+    template<class Sector>
+    const std::vector < prec > *vector(const Sector &sector) const {
+      typename std::map < std::string, std::vector < prec > >::const_iterator it = _vectors.find(key(sector));
+      if (it == _vectors.end()) {
+        return nullptr;
+      }
+      return &it->second;
+    }
+
+    /**
+     * @param sector - symmetry sector with the stored eigen-vector
+     * @return lowest eigenvalue of the sector from the previous diagonalization
+     */
+    template<class Sector>
+    prec eigenvalue(const Sector &sector) const {
+      return _eigenvalues.at(key(sector));
+    }
+
+    /**
+     * Store the lowest eigen-pair of the sector
+     */
+    template<class Sector>
+    void vector(const Sector &sector, const std::vector < prec > &vec, prec eigenvalue) {
+      _vectors[key(sector)] = vec;
+      _eigenvalues[key(sector)] = eigenvalue;
+    }
+
+    /**
+     * Store the list of the sectors that have been selected for the diagonalization
+     */
+    template<class Sector>
+    void sectors(const std::vector < Sector > &sectors) {
+      _sectors.clear();
+      for (size_t is = 0; is < sectors.size(); ++is) {
+        _sectors.insert(key(sectors[is]));
+      }
+    }
+
+    /**
+     * @return true if the sector has been selected in the previous diagonalization
+     */
+    template<class Sector>
+    bool selected(const Sector &sector) const {
+      return _sectors.count(key(sector)) != 0;
+    }
+
+    /**
+     * @param sectors - candidate sectors
+     * @return candidate sectors that have been selected in the previous diagonalization, empty if nothing is stored
+     */
+    template<class Sector>
+    std::vector < Sector > select(const std::vector < Sector > &sectors) const {
+      std::vector < Sector > result;
+      for (size_t is = 0; is < sectors.size(); ++is) {
+        if (selected(sectors[is])) {
+          result.push_back(sectors[is]);
+        }
+      }
+      return result;
+    }
+
+    /**
+     * Save the data in the hdf5 archive, the vectors have to be complete
+     *
+     * @param ar - hdf5 archive
+     * @param path - root path in the archive
+     */
+    void save(alps::hdf5::archive &ar, const std::string &path) const {
+      ar[path + "/sectors/N"] << int(_sectors.size());
+      int i = 0;
+      for (std::set < std::string >::const_iterator it = _sectors.begin(); it != _sectors.end(); ++it, ++i) {
+        ar[path + "/sectors/" + std::to_string(i)] << *it;
+      }
+      ar[path + "/vectors/N"] << int(_vectors.size());
+      i = 0;
+      for (typename std::map < std::string, std::vector < prec > >::const_iterator it = _vectors.begin(); it != _vectors.end(); ++it, ++i) {
+        ar[path + "/vectors/" + std::to_string(i) + "/sector"] << it->first;
+        ar[path + "/vectors/" + std::to_string(i) + "/data"] << it->second;
+        ar[path + "/vectors/" + std::to_string(i) + "/eigenvalue"] << _eigenvalues.at(it->first);
+      }
+    }
+
+    /**
+     * Load the data from the hdf5 archive
+     *
+     * @param ar - hdf5 archive
+     * @param path - root path in the archive
+     */
+    void load(alps::hdf5::archive &ar, const std::string &path) {
+      clear();
+      int N;
+      ar[path + "/sectors/N"] >> N;
+      for (int i = 0; i < N; ++i) {
+        std::string name;
+        ar[path + "/sectors/" + std::to_string(i)] >> name;
+        _sectors.insert(name);
+      }
+      ar[path + "/vectors/N"] >> N;
+      for (int i = 0; i < N; ++i) {
+        std::string name;
+        ar[path + "/vectors/" + std::to_string(i) + "/sector"] >> name;
+        ar[path + "/vectors/" + std::to_string(i) + "/data"] >> _vectors[name];
+        ar[path + "/vectors/" + std::to_string(i) + "/eigenvalue"] >> _eigenvalues[name];
+      }
+    }
+
+  private:
+    /// lowest eigen-vector of each sector
+    std::map < std::string, std::vector < prec > > _vectors;
+    /// lowest eigenvalue of each sector
+    std::map < std::string, prec > _eigenvalues;
+    /// sectors selected for the diagonalization
+    std::set < std::string > _sectors;
+
+    template<class Sector>
+    static std::string key(const Sector &sector) {
+      std::ostringstream name;
+      name << sector;
+      return name.str();
+    }
+  };
+
+}
+
+#endif //HUBBARD_WARMSTART_H
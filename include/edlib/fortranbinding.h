@@ -6,37 +6,50 @@
 #define HUBBARD_FORTRANBINDING_H
 
 
+#include <cstdint>
 #include <vector>
 #include <alps/config.hpp>
 
+/**
+ * Fortran integer type of the ARPACK and LAPACK routines. Define ARPACK_ILP64 to use the libraries built with
+ * 64-bit integers (e.g. arpack-ng configured with INTERFACE64), which is required for the local vector sizes
+ * beyond 2^31.
+ */
+#ifdef ARPACK_ILP64
+typedef int64_t fortran_int;
+#else
+typedef int fortran_int;
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 // TODO: add headers for double complex
-void dseupd_(int *rvec, char *All, int *select, double *d, double *z, int *ldz, double *sigma, char *bmat,
-        int *n, char *which, int *nev, double *tol, double *resid, int *ncv, double *v, int *ldv,
-        int *iparam, int *ipntr, double *workd, double *workl, int *lworkl, int *ierr);
-void dsaupd_(int *ido, char *bmat, int *n, char *which, int *nev, double *tol, double *resid, int *ncv,
-        double *v, int *ldv, int *iparam, int *ipntr, double *workd, double *workl, int *lworkl, int *info);
-void sseupd_(int *rvec, char *All, int *select, float *d, float *z, int *ldz, float *sigma, char *bmat,
-        int *n, char *which, int *nev, float *tol, float *resid, int *ncv, float *v, int *ldv,
-        int *iparam, int *ipntr, float *workd, float *workl, int *lworkl, int *ierr);
-void ssaupd_(int *ido, char *bmat, int *n, char *which, int *nev, float *tol, float *resid, int *ncv,
-        float *v, int *ldv, int *iparam, int *ipntr, float *workd, float *workl, int *lworkl, int *info);
-void dmout(int* lout, int *m, int*n, double*A, int*lda, int* idigit,char* ifmt);
-void smout(int* lout, int *m, int*n, float*A, int*lda, int* idigit,char* ifmt);
+void dseupd_(fortran_int *rvec, char *All, fortran_int *select, double *d, double *z, fortran_int *ldz, double *sigma, char *bmat,
+        fortran_int *n, char *which, fortran_int *nev, double *tol, double *resid, fortran_int *ncv, double *v, fortran_int *ldv,
+        fortran_int *iparam, fortran_int *ipntr, double *workd, double *workl, fortran_int *lworkl, fortran_int *ierr);
+void dsaupd_(fortran_int *ido, char *bmat, fortran_int *n, char *which, fortran_int *nev, double *tol, double *resid, fortran_int *ncv,
+        double *v, fortran_int *ldv, fortran_int *iparam, fortran_int *ipntr, double *workd, double *workl, fortran_int *lworkl, fortran_int *info);
+void sseupd_(fortran_int *rvec, char *All, fortran_int *select, float *d, float *z, fortran_int *ldz, float *sigma, char *bmat,
+        fortran_int *n, char *which, fortran_int *nev, float *tol, float *resid, fortran_int *ncv, float *v, fortran_int *ldv,
+        fortran_int *iparam, fortran_int *ipntr, float *workd, float *workl, fortran_int *lworkl, fortran_int *ierr);
+void ssaupd_(fortran_int *ido, char *bmat, fortran_int *n, char *which, fortran_int *nev, float *tol, float *resid, fortran_int *ncv,
+        float *v, fortran_int *ldv, fortran_int *iparam, fortran_int *ipntr, float *workd, float *workl, fortran_int *lworkl, fortran_int *info);
+void dstev_(char *jobz, fortran_int *n, double *d, double *e, double *z, fortran_int *ldz, double *work, fortran_int *info);
+void dmout(fortran_int *lout, fortran_int *m, fortran_int *n, double *A, fortran_int *lda, fortran_int *idigit, char *ifmt);
+void smout(fortran_int *lout, fortran_int *m, fortran_int *n, float *A, fortran_int *lda, fortran_int *idigit, char *ifmt);
 #ifdef USE_MPI
-void pdseupd_(int *comm, int *rvec, char *All, int *select, double *d, double *z, int *ldz, double *sigma, char *bmat,
-             int *n, char *which, int *nev, double *tol, double *resid, int *ncv, double *v, int *ldv,
-             int *iparam, int *ipntr, double *workd, double *workl, int *lworkl, int *ierr);
-void pdsaupd_(int *comm, int *ido, char *bmat, int *n, char *which, int *nev, double *tol, double *resid, int *ncv,
-             double *v, int *ldv, int *iparam, int *ipntr, double *workd, double *workl, int *lworkl, int *info);
-void psseupd_(int *comm, int *rvec, char *All, int *select, float *d, float *z, int *ldz, float *sigma, char *bmat,
-             int *n, char *which, int *nev, float *tol, float *resid, int *ncv, float *v, int *ldv,
-             int *iparam, int *ipntr, float *workd, float *workl, int *lworkl, int *ierr);
-void pssaupd_(int *comm, int *ido, char *bmat, int *n, char *which, int *nev, float *tol, float *resid, int *ncv,
-             float *v, int *ldv, int *iparam, int *ipntr, float *workd, float *workl, int *lworkl, int *info);
-void pdmout(int* comm, int* lout, int *m, int*n, double*A, int*lda, int* idigit,char* ifmt);
-void psmout(int* comm, int* lout, int *m, int*n, float*A, int*lda, int* idigit,char* ifmt);
+void pdseupd_(fortran_int *comm, fortran_int *rvec, char *All, fortran_int *select, double *d, double *z, fortran_int *ldz, double *sigma, char *bmat,
+             fortran_int *n, char *which, fortran_int *nev, double *tol, double *resid, fortran_int *ncv, double *v, fortran_int *ldv,
+             fortran_int *iparam, fortran_int *ipntr, double *workd, double *workl, fortran_int *lworkl, fortran_int *ierr);
+void pdsaupd_(fortran_int *comm, fortran_int *ido, char *bmat, fortran_int *n, char *which, fortran_int *nev, double *tol, double *resid, fortran_int *ncv,
+             double *v, fortran_int *ldv, fortran_int *iparam, fortran_int *ipntr, double *workd, double *workl, fortran_int *lworkl, fortran_int *info);
+void psseupd_(fortran_int *comm, fortran_int *rvec, char *All, fortran_int *select, float *d, float *z, fortran_int *ldz, float *sigma, char *bmat,
+             fortran_int *n, char *which, fortran_int *nev, float *tol, float *resid, fortran_int *ncv, float *v, fortran_int *ldv,
+             fortran_int *iparam, fortran_int *ipntr, float *workd, float *workl, fortran_int *lworkl, fortran_int *ierr);
+void pssaupd_(fortran_int *comm, fortran_int *ido, char *bmat, fortran_int *n, char *which, fortran_int *nev, float *tol, float *resid, fortran_int *ncv,
+             float *v, fortran_int *ldv, fortran_int *iparam, fortran_int *ipntr, float *workd, float *workl, fortran_int *lworkl, fortran_int *info);
+void pdmout(fortran_int *comm, fortran_int *lout, fortran_int *m, fortran_int *n, double *A, fortran_int *lda, fortran_int *idigit, char *ifmt);
+void psmout(fortran_int *comm, fortran_int *lout, fortran_int *m, fortran_int *n, float *A, fortran_int *lda, fortran_int *idigit, char *ifmt);
 #endif
 };
 #endif
@@ -20,7 +20,9 @@ int main(int argc, const char ** argv) {
   typedef EDLib::SOCSRHubbardHamiltonian HamType;
 #endif
 #ifdef USE_MPI
-  MPI_Init(&argc, (char ***) &argv);
+  int provided;
+  /// MPI calls are performed outside of OpenMP parallel regions only
+  MPI_Init_thread(&argc, (char ***) &argv, MPI_THREAD_FUNNELED, &provided);
 #endif
   alps::params params(argc, argv);
   if(params.help_requested(std::cout)) {
@@ -0,0 +1,123 @@
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <map>
+#include <random>
+#include "edlib/BlockDavidson.h"
+
+/// diagonally dominant matrix A_ii = i, A_i,i+-1 = 0.5, A_i,i+-2 = 0.1
+void banded(const double *V, double *W, size_t n, int k) {
+  const double offset[3] = {0.0, 0.5, 0.1};
+  for (size_t i = 0; i < n; ++i) {
+    for (int j = 0; j < k; ++j) {
+      double w = double(i) * V[i * k + j];
+      for (int d = 1; d <= 2; ++d) {
+        if (i >= size_t(d)) w += offset[d] * V[(i - d) * k + j];
+        if (i + d < n) w += offset[d] * V[(i + d) * k + j];
+      }
+      W[i * k + j] = w;
+    }
+  }
+}
+
+TEST(BlockDavidsonTest, Banded) {
+  size_t n = 1000;
+  int nev = 4;
+  std::vector < double > diagonal(n);
+  for (size_t i = 0; i < n; ++i) {
+    diagonal[i] = double(i);
+  }
+  EDLib::Storage::BlockDavidson < double > davidson(n, n, nev, 12, 1e-12, 100);
+  std::vector < double > evals;
+  std::vector < std::vector < double > > evecs;
+  int info = davidson.solve(banded, [](double *, int) {}, diagonal, std::vector < double >(), 1, evals, evecs, true);
+  ASSERT_EQ(info, 0);
+  ASSERT_EQ(int(evals.size()), nev);
+  std::vector < double > w(n);
+  for (int i = 0; i < nev; ++i) {
+    banded(evecs[i].data(), w.data(), n, 1);
+    double res = 0.0;
+    double nrm = 0.0;
+    for (size_t l = 0; l < n; ++l) {
+      res += (w[l] - evals[i] * evecs[i][l]) * (w[l] - evals[i] * evecs[i][l]);
+      nrm += evecs[i][l] * evecs[i][l];
+    }
+    ASSERT_NEAR(nrm, 1.0, 1e-10);
+    ASSERT_LT(std::sqrt(res), 1e-10);
+    if (i > 0) {
+      ASSERT_LT(evals[i - 1], evals[i]);
+    }
+  }
+  /// Gershgorin bound for the lowest eigenvalue
+  ASSERT_GT(evals[0], -0.6);
+}
+
+TEST(BlockDavidsonTest, DegenerateSpectrum) {
+  /// two identical decoupled copies of the banded matrix, each eigenvalue is doubly degenerate
+  size_t n = 300;
+  std::vector < double > diagonal(2 * n);
+  for (size_t i = 0; i < n; ++i) {
+    diagonal[i] = diagonal[i + n] = double(i);
+  }
+  EDLib::Storage::BlockDavidson < double > davidson(2 * n, 2 * n, 4, 12, 1e-12, 100);
+  std::vector < double > evals;
+  std::vector < std::vector < double > > evecs;
+  int info = davidson.solve([n](const double *V, double *W, size_t, int k) {
+    banded(V, W, n, k);
+    banded(V + n * k, W + n * k, n, k);
+  }, [](double *, int) {}, diagonal, std::vector < double >(), 1, evals, evecs, false);
+  ASSERT_EQ(info, 0);
+  ASSERT_NEAR(evals[0], evals[1], 1e-10);
+  ASSERT_NEAR(evals[2], evals[3], 1e-10);
+  ASSERT_GT(evals[2] - evals[1], 0.1);
+}
+
+TEST(BlockDavidsonTest, RandomSparse) {
+  /// the diagonal is of the order of the off-diagonal elements, so the preconditioner is poor and many restarts are needed
+  size_t n = 2000;
+  int nev = 4;
+  std::mt19937 gen(7);
+  std::uniform_real_distribution < double > value(-1.0, 1.0);
+  std::uniform_int_distribution < size_t > column(0, n - 1);
+  std::vector < std::map < size_t, double > > rows(n);
+  for (size_t i = 0; i < n; ++i) {
+    rows[i][i] += value(gen) + 1.0;
+    for (int k = 0; k < 5; ++k) {
+      size_t j = column(gen);
+      double x = value(gen);
+      rows[i][j] += x;
+      rows[j][i] += x;
+    }
+  }
+  std::vector < double > diagonal(n);
+  for (size_t i = 0; i < n; ++i) {
+    diagonal[i] = rows[i][i];
+  }
+  auto op = [&rows](const double *V, double *W, size_t n, int k) {
+    for (size_t i = 0; i < n; ++i) {
+      for (int j = 0; j < k; ++j) {
+        double w = 0.0;
+        for (auto &element : rows[i]) {
+          w += element.second * V[element.first * k + j];
+        }
+        W[i * k + j] = w;
+      }
+    }
+  };
+  EDLib::Storage::BlockDavidson < double > davidson(n, n, nev, 24, 1e-14, 1000);
+  std::vector < double > evals;
+  std::vector < std::vector < double > > evecs;
+  int info = davidson.solve(op, [](double *, int) {}, diagonal, std::vector < double >(), 1, evals, evecs, true);
+  ASSERT_EQ(info, 0);
+  ASSERT_LT(davidson.restarts(), 200);
+  /// the residuals are verified with the products computed anew, so they reach the round-off of the products
+  std::vector < double > w(n);
+  for (int i = 0; i < nev; ++i) {
+    op(evecs[i].data(), w.data(), n, 1);
+    double res = 0.0;
+    for (size_t l = 0; l < n; ++l) {
+      res += (w[l] - evals[i] * evecs[i][l]) * (w[l] - evals[i] * evecs[i][l]);
+    }
+    ASSERT_LT(std::sqrt(res), 1e-12);
+  }
+}
@@ -3,6 +3,9 @@
 //
 
 #include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+#include <vector>
 #include "edlib/Hamiltonian.h"
 #include "edlib/HubbardModel.h"
 #include "edlib/Storage.h"
@@ -32,6 +35,61 @@ class HubbardModelTestEnv : public ::testing::Environment {
 #endif
 
 
+/**
+ * Write the input of the 4-site ring without the magnetic field, this model is SU(2) and particle-hole symmetric.
+ *
+ * @param name - name of the input file
+ * @param sectors - (nup, ndown) sectors for arpack.SECTOR, none if empty
+ * @return name of the input file
+ */
+std::string symmetric_ring_input(const std::string &name = "4ring_symmetric.h5", const std::vector < std::vector < int > > &sectors = {}) {
+#ifdef USE_MPI
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  if (rank == 0) {
+#endif
+    std::vector < std::vector < double > > t(4, std::vector < double >(4, 0.0));
+    for (int i = 0; i < 4; ++i) {
+      t[i][(i + 1) % 4] = t[(i + 1) % 4][i] = -1.0;
+    }
+    alps::hdf5::archive ar(name, "w");
+    ar["BETA"] << 10.0;
+    ar["hopping/values"] << t;
+    ar["interaction/values"] << std::vector < double >(4, 5.0);
+    ar["chemical_potential/values"] << std::vector < double >(4, 2.5);
+    if (!sectors.empty()) {
+      ar["sectors/values"] << sectors;
+    }
+    ar.close();
+#ifdef USE_MPI
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+#endif
+  return name;
+}
+
+/**
+ * @return norm of H v - E v for the eigen-pair, the storage is filled for the sector of the pair
+ */
+template<typename HamType, typename Pair>
+double residual(HamType &ham, const Pair &pair) {
+  ham.model().symmetry().set_sector(pair.sector());
+  ham.fill();
+  std::vector < double > v(pair.eigenvector());
+  std::vector < double > w(v.size(), 0.0);
+  /// CPUs without data in small sectors are not part of the working communicator
+  if (!v.empty()) {
+    ham.storage().prepare_work_arrays(v.data());
+    ham.storage().av(v.data(), w.data(), v.size());
+  }
+  ham.storage().finalize(0, false);
+  double res = 0.0;
+  for (size_t i = 0; i < v.size(); ++i) {
+    res += (w[i] - pair.eigenvalue() * v[i]) * (w[i] - pair.eigenvalue() * v[i]);
+  }
+  return std::sqrt(res);
+}
+
 TEST(HubbardModelTest, ReferenceTest) {
   alps::params p;
   EDLib::define_parameters(p);
@@ -67,3 +125,544 @@ TEST(HubbardModelTest, ReferenceTest) {
     std::cout<<ham.model().symmetry().sector().size()<<std::endl;
   }
 }
+
+TEST(HubbardModelTest, TargetSpin) {
+  alps::params p;
+  EDLib::define_parameters(p);
+  p["NSITES"]=4;
+  p["NSPINS"]=2;
+  p["INPUT_FILE"]=symmetric_ring_input();
+  p["arpack.SECTOR"]=false;
+  p["storage.MAX_SIZE"]=576;
+  p["storage.MAX_DIM"]=36;
+  p["storage.EIGENVALUES_ONLY"]=false;
+  p["storage.ORBITAL_NUMBER"]=1;
+  p["arpack.NEV"]=2;
+  p["arpack.TARGET_S"]=0.0;
+
+  /// total spin projection needs complete vectors
+  typedef EDLib::CSRHubbardHamiltonian HamType;
+  HamType ham(p
+#ifdef USE_MPI
+  , MPI_COMM_WORLD
+#endif
+  );
+
+  ham.diag();
+
+  ASSERT_NEAR(ham.eigenpairs().begin()->eigenvalue(), -11.8443, 1e-4);
+  EDLib::Symmetry::TotalSpin spin(4);
+  for (auto pair = ham.eigenpairs().begin(); pair != ham.eigenpairs().end(); ++pair) {
+    ASSERT_EQ(pair->sector().nup(), pair->sector().ndown());
+    ASSERT_NEAR(spin.expectation(ham.model().symmetry(), pair->sector(), pair->eigenvector()), 0.0, 1e-6);
+  }
+}
+
+TEST(HubbardModelTest, TargetSpinEigenvaluesOnly) {
+  alps::params p;
+  EDLib::define_parameters(p);
+  p["NSITES"]=4;
+  p["NSPINS"]=2;
+  p["INPUT_FILE"]=symmetric_ring_input("4ring_half_filled.h5", {{2, 2}});
+  p["arpack.SECTOR"]=true;
+  p["storage.MAX_SIZE"]=576;
+  p["storage.MAX_DIM"]=36;
+  p["storage.ORBITAL_NUMBER"]=1;
+  p["storage.EIGENSOLVER"]="LANCZOS";
+  p["arpack.NEV"]=6;
+  p["arpack.TARGET_S"]=0.0;
+  /// without the penalty the Lanczos method finds the triplets, only the spin check removes them
+  p["arpack.SPIN_PENALTY"]=0.0;
+
+  typedef EDLib::CSRHubbardHamiltonian HamType;
+  p["storage.EIGENVALUES_ONLY"]=false;
+  HamType ham(p
+#ifdef USE_MPI
+  , MPI_COMM_WORLD
+#endif
+  );
+  ham.diag();
+  /// the total spin is checked with the eigen-vectors, so the states with S > 0 are dropped in both cases
+  p["storage.EIGENVALUES_ONLY"]=true;
+  HamType evals(p
+#ifdef USE_MPI
+  , MPI_COMM_WORLD
+#endif
+  );
+  evals.diag();
+
+  ASSERT_EQ(evals.eigenpairs().size(), ham.eigenpairs().size());
+  auto pair = ham.eigenpairs().begin();
+  for (auto e_pair = evals.eigenpairs().begin(); e_pair != evals.eigenpairs().end(); ++e_pair, ++pair) {
+    ASSERT_NEAR(e_pair->eigenvalue(), pair->eigenvalue(), 1e-8);
+  }
+}
+
+TEST(HubbardModelTest, TargetSpinMultiplets) {
+  alps::params p;
+  EDLib::define_parameters(p);
+  p["NSITES"]=4;
+  p["NSPINS"]=2;
+  p["INPUT_FILE"]=symmetric_ring_input();
+  p["arpack.SECTOR"]=false;
+  p["storage.MAX_SIZE"]=576;
+  p["storage.MAX_DIM"]=36;
+  p["storage.EIGENVALUES_ONLY"]=false;
+  p["storage.ORBITAL_NUMBER"]=1;
+  p["storage.EIGENSOLVER"]="LANCZOS";
+  p["arpack.NEV"]=2;
+
+  typedef EDLib::CSRHubbardHamiltonian HamType;
+  EDLib::Symmetry::TotalSpin spin(4);
+  for (double S : {0.5, 1.0}) {
+    p["arpack.TARGET_S"]=S;
+    HamType ham(p
+#ifdef USE_MPI
+    , MPI_COMM_WORLD
+#endif
+    );
+    ham.diag();
+    int twice_s = int(2 * S);
+    std::vector < std::pair < double, int > > lowest;
+    for (auto pair = ham.eigenpairs().begin(); pair != ham.eigenpairs().end(); ++pair) {
+      if (pair->sector().ndown() - pair->sector().nup() == twice_s) {
+        lowest.push_back(std::make_pair(pair->eigenvalue(), pair->sector().nup() + pair->sector().ndown()));
+      }
+    }
+    /// each computed state is accompanied by the 2S other members of its multiplet
+    ASSERT_FALSE(lowest.empty());
+    ASSERT_EQ(ham.eigenpairs().size(), lowest.size() * (twice_s + 1));
+    for (auto pair = ham.eigenpairs().begin(); pair != ham.eigenpairs().end(); ++pair) {
+      int n = pair->sector().nup() + pair->sector().ndown();
+      ASSERT_LE(std::abs(pair->sector().ndown() - pair->sector().nup()), twice_s);
+      ASSERT_NEAR(spin.expectation(ham.model().symmetry(), pair->sector(), pair->eigenvector()), S * (S + 1), 1e-6);
+      ASSERT_LT(residual(ham, *pair), 1e-6);
+      int copies = 0;
+      for (size_t i = 0; i < lowest.size(); ++i) {
+        copies += (lowest[i].second == n && std::abs(lowest[i].first - pair->eigenvalue()) < 1e-8) ? 1 : 0;
+      }
+      ASSERT_GE(copies, 1);
+    }
+  }
+}
+
+TEST(HubbardModelTest, TargetSpinDavidson) {
+  alps::params p;
+  EDLib::define_parameters(p);
+  p["NSITES"]=4;
+  p["NSPINS"]=2;
+  p["INPUT_FILE"]=symmetric_ring_input("4ring_half_filled.h5", {{2, 2}});
+  p["arpack.SECTOR"]=true;
+  p["storage.MAX_SIZE"]=576;
+  p["storage.MAX_DIM"]=36;
+  p["storage.EIGENVALUES_ONLY"]=false;
+  p["storage.ORBITAL_NUMBER"]=1;
+  p["arpack.NEV"]=6;
+  p["arpack.TARGET_S"]=0.0;
+
+  typedef EDLib::CSRHubbardHamiltonian HamType;
+  p["storage.EIGENSOLVER"]="LANCZOS";
+  HamType lanczos(p
+#ifdef USE_MPI
+  , MPI_COMM_WORLD
+#endif
+  );
+  lanczos.diag();
+  /// the Davidson corrections have to be projected onto the singlets, otherwise the triplets take their place
+  p["storage.EIGENSOLVER"]="DAVIDSON";
+  HamType davidson(p
+#ifdef USE_MPI
+  , MPI_COMM_WORLD
+#endif
+  );
+  davidson.diag();
+
+  ASSERT_EQ(davidson.eigenpairs().size(), 6);
+  ASSERT_NEAR(davidson.eigenpairs().begin()->eigenvalue(), lanczos.eigenpairs().begin()->eigenvalue(), 1e-8);
+  /// the singlet level -7 is doubly degenerate, the single-vector Lanczos method finds it once
+  EDLib::Symmetry::TotalSpin spin(4);
+  for (auto d_pair = davidson.eigenpairs().begin(); d_pair != davidson.eigenpairs().end(); ++d_pair) {
+    ASSERT_NEAR(spin.expectation(davidson.model().symmetry(), d_pair->sector(), d_pair->eigenvector()), 0.0, 1e-6);
+    bool found = false;
+    for (auto pair = lanczos.eigenpairs().begin(); pair != lanczos.eigenpairs().end(); ++pair) {
+      found = found || std::abs(pair->eigenvalue() - d_pair->eigenvalue()) < 1e-8;
+    }
+    ASSERT_TRUE(found);
+  }
+}
+
+TEST(HubbardModelTest, TargetSpinParticleHole) {
+  alps::params p;
+  EDLib::define_parameters(p);
+  p["NSITES"]=4;
+  p["NSPINS"]=2;
+  p["INPUT_FILE"]=symmetric_ring_input();
+  p["arpack.SECTOR"]=false;
+  p["storage.MAX_SIZE"]=576;
+  p["storage.MAX_DIM"]=36;
+  p["storage.EIGENVALUES_ONLY"]=false;
+  p["storage.ORBITAL_NUMBER"]=1;
+  p["storage.EIGENSOLVER"]="DAVIDSON";
+  p["arpack.NEV"]=2;
+
+  typedef EDLib::CSRHubbardHamiltonian HamType;
+  for (double S : {0.5, 1.0}) {
+    p["arpack.TARGET_S"]=S;
+    p["arpack.PARTICLE_HOLE"]=0;
+    HamType ham(p
+#ifdef USE_MPI
+    , MPI_COMM_WORLD
+#endif
+    );
+    ham.diag();
+    p["arpack.PARTICLE_HOLE"]=1;
+    HamType ph(p
+#ifdef USE_MPI
+    , MPI_COMM_WORLD
+#endif
+    );
+    ph.diag();
+    /// the partners of the Sz = -S sectors have Sz = S, so all the multiplets have to be found in both cases
+    ASSERT_EQ(ph.eigenpairs().size(), ham.eigenpairs().size());
+    auto pair = ham.eigenpairs().begin();
+    for (auto ph_pair = ph.eigenpairs().begin(); ph_pair != ph.eigenpairs().end(); ++ph_pair, ++pair) {
+      ASSERT_NEAR(ph_pair->eigenvalue(), pair->eigenvalue(), 1e-8);
+      ASSERT_LE(std::abs(ph_pair->sector().ndown() - ph_pair->sector().nup()), int(2 * S));
+    }
+  }
+}
+
+TEST(HubbardModelTest, WarmStart) {
+  alps::params p;
+  EDLib::define_parameters(p);
+  p["NSITES"]=4;
+  p["NSPINS"]=2;
+  /// only the half-filled sector is diagonalized, so the storage reports its number of matrix-vector products
+  p["INPUT_FILE"]=symmetric_ring_input("4ring_half_filled.h5", {{2, 2}});
+  p["arpack.SECTOR"]=true;
+  p["storage.MAX_SIZE"]=576;
+  p["storage.MAX_DIM"]=36;
+  p["storage.EIGENVALUES_ONLY"]=false;
+  p["storage.ORBITAL_NUMBER"]=1;
+  p["storage.EIGENSOLVER"]="DAVIDSON";
+  p["arpack.NEV"]=1;
+  p["arpack.WARM_START"]=1;
+
+#ifdef USE_MPI
+  typedef EDLib::SRSHubbardHamiltonian HamType;
+#else
+  typedef EDLib::CSRHubbardHamiltonian HamType;
+#endif
+  HamType ham(p
+#ifdef USE_MPI
+  , MPI_COMM_WORLD
+#endif
+  );
+  ham.diag();
+  ASSERT_FALSE(ham.warm_start().empty());
+  EDLib::Symmetry::SzSymmetry::Sector sector(2, 2, 36);
+  ASSERT_NE(ham.warm_start().vector(sector), nullptr);
+  ASSERT_EQ(ham.warm_start().vector(sector)->size(), ham.storage().vector_size(sector));
+
+  HamType next(p
+#ifdef USE_MPI
+  , MPI_COMM_WORLD
+#endif
+  );
+  next.warm_start() = ham.warm_start();
+  next.diag();
+  ASSERT_NEAR(next.eigenpairs().begin()->eigenvalue(), ham.eigenpairs().begin()->eigenvalue(), 1e-10);
+  ASSERT_EQ(next.eigenpairs().begin()->sector().nup(), 2);
+  ASSERT_EQ(next.eigenpairs().begin()->sector().ndown(), 2);
+  /// the eigensolver starts from the converged eigen-vector
+  ASSERT_LT(next.storage().matvecs(), ham.storage().matvecs());
+}
+
+TEST(HubbardModelTest, WarmStartFile) {
+  alps::params p;
+  EDLib::define_parameters(p);
+  p["NSITES"]=4;
+  p["NSPINS"]=2;
+  p["INPUT_FILE"]=symmetric_ring_input("4ring_half_filled.h5", {{2, 2}});
+  p["arpack.SECTOR"]=true;
+  p["storage.MAX_SIZE"]=576;
+  p["storage.MAX_DIM"]=36;
+  p["storage.EIGENVALUES_ONLY"]=false;
+  p["storage.ORBITAL_NUMBER"]=1;
+  p["storage.EIGENSOLVER"]="DAVIDSON";
+  p["arpack.NEV"]=1;
+  p["arpack.PRUNE_SECTORS"]=1;
+  p["arpack.WARM_START"]=1;
+  p["arpack.WARM_START_FILE"]="warm_start.h5";
+  int rank = 0;
+#ifdef USE_MPI
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+#endif
+  if (rank == 0) {
+    std::remove("warm_start.h5");
+  }
+#ifdef USE_MPI
+  MPI_Barrier(MPI_COMM_WORLD);
+  typedef EDLib::SRSHubbardHamiltonian HamType;
+#else
+  typedef EDLib::CSRHubbardHamiltonian HamType;
+#endif
+  HamType ham(p
+#ifdef USE_MPI
+  , MPI_COMM_WORLD
+#endif
+  );
+  ham.diag();
+  EDLib::Symmetry::SzSymmetry::Sector sector(2, 2, 36);
+  /// the file keeps the complete vector, the local part of the first CPU is at its beginning
+  if (rank == 0) {
+    const std::vector < double > &saved = *ham.warm_start().vector(sector);
+    EDLib::WarmStart < double > complete;
+    alps::hdf5::archive ar("warm_start.h5", "r");
+    complete.load(ar, "warm_start");
+    ar.close();
+    ASSERT_TRUE(complete.selected(sector));
+    ASSERT_NE(complete.vector(sector), nullptr);
+    ASSERT_EQ(complete.vector(sector)->size(), sector.size());
+    ASSERT_NEAR(complete.eigenvalue(sector), ham.eigenpairs().begin()->eigenvalue(), 1e-10);
+    for (size_t i = 0; i < saved.size(); ++i) {
+      ASSERT_EQ((*complete.vector(sector))[i], saved[i]);
+    }
+  }
+
+  /// the data is read from the file, each CPU starts from its local part of the vector
+  HamType next(p
+#ifdef USE_MPI
+  , MPI_COMM_WORLD
+#endif
+  );
+  next.diag();
+  ASSERT_NEAR(next.eigenpairs().begin()->eigenvalue(), ham.eigenpairs().begin()->eigenvalue(), 1e-10);
+  ASSERT_LT(next.storage().matvecs(), ham.storage().matvecs());
+}
+
+TEST(HubbardModelTest, SpinFlip) {
+  alps::params p;
+  EDLib::define_parameters(p);
+  p["NSITES"]=4;
+  p["NSPINS"]=2;
+  p["INPUT_FILE"]=symmetric_ring_input();
+  p["arpack.SECTOR"]=false;
+  p["storage.MAX_SIZE"]=576;
+  p["storage.MAX_DIM"]=36;
+  p["storage.EIGENVALUES_ONLY"]=false;
+  p["storage.ORBITAL_NUMBER"]=1;
+  p["storage.EIGENSOLVER"]="DAVIDSON";
+  p["arpack.NEV"]=2;
+
+#ifdef USE_MPI
+  typedef EDLib::SRSHubbardHamiltonian HamType;
+#else
+  typedef EDLib::SOCSRHubbardHamiltonian HamType;
+#endif
+  p["arpack.SPIN_FLIP"]=0;
+  HamType ham(p
+#ifdef USE_MPI
+  , MPI_COMM_WORLD
+#endif
+  );
+  ham.diag();
+  p["arpack.SPIN_FLIP"]=1;
+  HamType flip(p
+#ifdef USE_MPI
+  , MPI_COMM_WORLD
+#endif
+  );
+  flip.diag();
+
+  ASSERT_EQ(flip.eigenpairs().size(), ham.eigenpairs().size());
+  auto pair = ham.eigenpairs().begin();
+  for (auto f_pair = flip.eigenpairs().begin(); f_pair != flip.eigenpairs().end(); ++f_pair, ++pair) {
+    ASSERT_NEAR(f_pair->eigenvalue(), pair->eigenvalue(), 1e-8);
+  }
+  /// the eigen-vectors of the sectors with nup > ndown are obtained by the spin flip, they have to be eigen-vectors of their sectors
+  int mirrored = 0;
+  for (auto f_pair = flip.eigenpairs().begin(); f_pair != flip.eigenpairs().end(); ++f_pair) {
+    if (f_pair->sector().nup() > f_pair->sector().ndown()) {
+      ASSERT_LT(residual(flip, *f_pair), 1e-6);
+      ++mirrored;
+    }
+  }
+  ASSERT_GT(mirrored, 0);
+}
+
+TEST(HubbardModelTest, ParticleHole) {
+  alps::params p;
+  EDLib::define_parameters(p);
+  p["NSITES"]=4;
+  p["NSPINS"]=2;
+  p["INPUT_FILE"]=symmetric_ring_input();
+  p["arpack.SECTOR"]=false;
+  p["storage.MAX_SIZE"]=576;
+  p["storage.MAX_DIM"]=36;
+  p["storage.EIGENVALUES_ONLY"]=false;
+  p["storage.ORBITAL_NUMBER"]=1;
+  p["storage.EIGENSOLVER"]="DAVIDSON";
+  p["arpack.NEV"]=2;
+
+#ifdef USE_MPI
+  typedef EDLib::SRSHubbardHamiltonian HamType;
+#else
+  typedef EDLib::SOCSRHubbardHamiltonian HamType;
+#endif
+  p["arpack.PARTICLE_HOLE"]=0;
+  HamType ham(p
+#ifdef USE_MPI
+  , MPI_COMM_WORLD
+#endif
+  );
+  ham.diag();
+  p["arpack.PARTICLE_HOLE"]=1;
+  HamType ph(p
+#ifdef USE_MPI
+  , MPI_COMM_WORLD
+#endif
+  );
+  ph.diag();
+
+  ASSERT_EQ(ph.eigenpairs().size(), ham.eigenpairs().size());
+  auto pair = ham.eigenpairs().begin();
+  for (auto ph_pair = ph.eigenpairs().begin(); ph_pair != ph.eigenpairs().end(); ++ph_pair, ++pair) {
+    ASSERT_NEAR(ph_pair->eigenvalue(), pair->eigenvalue(), 1e-8);
+  }
+  /// the eigen-vectors above half filling are obtained by the particle-hole transformation, they have to be eigen-vectors of their sectors
+  int partners = 0;
+  for (auto ph_pair = ph.eigenpairs().begin(); ph_pair != ph.eigenpairs().end(); ++ph_pair) {
+    ASSERT_LT(residual(ph, *ph_pair), 1e-6);
+    if (ph_pair->sector().nup() + ph_pair->sector().ndown() > 4) {
+      ++partners;
+    }
+  }
+  ASSERT_GT(partners, 0);
+}
+
+TEST(HubbardModelTest, PruneSectors) {
+  alps::params p;
+  EDLib::define_parameters(p);
+  p["NSITES"]=4;
+  p["NSPINS"]=2;
+  p["INPUT_FILE"]="test/input/4ring/input.h5";
+  p["arpack.SECTOR"]=false;
+  p["storage.MAX_SIZE"]=576;
+  p["storage.MAX_DIM"]=36;
+  p["storage.EIGENVALUES_ONLY"]=false;
+  p["storage.ORBITAL_NUMBER"]=1;
+  p["storage.EIGENSOLVER"]="DAVIDSON";
+  p["arpack.NEV"]=2;
+  p["lanc.BETA"]=1.0;
+  p["lanc.BOLTZMANN_CUTOFF"]=1e-2;
+  double window = -std::log(1e-2);
+
+#ifdef USE_MPI
+  typedef EDLib::SRSHubbardHamiltonian HamType;
+#else
+  typedef EDLib::SOCSRHubbardHamiltonian HamType;
+#endif
+  HamType full(p
+#ifdef USE_MPI
+  , MPI_COMM_WORLD
+#endif
+  );
+  full.diag();
+  double emax = full.eigenpairs().begin()->eigenvalue() + window;
+  p["arpack.PRUNE_SECTORS"]=1;
+#ifdef USE_MPI
+  /// the estimates are distributed over the CPU groups in the second run
+  for (int groups = 1; groups <= 2; ++groups) {
+    p["storage.SECTOR_GROUPS"]=groups;
+#endif
+    HamType pruned(p
+#ifdef USE_MPI
+    , MPI_COMM_WORLD
+#endif
+    );
+    pruned.diag();
+    /// the sectors far above the ground state are skipped
+    ASSERT_LT(pruned.eigenpairs().size(), full.eigenpairs().size());
+    for (auto pair = full.eigenpairs().begin(); pair != full.eigenpairs().end() && pair->eigenvalue() <= emax; ++pair) {
+      bool found = false;
+      for (auto p_pair = pruned.eigenpairs().begin(); p_pair != pruned.eigenpairs().end(); ++p_pair) {
+        found = found || (p_pair->sector().nup() == pair->sector().nup() && p_pair->sector().ndown() == pair->sector().ndown() &&
+                          std::abs(p_pair->eigenvalue() - pair->eigenvalue()) < 1e-8);
+      }
+      ASSERT_TRUE(found);
+    }
+    for (auto p_pair = pruned.eigenpairs().begin(); p_pair != pruned.eigenpairs().end(); ++p_pair) {
+      ASSERT_LT(residual(pruned, *p_pair), 1e-6);
+    }
+#ifdef USE_MPI
+  }
+#endif
+}
+
+#ifdef USE_MPI
+TEST(HubbardModelTest, SectorGroups) {
+  alps::params p;
+  EDLib::define_parameters(p);
+  p["NSITES"]=4;
+  p["NSPINS"]=2;
+  p["INPUT_FILE"]="test/input/4ring/input.h5";
+  p["arpack.SECTOR"]=false;
+  p["storage.MAX_SIZE"]=576;
+  p["storage.MAX_DIM"]=36;
+  p["storage.EIGENVALUES_ONLY"]=false;
+  p["storage.ORBITAL_NUMBER"]=1;
+  p["storage.EIGENSOLVER"]="DAVIDSON";
+  p["arpack.NEV"]=2;
+
+  typedef EDLib::SRSHubbardHamiltonian HamType;
+  HamType sequential(p, MPI_COMM_WORLD);
+  sequential.diag();
+  /// the sectors with at least 10 states are diagonalized by the groups, the smaller ones by single CPUs
+  p["storage.SECTOR_GROUPS"]=2;
+  p["storage.SERIAL_SECTOR_DIM"]=10;
+  HamType groups(p, MPI_COMM_WORLD);
+  groups.diag();
+
+  ASSERT_EQ(groups.eigenpairs().size(), sequential.eigenpairs().size());
+  auto pair = sequential.eigenpairs().begin();
+  for (auto g_pair = groups.eigenpairs().begin(); g_pair != groups.eigenpairs().end(); ++g_pair, ++pair) {
+    ASSERT_NEAR(g_pair->eigenvalue(), pair->eigenvalue(), 1e-8);
+  }
+  /// the eigen-vectors are returned in the layout of the main storage
+  for (auto g_pair = groups.eigenpairs().begin(); g_pair != groups.eigenpairs().end(); ++g_pair) {
+    ASSERT_LT(residual(groups, *g_pair), 1e-6);
+  }
+}
+#endif
+
+TEST(HubbardModelTest, MixedPrecision) {
+  alps::params p;
+  EDLib::define_parameters(p);
+  p["NSITES"]=4;
+  p["NSPINS"]=2;
+  p["INPUT_FILE"]="test/input/4ring/input.h5";
+  p["arpack.SECTOR"]=false;
+  p["storage.MAX_SIZE"]=576;
+  p["storage.MAX_DIM"]=36;
+  p["storage.EIGENVALUES_ONLY"]=true;
+  p["storage.ORBITAL_NUMBER"]=1;
+  p["arpack.NEV"]=1;
+
+#ifdef USE_MPI
+  typedef EDLib::SRSHubbardHamiltonian_mixed HamType;
+#else
+  typedef EDLib::CSRHubbardHamiltonian_mixed HamType;
+#endif
+  HamType ham(p
+#ifdef USE_MPI
+  , MPI_COMM_WORLD
+#endif
+  );
+
+  ham.diag();
+
+  ASSERT_NEAR(ham.eigenpairs().begin()->eigenvalue(), -11.8443, 1e-4);
+  ASSERT_EQ(ham.eigenpairs().begin()->sector().nup(), 2);
+  ASSERT_EQ(ham.eigenpairs().begin()->sector().ndown(), 2);
+}
@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include "edlib/Hamiltonian.h"
+#include "edlib/HubbardModel.h"
+#include "edlib/CRSStorage.h"
+#include "edlib/MatrixFreeStorage.h"
+#include "edlib/EDParams.h"
+
+
+#ifdef USE_MPI
+
+class MatrixFreeStorageTestEnv : public ::testing::Environment {
+  protected:
+  virtual void SetUp() {
+    char** argv;
+    int argc = 0;
+    int mpiError = MPI_Init(&argc, &argv);
+  }
+
+  virtual void TearDown() {
+    MPI_Finalize();
+  }
+
+  ~MatrixFreeStorageTestEnv(){};
+
+};
+
+::testing::Environment* const foo_env = AddGlobalTestEnvironment(new MatrixFreeStorageTestEnv);
+
+#endif
+
+void init_params(alps::params &p) {
+  EDLib::define_parameters(p);
+  p["NSITES"]=4;
+  p["NSPINS"]=2;
+  p["INPUT_FILE"]="test/input/4ring/input.h5";
+  p["arpack.SECTOR"]=false;
+  p["storage.MAX_SIZE"]=576;
+  p["storage.MAX_DIM"]=36;
+  p["storage.EIGENVALUES_ONLY"]=true;
+  p["arpack.NEV"]=1;
+}
+
+TEST(MatrixFreeStorageTest, av) {
+  alps::params p;
+  init_params(p);
+  typedef EDLib::Model::HubbardModel<double> Model;
+  Model m(p);
+  Model m2(p);
+  // matrix is not distributed, each process holds the whole vector
+  EDLib::Storage::MatrixFreeStorage<Model> storage(p, m
+#ifdef USE_MPI
+  , MPI_COMM_SELF
+#endif
+  );
+  EDLib::Storage::CRSStorage<Model> storage2(p, m2
+#ifdef USE_MPI
+  , MPI_COMM_SELF
+#endif
+  );
+  while (m.symmetry().next_sector() && m2.symmetry().next_sector()) {
+    storage.fill();
+    storage2.fill();
+    size_t n = storage.vector_size(m.symmetry().sector());
+    std::vector<double> v(n), w(n, 0.0), w2(n, 0.0);
+    for(int i = 0; i < n; ++i) {
+      v[i] = 1.0 / (i + 1.0);
+    }
+    storage.av(v.data(), w.data(), n);
+    storage2.av(v.data(), w2.data(), n);
+    for(int i = 0; i < n; ++i) {
+      ASSERT_NEAR(w[i], w2[i], 1e-12);
+    }
+  }
+}
+
+TEST(MatrixFreeStorageTest, ReferenceTest) {
+  alps::params p;
+  init_params(p);
+  EDLib::MFHubbardHamiltonian ham(p
+#ifdef USE_MPI
+  , MPI_COMM_SELF
+#endif
+  );
+
+  ham.diag();
+
+  // [arXiv:cond-mat/0101476 [cond-mat.str-el]]
+  ASSERT_NEAR(ham.eigenpairs().begin()->eigenvalue(), -11.8443, 1e-4);
+  ASSERT_EQ(ham.eigenpairs().begin()->sector().nup(), 2);
+  ASSERT_EQ(ham.eigenpairs().begin()->sector().ndown(), 2);
+}
@@ -20,3 +20,16 @@ TEST(NSymmetryTest, Initialization) {
     }
   }
 }
+
+TEST(NSymmetryTest, IterativeIndex) {
+  int N = EDLib::Symmetry::NSymmetry::DIRECT_INDEX_BITS + 1;
+  EDLib::Symmetry::NSymmetry sym(N);
+  for (int n = 0; n <= 3; ++n) {
+    sym.set_sector(EDLib::Symmetry::NSymmetry::Sector(n, sym.comb().c_n_k(N, n)));
+    int i = 0;
+    while (sym.next_state()) {
+      ASSERT_EQ(i, sym.index(sym.state()));
+      ++i;
+    }
+  }
+}
@@ -75,16 +75,24 @@ TEST(SpinResolvedStorageTest, av) {
   p["storage.MAX_SIZE"] = 80000;
   p["storage.MAX_DIM"] = 4900;
   EDLib::Model::HubbardModel<double> m(p);
+  EDLib::Model::HubbardModel<double> m2(p);
   EDLib::Storage::SpinResolvedStorage<EDLib::Model::HubbardModel<double> > storage(p, m
 #ifdef USE_MPI
   , MPI_COMM_WORLD
+#endif
+  );
+  EDLib::Storage::CRSStorage<EDLib::Model::HubbardModel<double> > storage2(p, m2
+#ifdef USE_MPI
+  , MPI_COMM_WORLD
 #endif
   );
   typedef typename EDLib::Symmetry::SzSymmetry::Sector Stype;
   Stype s(4,4,4900);
   m.symmetry().set_sector(s);
   m.symmetry().init();
+  m2.symmetry().set_sector(s);
   storage.fill();
+  storage2.fill();
   size_t vs = storage.vector_size(s);
   std::cout<<"size:"<<vs<<std::endl;
   std::vector<double> v(storage.vector_size(s), 1.0);
@@ -92,45 +100,98 @@ TEST(SpinResolvedStorageTest, av) {
   storage.prepare_work_arrays(v.data());
   storage.av(v.data(), w.data(), vs);
   storage.finalize(0);
-  std::vector<double> vv(s.size());
-  std::ifstream ifile("v.dat");
-  for(int i = 0; i < s.size(); ++i)
-    ifile>>vv[i];
-  ifile.close();
-  int k =0;
+  /// reference product with the complete vector
+  std::vector<double> v2(s.size(), 1.0), w2(s.size(), 0.0);
+  storage2.av(v2.data(), w2.data(), s.size());
+  size_t offset = 0;
 #ifdef USE_MPI
-  int rank,size;
-  MPI_Comm_size(MPI_COMM_WORLD, &size);
-  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-  std::cout<<"RANK:"<<rank<<" of "<<size<<std::endl;
-  for(int np = 0; np<size; ++np) {
-  MPI_Barrier(MPI_COMM_WORLD);
-  if(np==rank) {
+  offset = storage.offset();
 #endif
-  std::ofstream ofile("w.dat", std::ios_base::app);
-  for(int i = 0; i<w.size();++i) {
-    ofile<<w[i]<<"\n";
+  for(size_t i = 0; i < vs; ++i) {
+    ASSERT_NEAR(w[i], w2[offset + i], 1e-12);
   }
-  ofile.close();
+}
+
+
+TEST(SpinResolvedStorageTest, avBlock) {
+  alps::params p;
+  EDLib::define_parameters(p);
+  p["NSITES"]=8;
+  p["storage.MAX_SIZE"] = 80000;
+  p["storage.MAX_DIM"] = 4900;
+  EDLib::Model::HubbardModel<double> m(p);
+  EDLib::Storage::SpinResolvedStorage<EDLib::Model::HubbardModel<double> > storage(p, m
 #ifdef USE_MPI
+  , MPI_COMM_WORLD
+#endif
+  );
+  typedef typename EDLib::Symmetry::SzSymmetry::Sector Stype;
+  Stype s(4,4,4900);
+  m.symmetry().set_sector(s);
+  m.symmetry().init();
+  storage.fill();
+  size_t vs = storage.vector_size(s);
+  int k = 3;
+  std::vector<double> V(vs * k), W(vs * k, 0.0);
+  for(size_t i = 0; i < V.size(); ++i) {
+    V[i] = std::sin(0.37 * i + 1.0);
   }
+  std::vector<double> v(vs), w(vs, 0.0);
+  storage.prepare_work_arrays(v.data());
+  storage.av_block(V.data(), W.data(), vs, k);
+  for(int j = 0; j < k; ++j) {
+    for(size_t i = 0; i < vs; ++i) {
+      v[i] = V[i * k + j];
+    }
+    storage.av(v.data(), w.data(), vs);
+    for(size_t i = 0; i < vs; ++i) {
+      ASSERT_NEAR(w[i], W[i * k + j], 1e-12);
+    }
   }
-  MPI_Barrier(MPI_COMM_WORLD);
-  if(rank==0) {
+  storage.finalize(0, false);
+}
+
+TEST(SpinResolvedStorageTest, avSplitDown) {
+  alps::params p;
+  EDLib::define_parameters(p);
+  p["NSITES"]=8;
+  p["storage.MAX_SIZE"] = 80000;
+  p["storage.MAX_DIM"] = 4900;
+  EDLib::Model::HubbardModel<double> m(p);
+  EDLib::Model::HubbardModel<double> m2(p);
+  EDLib::Storage::SpinResolvedStorage<EDLib::Model::HubbardModel<double> > storage(p, m
+#ifdef USE_MPI
+  , MPI_COMM_WORLD
 #endif
-  std::vector<double> ww(s.size());
-  std::ifstream ifilew("w.dat");
-  std::cout<<s.size()<<"\n";
-  for(int i = 0; i < s.size(); ++i)
-    ifilew>>ww[i];
-  ifilew.close();
-  std::remove("w.dat");
-  for(int i = 0; i<ww.size();++i) {
-    std::cout<<i<<" "<<vv[i]<<" "<<ww[i]<<"\n";
-    ASSERT_EQ(vv[i], ww[i]);
+  );
+  EDLib::Storage::CRSStorage<EDLib::Model::HubbardModel<double> > storage2(p, m2
+#ifdef USE_MPI
+  , MPI_COMM_WORLD
+#endif
+  );
+  typedef typename EDLib::Symmetry::SzSymmetry::Sector Stype;
+  /// single spin-up row, with more than one CPU the sector is split along the spin-down index
+  Stype s(0,4,70);
+  m.symmetry().set_sector(s);
+  m2.symmetry().set_sector(s);
+  storage.fill();
+  storage2.fill();
+  std::vector<double> v(s.size()), w(s.size(), 0.0);
+  for(size_t i = 0; i < v.size(); ++i) {
+    v[i] = std::sin(0.37 * i + 1.0);
   }
+  storage2.av(v.data(), w.data(), s.size());
+  size_t vs = storage.vector_size(s);
+  size_t offset = 0;
 #ifdef USE_MPI
- }
+  offset = storage.offset();
 #endif
+  std::vector<double> lv(v.begin() + offset, v.begin() + offset + vs), lw(vs, 0.0);
+  /// the product is collective, each of up to 70 CPUs has a part of the spin-down index
+  storage.prepare_work_arrays(lv.data());
+  storage.av(lv.data(), lw.data(), vs);
+  storage.finalize(0, false);
+  for(size_t i = 0; i < vs; ++i) {
+    ASSERT_NEAR(lw[i], w[offset + i], 1e-12);
+  }
 }
-
@@ -4,7 +4,11 @@
 
 #include "gtest/gtest.h"
 
+#include <climits>
+#include <vector>
+
 #include "edlib/SzSymmetry.h"
+#include "edlib/CombinationIndex.h"
 #include "edlib/EDParams.h"
 
 
@@ -17,6 +21,16 @@ TEST(SzSymmetryTest, Combinatorics) {
   ASSERT_EQ(sym.comb().c_n_k(3, 2), 3);
 }
 
+TEST(SzSymmetryTest, LargeBinomials) {
+  EDLib::Combination comb(64);
+  ASSERT_EQ(comb.c_n_k(16, 8), 12870u);
+  ASSERT_EQ(comb.c_n_k(34, 17), 2333606220ull);
+  ASSERT_EQ(comb.c_n_k(64, 32), 1832624140942590534ull);
+  ASSERT_EQ(comb.c_n_k(5, 7), 0u);
+  /// dimension of the half-filled sector of 18 sites exceeds 2^31
+  ASSERT_EQ(comb.c_n_k(18, 9) * comb.c_n_k(18, 9), 2363904400ull);
+}
+
 
 TEST(SzSymmetryTest, States) {
   alps::params p;
@@ -38,3 +52,78 @@ TEST(SzSymmetryTest, Initialization) {
     }
   }
 }
+
+TEST(SzSymmetryTest, CombinationIndex) {
+  for (int n = 0; n <= 9; ++n) {
+    EDLib::Combination comb(n);
+    EDLib::CombinationIndex index(n);
+    for (int k = 0; k <= n; ++k) {
+      std::vector < int > positions(n + 1);
+      comb.init_state(k, positions);
+      for (int i = 0; i < comb.c_n_k(n, k); ++i) {
+        if (i > 0) {
+          comb.next_combination(n, k, positions);
+        }
+        long long b = 0;
+        for (int j = 0; j < k; ++j) {
+          b += 1ll << positions[j];
+        }
+        ASSERT_EQ(index.index(b, k), i);
+        ASSERT_EQ(index.state(i, k), b);
+      }
+    }
+  }
+}
+
+TEST(SzSymmetryTest, LargeSectorIndex) {
+  int Ns = 18;
+  EDLib::Symmetry::SzSymmetry sym(Ns);
+  EDLib::Symmetry::SzSymmetry::Sector sector(9, 9, sym.comb().c_n_k(Ns, 9) * sym.comb().c_n_k(Ns, 9));
+  ASSERT_GT(sector.size(), size_t(INT_MAX));
+  sym.set_sector(sector);
+  /// indices around 2^31 and at the end of the sector
+  std::vector < size_t > indices = {size_t(INT_MAX) - 1, size_t(INT_MAX), size_t(INT_MAX) + 1, size_t(1) << 31 | 12345, sector.size() - 1};
+  for (size_t i : indices) {
+    long long st = sym.state_by_index(i);
+    ASSERT_EQ(__builtin_popcountll((unsigned long long) (st >> Ns)), 9);
+    ASSERT_EQ(__builtin_popcountll((unsigned long long) (st & ((1ll << Ns) - 1))), 9);
+    ASSERT_EQ(sym.index(st), (long long) (i));
+  }
+  /// the last state of the sector has the highest spin-up and spin-down configurations
+  ASSERT_EQ(sym.state_by_index(sector.size() - 1), (((1ll << 9) - 1) << 27) | (((1ll << 9) - 1) << 9));
+}
+
+TEST(SzSymmetryTest, LargeRank) {
+  /// ranks of the strings with more than 32 bits are summed over the set bits
+  int n = 40;
+  EDLib::Combination comb(n);
+  EDLib::CombinationIndex index(n);
+  long long last = (long long) (comb.c_n_k(n, 20)) - 1;
+  ASSERT_GT(last, (long long) (INT_MAX));
+  for (long long i : {(long long) (INT_MAX), (long long) (INT_MAX) + 1, last}) {
+    ASSERT_EQ(index.index(index.state(i, 20), 20), i);
+  }
+}
+
+#ifdef __SIZEOF_INT128__
+TEST(SzSymmetryTest, WideStates) {
+  int Ns = 40;
+  EDLib::Symmetry::SzSymmetry128 sym(Ns);
+  for (int nup = 0; nup <= 2; ++nup) {
+    for (int ndown = 0; ndown <= 2; ++ndown) {
+      EDLib::Symmetry::SzSymmetry128::Sector sector(nup, ndown, sym.comb().c_n_k(Ns, nup) * sym.comb().c_n_k(Ns, ndown));
+      sym.set_sector(sector);
+      int i = 0;
+      while (sym.next_state()) {
+        unsigned __int128 st = sym.state();
+        ASSERT_EQ(__builtin_popcountll((unsigned long long) (st >> Ns)), nup);
+        ASSERT_EQ(__builtin_popcountll((unsigned long long) (st & ((((unsigned __int128) 1) << Ns) - 1))), ndown);
+        ASSERT_EQ(i, sym.index(st));
+        ++i;
+      }
+      ASSERT_EQ(i, sector.size());
+    }
+  }
+  ASSERT_THROW(EDLib::Symmetry::SzSymmetry(32), std::invalid_argument);
+}
+#endif
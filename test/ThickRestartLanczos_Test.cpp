@@ -0,0 +1,78 @@
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include "edlib/ThickRestartLanczos.h"
+
+/// 1D chain with open boundaries: A = 2 - (shift left + shift right), eigenvalues 2 - 2 cos(pi k / (n + 1))
+void chain(double *v, double *w, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    w[i] = 2.0 * v[i] - (i > 0 ? v[i - 1] : 0.0) - (i + 1 < n ? v[i + 1] : 0.0);
+  }
+}
+
+double chain_eigenvalue(int k, size_t n) {
+  return 2.0 - 2.0 * std::cos(M_PI * k / (n + 1.0));
+}
+
+template<typename basis_prec>
+void check_chain(size_t n, int nev, int ncv, double tol, double eps) {
+  EDLib::Storage::ThickRestartLanczos < double, basis_prec > lanczos(n, n, nev, ncv, 1e-10, 10000);
+  std::vector < double > evals;
+  std::vector < std::vector < double > > evecs;
+  int info = lanczos.solve(chain, [](double *, int) {}, std::vector < double >(), 1, evals, evecs, true);
+  ASSERT_EQ(info, 0);
+  ASSERT_GT(lanczos.restarts(), 0);
+  ASSERT_EQ(int(evals.size()), nev);
+  std::vector < double > w(n);
+  for (int i = 0; i < nev; ++i) {
+    ASSERT_NEAR(evals[i], chain_eigenvalue(i + 1, n), tol);
+    chain(evecs[i].data(), w.data(), n);
+    double res = 0.0;
+    for (size_t l = 0; l < n; ++l) {
+      res += (w[l] - evals[i] * evecs[i][l]) * (w[l] - evals[i] * evecs[i][l]);
+    }
+    ASSERT_LT(std::sqrt(res), eps);
+  }
+}
+
+TEST(ThickRestartLanczosTest, Chain) {
+  check_chain < double >(400, 3, 20, 1e-10, 1e-6);
+}
+
+TEST(ThickRestartLanczosTest, FloatBasis) {
+  check_chain < float >(400, 3, 20, 1e-6, 1e-3);
+}
+
+TEST(ThickRestartLanczosTest, DegenerateSpectrum) {
+  /// two decoupled chains, each eigenvalue is doubly degenerate
+  size_t n = 100;
+  EDLib::Storage::ThickRestartLanczos < double > lanczos(2 * n, 2 * n, 4, 16, 1e-12, 10000);
+  std::vector < double > evals;
+  std::vector < std::vector < double > > evecs;
+  lanczos.solve([n](double *v, double *w, size_t) {
+    chain(v, w, n);
+    chain(v + n, w + n, n);
+  }, [](double *, int) {}, std::vector < double >(), 1, evals, evecs, false);
+  ASSERT_NEAR(evals[0], chain_eigenvalue(1, n), 1e-10);
+  ASSERT_NEAR(evals[1], chain_eigenvalue(1, n), 1e-10);
+  ASSERT_NEAR(evals[2], chain_eigenvalue(2, n), 1e-10);
+  ASSERT_NEAR(evals[3], chain_eigenvalue(2, n), 1e-10);
+}
+
+TEST(ThickRestartLanczosTest, Jacobi) {
+  std::vector < double > A = {4.0, 1.0, 0.0, 1.0, 3.0, 1.0, 0.0, 1.0, 2.0};
+  std::vector < double > evals, evecs;
+  EDLib::Storage::ThickRestartLanczos < double >::eigen(A, 3, evals, evecs);
+  ASSERT_NEAR(evals[0], 3.0 - std::sqrt(3.0), 1e-12);
+  ASSERT_NEAR(evals[1], 3.0, 1e-12);
+  ASSERT_NEAR(evals[2], 3.0 + std::sqrt(3.0), 1e-12);
+  for (int i = 0; i < 3; ++i) {
+    for (int r = 0; r < 3; ++r) {
+      double Av = 0.0;
+      for (int c = 0; c < 3; ++c) {
+        Av += A[r * 3 + c] * evecs[c * 3 + i];
+      }
+      ASSERT_NEAR(Av, evals[i] * evecs[r * 3 + i], 1e-12);
+    }
+  }
+}
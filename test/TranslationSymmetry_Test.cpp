@@ -0,0 +1,126 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "edlib/Hamiltonian.h"
+#include "edlib/TranslationSymmetry.h"
+#include "edlib/EDParams.h"
+
+#ifdef USE_MPI
+
+class TranslationSymmetryTestEnv : public ::testing::Environment {
+  protected:
+  virtual void SetUp() {
+    char** argv;
+    int argc = 0;
+    int mpiError = MPI_Init(&argc, &argv);
+  }
+
+  virtual void TearDown() {
+    MPI_Finalize();
+  }
+
+  ~TranslationSymmetryTestEnv(){};
+
+};
+
+::testing::Environment* const foo_env = AddGlobalTestEnvironment(new TranslationSymmetryTestEnv);
+
+#endif
+
+/**
+ * Diagonalize the Hamiltonian and collect the lowest eigenvalues for each (nup, ndown) pair, all momentum sectors together.
+ */
+template<class HamType>
+std::map < std::pair < int, int >, std::vector < double > > lowest_eigenvalues(alps::params &p, size_t nev) {
+  HamType ham(p
+#ifdef USE_MPI
+  , MPI_COMM_WORLD
+#endif
+  );
+  ham.diag();
+  std::map < std::pair < int, int >, std::vector < double > > evals;
+  for (auto pair = ham.eigenpairs().begin(); pair != ham.eigenpairs().end(); ++pair) {
+    evals[std::make_pair(pair->sector().nup(), pair->sector().ndown())].push_back(pair->eigenvalue());
+  }
+  for (auto it = evals.begin(); it != evals.end(); ++it) {
+    std::sort(it->second.begin(), it->second.end());
+    it->second.resize(std::min(it->second.size(), nev));
+  }
+  return evals;
+}
+
+/**
+ * Compare the spectrum of the translation invariant Hamiltonian, merged over the momentum sectors, with the
+ * spectrum of the same cluster in the Sz basis.
+ */
+void check_spectrum(int lx, int ly) {
+  alps::params p;
+  EDLib::define_parameters(p);
+  p["NSITES"] = 4;
+  p["NSPINS"] = 2;
+  p["INPUT_FILE"] = "test/input/4ring/input.h5";
+  p["lattice.LX"] = lx;
+  p["lattice.LY"] = ly;
+  p["storage.MAX_SIZE"] = 576;
+  p["storage.MAX_DIM"] = 36;
+  p["storage.EIGENVALUES_ONLY"] = true;
+  p["storage.ORBITAL_NUMBER"] = 1;
+  p["storage.EIGENSOLVER"] = "DAVIDSON";
+  p["arpack.NEV"] = 3;
+  p["arpack.SECTOR"] = false;
+  std::map < std::pair < int, int >, std::vector < double > > k_evals = lowest_eigenvalues < EDLib::CSRTranslationHubbardHamiltonian >(p, 3);
+  std::map < std::pair < int, int >, std::vector < double > > sz_evals = lowest_eigenvalues < EDLib::CSRHubbardHamiltonian >(p, 3);
+  ASSERT_EQ(k_evals.size(), sz_evals.size());
+  for (auto it = sz_evals.begin(); it != sz_evals.end(); ++it) {
+    ASSERT_EQ(k_evals.count(it->first), 1u);
+    const std::vector < double > &k = k_evals[it->first];
+    ASSERT_EQ(k.size(), it->second.size());
+    for (size_t i = 0; i < k.size(); ++i) {
+      ASSERT_NEAR(k[i], it->second[i], 1e-8);
+    }
+  }
+}
+
+
+TEST(TranslationSymmetryTest, Dimensions) {
+  alps::params p;
+  EDLib::define_parameters(p);
+  p["NSITES"] = 6;
+  p["lattice.LX"] = 3;
+  p["lattice.LY"] = 2;
+  EDLib::Symmetry::TranslationSymmetry sym(p);
+  size_t total = 0;
+  while (sym.next_sector()) {
+    /// builds the table of representatives and checks its size against the sector dimension
+    sym.init();
+    total += sym.sector().size();
+  }
+  ASSERT_EQ(total, size_t(1) << 12);
+}
+
+TEST(TranslationSymmetryTest, Initialization) {
+  alps::params p;
+  EDLib::define_parameters(p);
+  EDLib::Symmetry::TranslationSymmetry sym(p);
+  while (sym.next_sector()) {
+    sym.init();
+    int i = 0;
+    int nrep = (2 * sym.sector().kx()) % p["NSITES"].as<int>() == 0 ? sym.sector().size() : sym.sector().size() / 2;
+    while (sym.next_state()) {
+      ASSERT_EQ(i % nrep, sym.index(sym.state()));
+      ++i;
+    }
+  }
+}
+
+TEST(TranslationSymmetryTest, SpectrumRing) {
+  check_spectrum(4, 1);
+}
+
+TEST(TranslationSymmetryTest, SpectrumSquare) {
+  check_spectrum(2, 2);
+}